@@ -1,3 +1,4 @@
+#include <FrameSource.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -95,16 +96,18 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     // Read input video filename
     std::string filename = IMAGES_ROOT + "/focus-test.mp4";
 
-    // Create a VideoCapture object
-    cv::VideoCapture cap( filename );
+    // Create a FrameSource, it decodes the next frames while the focus
+    // measures of the current one are computed
+    FrameSource cap( filename );
 
-    // Read first frame from the video
+    // Read first frame from the video. frameId counts the frames read so far,
+    // like CAP_PROP_POS_FRAMES of a cv::VideoCapture.
     cv::Mat frame;
-    cap >> frame;
+    cap.read( frame );
+    int frameId = 1;
 
     // Display total number of frames in the video
-    std::cout << "Total number of frames : "
-              << ( int )cap.get( cv::CAP_PROP_FRAME_COUNT );
+    std::cout << "Total number of frames : " << cap.getFrameCount( );
 
     double maxV1 = 0;
     double maxV2 = 0;
@@ -153,7 +156,7 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
             // Revise the current maximum
             maxV1 = val1;
             // Get frame ID of the new best frame
-            bestFrameId1 = ( int )cap.get( cv::CAP_PROP_POS_FRAMES );
+            bestFrameId1 = frameId;
             // Revise the new best frame
             bestFrame1 = frame.clone( );
             std::cout << "Frame ID of the best frame [Method 1]: "
@@ -166,17 +169,17 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
             // Revise the current maximum
             maxV2 = val2;
             // Get frame ID of the new best frame
-            bestFrameId2 = ( int )cap.get( cv::CAP_PROP_POS_FRAMES );
+            bestFrameId2 = frameId;
             // Revise the new best frame
             bestFrame2 = frame.clone( );
             std::cout << "Frame ID of the best frame [Method 2]: "
                       << bestFrameId2 << '\n';
         }
 
-        cap >> frame;
-
-        if ( frame.empty( ) )
+        if ( ! cap.read( frame ) )
             break;
+
+        frameId++;
     }
 
     std::cout << "================================================" << '\n';
@@ -187,8 +190,6 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     std::cout << "Frame ID of the best frame [Method 2]: " << bestFrameId2
               << '\n';
 
-    cap.release( );
-
     cv::Mat out;
     cv::hconcat( bestFrame1, bestFrame2, out );
 
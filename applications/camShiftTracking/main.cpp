@@ -61,6 +61,12 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     std::vector< cv::Mat > channels( 3 );
     cv::split( hsvObject, channels );
 
+    // Show frames from a display thread, so the waitKey of every showMat
+    // no longer limits the tracking rate. The sink is installed before the
+    // first window is created, so all windows belong to the display thread.
+    const auto previousSink = getDisplaySink( );
+    setDisplaySink( std::make_shared< AsyncDisplaySink >( previousSink ) );
+
     showMat( mask, "Mask of ROI", false );
     showMat( roiObject, "ROI", true );
 
@@ -157,6 +163,7 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
 
     // Clean up
     cap.release( );
+    setDisplaySink( previousSink );
     cv::destroyAllWindows( );
 
     return 0;
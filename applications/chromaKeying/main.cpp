@@ -1,3 +1,4 @@
+#include <FrameSource.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -39,7 +40,7 @@ int maxColorCast = { 100 };
 
 void updateView( );
 void showErrorMessage( const std::string& message );
-void readNextFrame( cv::VideoCapture& cap );
+void readNextFrame( FrameSource& source );
 void onMouse( int action, int x, int y, int flags, void* userdata );
 cv::Scalar bgr2Hsv( const cv::Scalar& bgr );
 void applyMattening( int, void* );
@@ -94,7 +95,11 @@ int main( int argc, char** argv )
     cv::createTrackbar(
         "Color Cast", windowName, &colorCast, maxColorCast, applyMattening );
 
-    cv::VideoCapture videoCap( IMAGES_ROOT + "/greenscreen-asteroid.mp4" );
+    // Decoded ahead on a background thread and restarted at the end
+    FrameSourceParams sourceParams;
+    sourceParams.loop = true;
+    FrameSource videoCap( IMAGES_ROOT + "/greenscreen-asteroid.mp4",
+                          sourceParams );
 
     // Check if stream opened successfully
     if ( ! videoCap.isOpened( ) )
@@ -137,7 +142,6 @@ int main( int argc, char** argv )
     }
 
     // Clean up
-    videoCap.release( );
     cv::destroyAllWindows( );
 
     return 0;
@@ -257,18 +261,10 @@ void showErrorMessage( const std::string& message )
     cv::imshow( windowName, combinedImage );
 }
 
-void readNextFrame( cv::VideoCapture& cap )
+void readNextFrame( FrameSource& source )
 {
-    // Capture frame-by-frame
-    cap >> currentFrame;
-
-    // If the frame is empty, reset the stream
-    if ( currentFrame.empty( ) )
-    {
-        std::cout << "Video stream reached end. Video restarted\n";
-        cap.set( cv::CAP_PROP_POS_FRAMES, 0.0 );
-        cap >> currentFrame;
-    }
+    // Capture frame-by-frame, the source restarts the video at its end
+    source.read( currentFrame );
 
     if ( backgroundColorBgr != cv::Scalar::all( 0 ) )
     {
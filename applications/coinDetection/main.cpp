@@ -1,3 +1,4 @@
+#include <BlobAnalysis.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -14,32 +15,6 @@ IGNORE_WARNINGS_POP
 const std::string IMAGES_ROOT = "C:/images";
 const std::string RESULTS_ROOT = "C:/images/results";
 
-cv::Mat displayConnectedComponents( cv::Mat& im )
-{
-    // Make a copy of the image
-    cv::Mat imLabels = im.clone( );
-
-    // First let's find the min and max values in imLabels
-    cv::Point minLoc, maxLoc;
-    double min, max;
-
-    // The following line finds the min and max pixel values
-    // and their locations in an image.
-    cv::minMaxLoc( imLabels, &min, &max, &minLoc, &maxLoc );
-
-    // Normalize the image so the min value is 0 and max value is 255.
-    imLabels = 255 * ( imLabels - min ) / ( max - min );
-
-    // Convert image to 8-bits
-    imLabels.convertTo( imLabels, CV_8U );
-
-    // Apply a color map
-    cv::Mat imColorMap;
-    applyColorMap( imLabels, imColorMap, cv::COLORMAP_JET );
-
-    return imColorMap;
-}
-
 void assignmentPartA( );
 void assignmentPartB( );
 
@@ -230,19 +205,17 @@ void assignmentPartA( )
 
     showMat( image, "Marked found coins", true );
 
-    // Now e want to do a connected component analysis
+    // Now e want to do a connected component analysis. The run-length labeler
+    // collects the blob statistics while labeling, so no extra pass over the
+    // label image is needed.
     cv::Mat cvLabels;
-    cv::Mat cvBlobStatistics;
-    cv::Mat cvBlobCentroids;
+    std::vector< BlobStatistics > blobs;
 
-    constexpr int lblType = CV_32S;
-
-    const int32_t numBlobs = cv::connectedComponentsWithStats(
-        dilated, cvLabels, cvBlobStatistics, cvBlobCentroids, 8, lblType );
+    const int32_t numBlobs = labelRunLength( dilated, cvLabels, blobs, 8 );
 
     std::cout << "Number objects found with CCL: " << numBlobs << "\n";
 
-    cv::Mat colorMap = displayConnectedComponents( cvLabels );
+    cv::Mat colorMap = colorizeLabels( cvLabels, numBlobs );
 
     showMat( colorMap, "Result of CCL", true );
 
@@ -542,19 +515,23 @@ void assignmentPartB( )
 
     showMat( image, "Marked found coins", true, imageScaleFactor );
 
-    // Now e want to do a connected component analysis
+    // Now e want to do a connected component analysis. The run-length labeler
+    // collects the blob statistics while labeling, so no extra pass over the
+    // label image is needed.
     cv::Mat cvLabels;
-    cv::Mat cvBlobStatistics;
-    cv::Mat cvBlobCentroids;
-
-    constexpr int lblType = CV_32S;
+    std::vector< BlobStatistics > blobs;
 
-    const int32_t numBlobs = cv::connectedComponentsWithStats(
-        dilated, cvLabels, cvBlobStatistics, cvBlobCentroids, 8, lblType );
+    const int32_t numBlobs = labelRunLength( dilated, cvLabels, blobs, 8 );
 
     std::cout << "Number objects found with CCL: " << numBlobs << "\n";
 
-    cv::Mat colorMap = displayConnectedComponents( cvLabels );
+    for ( const auto& blob : blobs )
+    {
+        std::cout << "Blob #" << blob.label << " has area = " << blob.area
+                  << " and centroid = " << blob.centroid << "\n";
+    }
+
+    cv::Mat colorMap = colorizeLabels( cvLabels, numBlobs );
 
     showMat( colorMap, "Result of CCL", true, imageScaleFactor );
 
@@ -10,6 +10,7 @@ IGNORE_WARNINGS_POP
 
 // STD includes
 #include <iostream>
+#include <span>
 
 const std::string IMAGES_ROOT = "C:/images";
 const std::string RESULTS_ROOT = "C:/images/results";
@@ -38,43 +39,36 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     constexpr int32_t hChannels[] = { 0 };
     const int32_t histSize[] = { levels };
 
-    std::vector< float > histogram;
-
+    // calcHist returns a continuous column of floats, so the plots can take
+    // the data directly without copying it into a vector
     cv::Mat matHistogram;
     cv::calcHist(
         &img, 1, hChannels, cv::noArray( ), matHistogram, 1, histSize, ranges );
 
-    histogram.resize( static_cast< size_t >( levels ) );
-
-    for ( int32_t row = 0; row < matHistogram.rows; row++ )
-    {
-        const auto histVal = matHistogram.at< float >( row, 0 );
-
-        histogram[ static_cast< size_t >( row ) ] = histVal;
-    }
+    const std::span< const float > histogram( matHistogram.ptr< float >( ),
+                                              matHistogram.total( ) );
 
     showBar( histogram, "Original Histogram", false );
 
+    cv::Mat matHistogramEq;
     cv::calcHist( &imEq,
                   1,
                   hChannels,
                   cv::noArray( ),
-                  matHistogram,
+                  matHistogramEq,
                   1,
                   histSize,
                   ranges );
 
-    histogram.clear( );
-    histogram.resize( static_cast< size_t >( levels ) );
-
-    for ( int32_t row = 0; row < matHistogram.rows; row++ )
-    {
-        const auto histVal = matHistogram.at< float >( row, 0 );
+    const std::span< const float > histogramEq(
+        matHistogramEq.ptr< float >( ), matHistogramEq.total( ) );
 
-        histogram[ static_cast< size_t >( row ) ] = histVal;
-    }
+    showBar( histogramEq, "Equalized Histogram", false );
 
-    showBar( histogram, "Equalized Histogram", true );
+    showBars< float >( { { histogram, cv::Scalar( 0, 0, 255 ) },
+                         { histogramEq, cv::Scalar( 0, 255, 0 ) } },
+                       "Histograms",
+                       true );
 
     // Histogram Equalization for Color Images
 
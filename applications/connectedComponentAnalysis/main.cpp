@@ -1,3 +1,4 @@
+#include <BlobAnalysis.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -25,9 +26,11 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     cv::Mat imThresh;
     cv::threshold( img, imThresh, 127, 255, cv::THRESH_BINARY );
 
-    // Find connected components
+    // Find connected components. The blob statistics are collected during
+    // labeling.
     cv::Mat imLabels;
-    int nComponents = cv::connectedComponents( imThresh, imLabels );
+    std::vector< BlobStatistics > blobs;
+    int nComponents = labelRunLength( imThresh, imLabels, blobs );
 
     cv::Mat imLabelsCopy = imLabels.clone( );
 
@@ -51,6 +54,13 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     // Display the labels
     std::cout << "Number of components = " << nComponents << "\n";
 
+    for ( const auto& blob : blobs )
+    {
+        std::cout << "Component " << blob.label << ": area = " << blob.area
+                  << ", bounding box = " << blob.boundingBox
+                  << ", centroid = " << blob.centroid << "\n";
+    }
+
     showMat( imLabels == 0, "Label Image 0", false );
     showMat( imLabels == 1, "Label Image 1", false );
     showMat( imLabels == 2, "Label Image 2", false );
@@ -58,24 +68,8 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     showMat( imLabels == 4, "Label Image 4", false );
     showMat( imLabels == 5, "Label Image 5", false );
 
-    // Make a copy of the image
-    imLabels = imLabelsCopy.clone( );
-
-    // First let's find the min and max values in imLabels
-    // The following line finds the min and max pixel values
-    // and their locations in an image.
-    double minValue2, maxValue2;
-    cv::minMaxLoc( imLabels, &minValue2, &maxValue2, &minLoc, &maxLoc );
-
-    // Normalize the image so the min value is 0 and max value is 255.
-    imLabels = 255 * ( imLabels - minValue2 ) / ( maxValue2 - minValue2 );
-
-    // Convert image to 8-bits
-    imLabels.convertTo( imLabels, CV_8U );
-
     // Apply a color map
-    cv::Mat imColorMap;
-    cv::applyColorMap( imLabels, imColorMap, cv::COLORMAP_JET );
+    cv::Mat imColorMap = colorizeLabels( imLabelsCopy, nComponents );
 
     // Display colormapped labels
     showMat( imColorMap, "Label Image Color", true );
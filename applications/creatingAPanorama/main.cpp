@@ -1,5 +1,8 @@
+#include <FeatureMatching.h>
 #include <GUI.h>
+#include <ImageAlignment.h>
 #include <macros.h>
+#include <PanoramaCompositing.h>
 
 // OpenCV includes
 IGNORE_WARNINGS_OPENCV_PUSH
@@ -9,45 +12,55 @@ IGNORE_WARNINGS_POP
 
 // STD includes
 #include <iostream>
+#include <string>
 
 const std::string IMAGES_ROOT = "C:/images";
 const std::string RESULTS_ROOT = "C:/images/results";
 
-int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
+// ORB features of both images at full resolution and their best matches
+struct FullResolutionMatches
 {
-    //
-    // Step 1 : Find Keypoints and Descriptors
-    //
+    std::vector< cv::KeyPoint > keypoints1, keypoints2;
+    FeatureMatches featureMatches;
+};
 
+FullResolutionMatches matchFullResolution( const cv::Mat& im1Gray,
+                                           const cv::Mat& im2Gray )
+{
     int MAX_FEATURES = 500;
     float GOOD_MATCH_PERCENT = 0.15f;
 
-    // Read reference image
-    const std::string image1File( IMAGES_ROOT + "/scene/scene1.jpg" );
-    std::cout << "Reading First Image : " << image1File << '\n';
-    cv::Mat im1 = cv::imread( image1File );
-
-    const std::string image2File( IMAGES_ROOT + "/scene/scene3.jpg" );
-    std::cout << "Reading Second Image : " << image2File << '\n';
-    cv::Mat im2 = cv::imread( image2File );
-
-    // Convert images to grayscale
-    cv::Mat im1Gray, im2Gray;
-    cv::cvtColor( im1, im1Gray, cv::COLOR_BGR2GRAY );
-    cv::cvtColor( im2, im2Gray, cv::COLOR_BGR2GRAY );
-
-    // Variables to store keypoints and descriptors
-    std::vector< cv::KeyPoint > keypoints1, keypoints2;
+    FullResolutionMatches result;
     cv::Mat descriptors1, descriptors2;
 
     // Detect ORB features and compute descriptors.
     cv::Ptr< cv::Feature2D > orb = cv::ORB::create( MAX_FEATURES );
-    orb->detectAndCompute( im1Gray, cv::Mat( ), keypoints1, descriptors1 );
-    orb->detectAndCompute( im2Gray, cv::Mat( ), keypoints2, descriptors2 );
+    orb->detectAndCompute(
+        im1Gray, cv::Mat( ), result.keypoints1, descriptors1 );
+    orb->detectAndCompute(
+        im2Gray, cv::Mat( ), result.keypoints2, descriptors2 );
 
+    // Match features.
+    // Only the best GOOD_MATCH_PERCENT matches are kept. They are selected
+    // with a partial sort and the point locations are extracted right away.
+    FeatureMatchingParams matchingParams;
+    matchingParams.goodMatchPercent = GOOD_MATCH_PERCENT;
+
+    result.featureMatches = matchFeatures( result.keypoints1,
+                                           descriptors1,
+                                           result.keypoints2,
+                                           descriptors2,
+                                           matchingParams );
+
+    return result;
+}
+
+void showFullResolutionMatches( const cv::Mat& im1, const cv::Mat& im2,
+                                const FullResolutionMatches& full )
+{
     cv::Mat im1Keypoints;
     cv::drawKeypoints( im1,
-                       keypoints1,
+                       full.keypoints1,
                        im1Keypoints,
                        cv::Scalar( 0, 0, 255 ),
                        cv::DrawMatchesFlags::DEFAULT );
@@ -56,75 +69,108 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
 
     showMat( im1Keypoints, "Keypoint's obtained from the ORB detector", true );
 
-    //
-    // Step 2 : Find matching corresponding points
-    //
-    // Match features.
-    std::vector< cv::DMatch > matches;
-    cv::Ptr< cv::DescriptorMatcher > matcher =
-        cv::DescriptorMatcher::create( "BruteForce-Hamming" );
-    matcher->match( descriptors1, descriptors2, matches, cv::Mat( ) );
-
-    // Sort matches by score
-    std::sort( matches.begin( ), matches.end( ) );
-
-    // Remove not so good matches
-    const int numGoodMatches = static_cast< int >(
-        static_cast< float >( matches.size( ) ) * GOOD_MATCH_PERCENT );
-    matches.erase( matches.begin( ) + numGoodMatches, matches.end( ) );
-
     // Draw top matches
     cv::Mat imMatches;
-    cv::drawMatches( im1, keypoints1, im2, keypoints2, matches, imMatches );
+    cv::drawMatches( im1,
+                     full.keypoints1,
+                     im2,
+                     full.keypoints2,
+                     full.featureMatches.matches,
+                     imMatches );
 
     showMat( imMatches, "Matching obtained from the descriptor matcher", true );
+}
+
+// Usage: creatingAPanorama [--compare]
+//
+// The homography is estimated coarse to fine. The full resolution ORB
+// matching only runs if that fails, or with --compare to show its keypoints
+// and matches and to compare the run times of both.
+int main( int argc, char** argv )
+{
+    const bool compare = argc > 1 && std::string( argv[ 1 ] ) == "--compare";
 
     //
-    // Step 3 : Image Alignment using Homography
+    // Step 1 : Read Images
     //
-    // Extract location of good matches
-    std::vector< cv::Point2f > points1, points2;
 
-    for ( size_t i = 0; i < matches.size( ); i++ )
-    {
-        points1.push_back(
-            keypoints1[ static_cast< size_t >( matches[ i ].queryIdx ) ].pt );
-        points2.push_back(
-            keypoints2[ static_cast< size_t >( matches[ i ].trainIdx ) ].pt );
-    }
+    // Read reference image
+    const std::string image1File( IMAGES_ROOT + "/scene/scene1.jpg" );
+    std::cout << "Reading First Image : " << image1File << '\n';
+    cv::Mat im1 = cv::imread( image1File );
 
-    // Find homography
-    cv::Mat h = findHomography( points2, points1, cv::RANSAC );
-    std::cout << "Homography Matrix:\n" << h << '\n';
+    const std::string image2File( IMAGES_ROOT + "/scene/scene3.jpg" );
+    std::cout << "Reading Second Image : " << image2File << '\n';
+    cv::Mat im2 = cv::imread( image2File );
+
+    // Convert images to grayscale
+    cv::Mat im1Gray, im2Gray;
+    cv::cvtColor( im1, im1Gray, cv::COLOR_BGR2GRAY );
+    cv::cvtColor( im2, im2Gray, cv::COLOR_BGR2GRAY );
 
     //
-    // Step 4 : Warp Image
+    // Step 2 : Image Alignment using Homography
     //
-    // Use homography to warp image
-    //int im1Height = im1.rows;
-    int im1Width = im1.cols;
-    int im2Height = im2.rows;
-    int im2Width = im2.cols;
-    cv::Mat im2Aligned;
-    cv::warpPerspective(
-        im2, im2Aligned, h, cv::Size( im2Width + im1Width, im2Height ) );
-
-    showMat( im2Aligned,
-             "Second image aligned to first image obtained using homography "
-             "and warping",
-             true );
+    // Find homography. The coarse to fine aligner estimates it on a
+    // downscaled pyramid level first and refines it at full resolution.
+    cv::TickMeter pyramidTimer;
+    pyramidTimer.start( );
+    cv::Mat h = estimateHomographyPyramid( im2Gray, im1Gray );
+    pyramidTimer.stop( );
+
+    if ( ! h.empty( ) )
+    {
+        std::cout << "Coarse to fine homography ( "
+                  << pyramidTimer.getTimeMilli( ) << " ms )\n";
+    }
 
     //
-    // Step 5 : Stitch Images
+    // Step 3 : Full resolution matching, if the coarse to fine alignment
+    // failed or for comparison
     //
-    cv::Mat stitchedImage = im2Aligned.clone( );
-
-    cv::Rect roi( 0, 0, im1.cols, im1.rows );
-    im1.copyTo( stitchedImage( roi ) );
+    if ( h.empty( ) || compare )
+    {
+        cv::TickMeter fullTimer;
+        fullTimer.start( );
+        const FullResolutionMatches full =
+            matchFullResolution( im1Gray, im2Gray );
+        const cv::Mat hFull = findHomography( full.featureMatches.trainPoints,
+                                              full.featureMatches.queryPoints,
+                                              cv::RANSAC );
+        fullTimer.stop( );
+
+        std::cout << "Full resolution homography ( "
+                  << fullTimer.getTimeMilli( ) << " ms ):\n"
+                  << hFull << '\n';
+
+        showFullResolutionMatches( im1, im2, full );
+
+        if ( h.empty( ) )
+        {
+            h = hFull;
+        }
+    }
+    std::cout << "Homography Matrix:\n" << h << '\n';
 
-    showMat( stitchedImage,
-             "Final Stitched Image",
-             true );
+    //
+    // Step 4 : Warp and Stitch Images
+    //
+    // The canvas is composited tile by tile. Only the parts of the images
+    // falling into a tile are warped, and every finished tile is written to
+    // disk, so the full canvas is never held in memory. The first image is
+    // added last with the identity homography, so it overwrites the warped
+    // second image like a copy into the canvas would.
+    const cv::Size canvasSize( im2.cols + im1.cols, im2.rows );
+
+    TiledPanoramaCompositor compositor(
+        canvasSize, cv::Size( 512, 512 ), PanoramaBlendMode::Overwrite );
+    compositor.addImage( im2, h );
+    compositor.addImage( im1, cv::Mat::eye( 3, 3, CV_64F ) );
+
+    const cv::Mat stitchedPreview = compositor.render(
+        TiledPanoramaCompositor::writeTilesTo( RESULTS_ROOT ), 0.5 );
+
+    showMat( stitchedPreview, "Final Stitched Image", true, 2 );
 
     // Clean up
     cv::destroyAllWindows( );
@@ -0,0 +1,238 @@
+#include <Benchmark.h>
+#include <DnnBackend.h>
+#include <ImageClassifier.h>
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/opencv.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+const std::string IMAGES_ROOT = "C:/images";
+const std::string MODELS_ROOT = "C:/images/models";
+const std::string RESULTS_ROOT = "C:/images/results";
+
+constexpr int32_t topK = 5;
+constexpr size_t maxImages = 256;
+
+const std::string classFile =
+    MODELS_ROOT + "/classification_classes_ILSVRC2012.txt";
+
+// One way of running GoogLeNet
+struct Variant
+{
+    std::string name;
+    DnnBackend backend;
+    std::string model;
+    std::string config;
+
+    // The Model Optimizer folds the mean into OpenVINO IR models
+    cv::Scalar mean;
+};
+
+const cv::Scalar caffeMean( 104, 117, 123 );
+const cv::Scalar irMean( 0, 0, 0 );
+
+const std::vector< Variant > variants {
+    { "opencv fp32",
+      DnnBackend::OpenCV,
+      MODELS_ROOT + "/bvlc_googlenet.caffemodel",
+      MODELS_ROOT + "/bvlc_googlenet.prototxt",
+      caffeMean },
+    { "opencl fp16",
+      DnnBackend::OpenCLFP16,
+      MODELS_ROOT + "/bvlc_googlenet.caffemodel",
+      MODELS_ROOT + "/bvlc_googlenet.prototxt",
+      caffeMean },
+    { "openvino fp32",
+      DnnBackend::OpenVino,
+      MODELS_ROOT + "/bvlc_googlenet.caffemodel",
+      MODELS_ROOT + "/bvlc_googlenet.prototxt",
+      caffeMean },
+    { "openvino ir fp32",
+      DnnBackend::OpenVino,
+      MODELS_ROOT + "/googlenet-v1/FP32/googlenet-v1.xml",
+      MODELS_ROOT + "/googlenet-v1/FP32/googlenet-v1.bin",
+      irMean },
+    { "openvino ir int8",
+      DnnBackend::OpenVino,
+      MODELS_ROOT + "/googlenet-v1/FP16-INT8/googlenet-v1.xml",
+      MODELS_ROOT + "/googlenet-v1/FP16-INT8/googlenet-v1.bin",
+      irMean } };
+
+bool isAvailable( const Variant& variant )
+{
+    return isDnnBackendAvailable( variant.backend ) &&
+           std::filesystem::exists( variant.model ) &&
+           std::filesystem::exists( variant.config );
+}
+
+std::vector< cv::Mat > loadImages( const std::string& directory )
+{
+    std::vector< cv::Mat > images;
+
+    for ( const auto& entry :
+          std::filesystem::directory_iterator( directory ) )
+    {
+        const auto extension = entry.path( ).extension( );
+        if ( ! entry.is_regular_file( ) ||
+             ( extension != ".jpg" && extension != ".png" ) )
+        {
+            continue;
+        }
+
+        cv::Mat image = cv::imread( entry.path( ).string( ) );
+        if ( ! image.empty( ) )
+        {
+            images.push_back( image );
+        }
+
+        if ( images.size( ) == maxImages )
+        {
+            break;
+        }
+    }
+
+    return images;
+}
+
+// Share of the reference top k classes that are in the top k of result
+double topKOverlap( const std::vector< Classification >& reference,
+                    const std::vector< Classification >& result )
+{
+    size_t common = 0;
+
+    for ( const auto& r : reference )
+    {
+        common += static_cast< size_t >(
+            std::any_of( result.begin( ), result.end( ), [ & ]( auto& c ) {
+                return c.classId == r.classId;
+            } ) );
+    }
+
+    return reference.empty( ) ? 1.0
+                              : static_cast< double >( common ) /
+                                    static_cast< double >( reference.size( ) );
+}
+
+// Usage: deepLearningBackendComparison [directory]
+//
+// Accuracy versus latency of GoogLeNet on every available backend and model
+// precision. Accuracy is measured against the first variant, OpenCV in FP32,
+// since no ground truth is needed for that: the share of images with the
+// same top 1 class, the mean overlap of the top 5 classes and the largest
+// difference of the top 1 probability. Latency is the classification of a
+// single image, measured with the benchmark harness. Variants whose backend
+// is not available or whose model files are missing are skipped, except for
+// the reference: without it the comparison is aborted.
+int main( int argc, char** argv )
+{
+    const std::string directory = argc > 1 ? argv[ 1 ] : IMAGES_ROOT;
+    const auto images = loadImages( directory );
+
+    if ( images.empty( ) )
+    {
+        std::cerr << "No images in " << directory << '\n';
+        return 1;
+    }
+
+    const Variant& referenceVariant = variants.front( );
+    if ( ! isAvailable( referenceVariant ) )
+    {
+        std::cerr << "The reference " << referenceVariant.name
+                  << " is not available, " << referenceVariant.model
+                  << " or " << referenceVariant.config << " is missing\n";
+        return 1;
+    }
+
+    std::cout << "Comparing on " << images.size( ) << " images against "
+              << referenceVariant.name << '\n';
+
+    BenchmarkParams benchmarkParams;
+    benchmarkParams.iterations = 50;
+
+    std::vector< BenchmarkResult > results;
+    std::vector< std::vector< Classification > > reference;
+
+    for ( const auto& variant : variants )
+    {
+        if ( ! isAvailable( variant ) )
+        {
+            std::cout << variant.name << ": skipped, not available\n";
+            continue;
+        }
+
+        ClassifierParams params;
+        params.mean = variant.mean;
+
+        cv::dnn::Net net = cv::dnn::readNet( variant.model, variant.config );
+        setDnnBackend( net, variant.backend );
+
+        ImageClassifier classifier( net, classFile, params );
+
+        const auto classifications = classifier.classifyBatch( images, topK );
+
+        if ( reference.empty( ) )
+        {
+            reference = classifications;
+        }
+
+        //
+        // Agreement with the reference
+        //
+        size_t sameTop1 = 0;
+        double overlap = 0.0;
+        float maxProbabilityDifference = 0.0f;
+
+        for ( size_t i = 0; i < images.size( ); i++ )
+        {
+            const auto& expected = reference[ i ];
+            const auto& actual = classifications[ i ];
+
+            if ( expected.front( ).classId == actual.front( ).classId )
+            {
+                sameTop1++;
+            }
+
+            overlap += topKOverlap( expected, actual );
+            maxProbabilityDifference =
+                std::max( maxProbabilityDifference,
+                          std::abs( expected.front( ).probability -
+                                    actual.front( ).probability ) );
+        }
+
+        const auto count = static_cast< double >( images.size( ) );
+
+        results.push_back( runBenchmark(
+            variant.name,
+            [ & ]( ) { classifier.classify( images.front( ), topK ); },
+            benchmarkParams ) );
+
+        std::cout << cv::format( "%-18s top 1 agreement %6.2f %%, top 5 "
+                                 "overlap %6.2f %%, max top 1 probability "
+                                 "difference %.4f",
+                                 variant.name.c_str( ),
+                                 100.0 * static_cast< double >( sameTop1 ) /
+                                     count,
+                                 100.0 * overlap / count,
+                                 static_cast< double >(
+                                     maxProbabilityDifference ) )
+                  << '\n';
+    }
+
+    for ( const auto& result : results )
+    {
+        printBenchmark( result, std::cout );
+    }
+
+    writeBenchmarkJson( results, RESULTS_ROOT + "/dnn_backend_benchmark.json" );
+
+    return 0;
+}
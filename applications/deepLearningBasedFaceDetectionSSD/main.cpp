@@ -1,3 +1,5 @@
+#include <BlobPreprocessing.h>
+#include <DnnBackend.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -8,6 +10,7 @@ IGNORE_WARNINGS_OPENCV_PUSH
 IGNORE_WARNINGS_POP
 
 // STD includes
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 
@@ -30,20 +33,30 @@ const std::string tensorflowConfigFile =
 const std::string tensorflowWeightFile =
     MODELS_ROOT + "/opencv_face_detector_uint8.pb";
 
+// face-detection-retail-0004 of the Open Model Zoo as OpenVINO IR quantized
+// to INT8. An SSD with the same input size and output layout, trained on BGR
+// input in 0..255 without mean subtraction.
+const std::string int8ConfigFile =
+    MODELS_ROOT +
+    "/face-detection-retail-0004/FP16-INT8/face-detection-retail-0004.xml";
+const std::string int8WeightFile =
+    MODELS_ROOT +
+    "/face-detection-retail-0004/FP16-INT8/face-detection-retail-0004.bin";
+
+// Same preprocessing as cv::dnn::blobFromImage( frame, inScaleFactor,
+// cv::Size( inWidth, inHeight ), meanVal, false, false ) in one pass
+BlobPreprocessor preprocessor( { cv::Size( inWidth, inHeight ),
+                                 inScaleFactor,
+                                 meanVal,
+                                 false } );
+
 void detectFaceOpenCVDNN( cv::dnn::Net net, cv::Mat& frameOpenCVDNN )
 {
     const int frameHeight = frameOpenCVDNN.rows;
     const int frameWidth = frameOpenCVDNN.cols;
-    const cv::Mat inputBlob =
-        cv::dnn::blobFromImage( frameOpenCVDNN,
-                                inScaleFactor,
-                                cv::Size( inWidth, inHeight ),
-                                meanVal,
-                                false,
-                                false );
-
-    net.setInput( inputBlob, "data" );
-    cv::Mat detection = net.forward( "detection_out" );
+    // The networks have a single input and end with the detection output
+    net.setInput( preprocessor.process( frameOpenCVDNN ) );
+    cv::Mat detection = net.forward( );
 
     cv::Mat detectionMat( detection.size[ 2 ],
                           detection.size[ 3 ],
@@ -81,15 +94,77 @@ void detectFaceOpenCVDNN( cv::dnn::Net net, cv::Mat& frameOpenCVDNN )
 
 #define CAFFE
 
-int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
+// Usage: deepLearningBasedFaceDetectionSSD [--backend opencv|fp16|openvino]
+//                                           [--int8]
+//
+// --int8 runs the INT8 quantized OpenVINO IR model of
+// face-detection-retail-0004 instead of the Caffe model (implies openvino).
+int main( int argc, char** argv )
 {
+    DnnBackend backend = DnnBackend::OpenCV;
+    bool int8 = false;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        const std::string arg = argv[ i ];
+
+        if ( arg == "--backend" && i + 1 < argc )
+        {
+            if ( ! parseDnnBackend( argv[ ++i ], backend ) )
+            {
+                std::cerr << "Unknown backend " << argv[ i ] << '\n';
+                return 1;
+            }
+        }
+        else if ( arg == "--int8" )
+        {
+            int8 = true;
+            backend = DnnBackend::OpenVino;
+        }
+    }
+
+    // The quantized model only runs on OpenVINO, there is no fallback
+    if ( int8 && ! isDnnBackendAvailable( DnnBackend::OpenVino ) )
+    {
+        std::cerr << "--int8 needs the openvino backend, which is not "
+                     "available\n";
+        return 1;
+    }
+
+    if ( int8 && ( ! std::filesystem::exists( int8ConfigFile ) ||
+                   ! std::filesystem::exists( int8WeightFile ) ) )
+    {
+        std::cerr << "INT8 model not found: " << int8ConfigFile << ", "
+                  << int8WeightFile << '\n';
+        return 1;
+    }
+
+    cv::dnn::Net net;
+
+    if ( int8 )
+    {
+        net = cv::dnn::readNet( int8ConfigFile, int8WeightFile );
+
+        // BGR input in 0..255 without a mean to subtract
+        BlobParams int8Params;
+        int8Params.size = cv::Size( inWidth, inHeight );
+        preprocessor = BlobPreprocessor( int8Params );
+    }
+    else
+    {
 #ifdef CAFFE
-    cv::dnn::Net net =
-        cv::dnn::readNetFromCaffe( caffeConfigFile, caffeWeightFile );
+        net = cv::dnn::readNetFromCaffe( caffeConfigFile, caffeWeightFile );
 #else
-    cv::dnn::Net net = cv::dnn::readNetFromTensorflow( tensorflowWeightFile,
-                                                       tensorflowConfigFile );
+        net = cv::dnn::readNetFromTensorflow( tensorflowWeightFile,
+                                              tensorflowConfigFile );
 #endif
+    }
+
+    if ( ! setDnnBackend( net, backend ) )
+    {
+        std::cerr << "Backend " << getDnnBackendName( backend )
+                  << " is not available, using opencv\n";
+    }
 
     cv::Mat img = cv::imread( IMAGES_ROOT + "/man.jpg" );
     detectFaceOpenCVDNN( net, img );
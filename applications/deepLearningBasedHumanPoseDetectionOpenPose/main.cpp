@@ -1,5 +1,6 @@
 #include <GUI.h>
 #include <macros.h>
+#include <PoseDecoding.h>
 
 // OpenCV includes
 IGNORE_WARNINGS_OPENCV_PUSH
@@ -15,22 +16,28 @@ const std::string IMAGES_ROOT = "C:/images";
 const std::string MODELS_ROOT = "C:/images/models";
 const std::string RESULTS_ROOT = "C:/images/results";
 
-int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
+// Usage: deepLearningBasedHumanPoseDetectionOpenPose [image] [--headless]
+//
+// Headless mode skips all windows and the display of the probability maps,
+// prints the poses and writes the result to RESULTS_ROOT.
+int main( int argc, char** argv )
 {
-    const int POSE_PAIRS[ 14 ][ 2 ] = { { 0, 1 },
-                                        { 1, 2 },
-                                        { 2, 3 },
-                                        { 3, 4 },
-                                        { 1, 5 },
-                                        { 5, 6 },
-                                        { 6, 7 },
-                                        { 1, 14 },
-                                        { 14, 8 },
-                                        { 8, 9 },
-                                        { 9, 10 },
-                                        { 14, 11 },
-                                        { 11, 12 },
-                                        { 12, 13 } };
+    std::string imagePath = IMAGES_ROOT + "/man.jpg";
+    bool headless = false;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        const std::string arg = argv[ i ];
+
+        if ( arg == "--headless" )
+        {
+            headless = true;
+        }
+        else
+        {
+            imagePath = arg;
+        }
+    }
 
     //
     // Load a Caffe Model
@@ -38,16 +45,26 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     std::string protoFile = MODELS_ROOT + "/mpi.prototxt";
     std::string weightsFile = MODELS_ROOT + "/pose_iter_160000.caffemodel";
 
-    int nPoints = 15;
+    const PoseModel model = getMpiPoseModel( );
+    int nPoints = model.keypointCount;
     cv::dnn::Net net = cv::dnn::readNetFromCaffe( protoFile, weightsFile );
 
     //
     // Read Image
     //
-    cv::Mat img = cv::imread( IMAGES_ROOT + "/man.jpg" );
+    cv::Mat img = cv::imread( imagePath );
+    if ( img.empty( ) )
+    {
+        std::cerr << "Could not read " << imagePath << '\n';
+        return 1;
+    }
+
     cv::Mat imgOrig = img.clone( );
     cv::cvtColor( img, img, cv::COLOR_BGR2RGB );
-    showMat( imgOrig, "Man", true );
+    if ( ! headless )
+    {
+        showMat( imgOrig, "Input", true );
+    }
     int inWidth = img.cols;
     int inHeight = img.rows;
 
@@ -69,7 +86,7 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     int W = output.size[ 3 ];
 
     // Display probability maps
-    for ( int i = 0; i < nPoints; i++ )
+    for ( int i = 0; i < nPoints && ! headless; i++ )
     {
         cv::Mat probMap( H, W, CV_32F, output.ptr( 0, i ) );
         cv::Mat displayMap;
@@ -84,71 +101,94 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     //
     // Extract points
     //
-    float thresh = 0.1f;
-    int frameWidth = img.cols;
-    int frameHeight = img.rows;
+    // All peaks of every heatmap, refined to sub-pixel positions, and the
+    // persons grouped by the part affinity fields
+    //
+    PoseDecoderParams params;
+    params.peakThreshold = 0.1f;
 
-    cv::Mat frameCopy = imgOrig.clone( );
+    // The peaks of all keypoints come out of the same pass as the poses
+    std::vector< std::vector< PoseKeypoint > > peaks;
+    const auto poses =
+        decodePoses( output, model, img.size( ), params, &peaks );
 
-    // find the position of the body parts
-    std::vector< cv::Point > points( static_cast< size_t >( nPoints ) );
+    cv::Mat frameCopy = imgOrig.clone( );
 
     for ( int n = 0; n < nPoints; n++ )
     {
-        // Probability map of corresponding body's part.
-        cv::Mat probMap( H, W, CV_32F, output.ptr( 0, n ) );
-
-        cv::Point2f p( -1, -1 );
-        cv::Point maxLoc;
-        double prob;
-        minMaxLoc( probMap, 0, &prob, 0, &maxLoc );
-        if ( prob > thresh )
+        for ( const auto& peak : peaks[ static_cast< size_t >( n ) ] )
         {
-            p = maxLoc;
-            p.x *=
-                static_cast< float >( frameWidth ) / static_cast< float >( W );
-            p.y *=
-                static_cast< float >( frameHeight ) / static_cast< float >( H );
-
-            cv::circle( frameCopy,
-                        cv::Point( static_cast< int >( p.x ),
-                                   static_cast< int >( p.y ) ),
-                        8,
-                        cv::Scalar( 0, 255, 255 ),
-                        -1 );
+            const cv::Point p( cvRound( peak.position.x ),
+                               cvRound( peak.position.y ) );
+
+            cv::circle( frameCopy, p, 8, cv::Scalar( 0, 255, 255 ), -1 );
             cv::putText( frameCopy,
                          cv::format( "%d", n ),
-                         cv::Point( static_cast< int >( p.x ),
-                                    static_cast< int >( p.y ) ),
+                         p,
                          cv::FONT_HERSHEY_COMPLEX,
                          1,
                          cv::Scalar( 0, 0, 255 ),
                          2 );
         }
-        points[ static_cast< size_t >( n ) ] = p;
     }
 
     //
     // Display Points & Skeleton
     //
-    int nPairs = static_cast< int >( std::size( POSE_PAIRS ) );
-
-    for ( int n = 0; n < nPairs; n++ )
+    for ( size_t i = 0; i < poses.size( ); i++ )
     {
-        // lookup 2 connected body/hand parts
-        cv::Point2f partA =
-            points[ static_cast< size_t >( POSE_PAIRS[ n ][ 0 ] ) ];
-        cv::Point2f partB =
-            points[ static_cast< size_t >( POSE_PAIRS[ n ][ 1 ] ) ];
+        const auto& keypoints = poses[ i ].keypoints;
+
+        // One hue per person
+        cv::Mat hsv( 1,
+                     1,
+                     CV_8UC3,
+                     cv::Scalar( static_cast< double >( i * 37 % 180 ),
+                                 255,
+                                 255 ) );
+        cv::Mat bgr;
+        cv::cvtColor( hsv, bgr, cv::COLOR_HSV2BGR );
+        const cv::Vec3b color = bgr.at< cv::Vec3b >( 0, 0 );
+        const cv::Scalar limbColor( color[ 0 ], color[ 1 ], color[ 2 ] );
+
+        for ( const auto& [ a, b ] : model.limbs )
+        {
+            // lookup 2 connected body/hand parts
+            const auto& partA = keypoints[ static_cast< size_t >( a ) ];
+            const auto& partB = keypoints[ static_cast< size_t >( b ) ];
+
+            if ( partA.confidence <= 0 || partB.confidence <= 0 )
+            {
+                continue;
+            }
+
+            line( imgOrig, partA.position, partB.position, limbColor, 8 );
+            cv::circle(
+                imgOrig, partA.position, 8, cv::Scalar( 0, 0, 255 ), -1 );
+            cv::circle(
+                imgOrig, partB.position, 8, cv::Scalar( 0, 0, 255 ), -1 );
+        }
 
-        if ( partA.x <= 0 || partA.y <= 0 || partB.x <= 0 || partB.y <= 0 )
+        if ( headless )
         {
-            continue;
+            std::cout << "Person " << i << " score " << poses[ i ].score
+                      << '\n';
+
+            for ( size_t k = 0; k < keypoints.size( ); k++ )
+            {
+                if ( keypoints[ k ].confidence > 0 )
+                {
+                    std::cout << "  " << k << ": " << keypoints[ k ].position
+                              << " " << keypoints[ k ].confidence << '\n';
+                }
+            }
         }
+    }
 
-        line( imgOrig, partA, partB, cv::Scalar( 0, 255, 255 ), 8 );
-        cv::circle( imgOrig, partA, 8, cv::Scalar( 0, 0, 255 ), -1 );
-        cv::circle( imgOrig, partB, 8, cv::Scalar( 0, 0, 255 ), -1 );
+    if ( headless )
+    {
+        cv::imwrite( RESULTS_ROOT + "/pose.jpg", imgOrig );
+        return 0;
     }
 
     showMat( frameCopy, "Points", false );
@@ -158,4 +198,4 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     cv::destroyAllWindows( );
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,4 +1,6 @@
+#include <DnnBackend.h>
 #include <GUI.h>
+#include <ImageClassifier.h>
 #include <macros.h>
 
 // OpenCV includes
@@ -8,137 +10,261 @@ IGNORE_WARNINGS_OPENCV_PUSH
 IGNORE_WARNINGS_POP
 
 // STD includes
-#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
 
 const std::string IMAGES_ROOT = "C:/images";
 const std::string MODELS_ROOT = "C:/images/models";
 const std::string RESULTS_ROOT = "C:/images/results";
 
-int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
+constexpr int32_t topK = 5;
+constexpr int32_t batchSize = 16;
+
+// GoogLeNet as OpenVINO IR quantized to INT8, layout of the Open Model Zoo
+const std::string int8ModelFile =
+    MODELS_ROOT + "/googlenet-v1/FP16-INT8/googlenet-v1.xml";
+const std::string int8WeightFile =
+    MODELS_ROOT + "/googlenet-v1/FP16-INT8/googlenet-v1.bin";
+
+ImageClassifier createCaffeClassifier( DnnBackend backend, bool int8 )
 {
     //
     // Using Caffe models
     //
-
     std::string protoFile = MODELS_ROOT + "/bvlc_googlenet.prototxt";
     std::string weightFile = MODELS_ROOT + "/bvlc_googlenet.caffemodel";
-    std::string filename = IMAGES_ROOT + "/panda.jpg";
-
-    cv::Mat frame = cv::imread( filename );
-
-    std::vector< std::string > classes;
-
     std::string classFile =
         MODELS_ROOT + "/classification_classes_ILSVRC2012.txt";
-    std::ifstream ifs( classFile.c_str( ) );
-    std::string line;
 
-    while ( std::getline( ifs, line ) )
-    {
-        classes.push_back( line );
-    }
-
-    float scale = 1.0;
-    int inHeight = 224;
-    int inWidth = 224;
-    bool swapRB = false;
+    ClassifierParams params;
+    params.scale = 1.0;
+    params.inputSize = cv::Size( 224, 224 );
+    params.swapRB = false;
     // The mean that will be subtracted should be defined in the paper of the
     // network
-    cv::Scalar mean = cv::Scalar( 104, 117, 123 );
+    params.mean = cv::Scalar( 104, 117, 123 );
+    params.batchSize = batchSize;
 
     //! [Read and initialize network]
-    cv::dnn::Net net = cv::dnn::readNetFromCaffe( protoFile, weightFile );
-
-    // Process frames.
-    cv::Mat blob;
-    //! [Create a 4D blob from a frame]
-    cv::dnn::blobFromImage( frame,
-                            blob,
-                            scale,
-                            cv::Size( inWidth, inHeight ),
-                            mean,
-                            swapRB,
-                            false );
-
-    //! [Set input blob]
-    net.setInput( blob );
-
-    //! [Make forward pass]
-    cv::Mat prob = net.forward( );
-
-    //! [Get a class with a highest score]
-    cv::Point classIdPoint;
-    double confidence;
-    cv::minMaxLoc( prob.reshape( 1, 1 ), 0, &confidence, 0, &classIdPoint );
-    int classId = classIdPoint.x;
-
-    // Print predicted class.
-    std::string label =
-        cv::format( "Predicted Class : %s, confidence : %.3f",
-                    classes[ static_cast< size_t >( classId ) ].c_str( ),
-                    confidence );
-
-    std::cout << label << '\n';
+    cv::dnn::Net net;
 
-    showMat( frame, "Panda", true );
+    if ( int8 )
+    {
+        // The same network converted to OpenVINO IR and quantized to INT8.
+        // The Model Optimizer folded the mean into the model.
+        net = cv::dnn::readNet( int8ModelFile, int8WeightFile );
+        params.mean = cv::Scalar( 0, 0, 0 );
+    }
+    else
+    {
+        net = cv::dnn::readNetFromCaffe( protoFile, weightFile );
+    }
+
+    if ( ! setDnnBackend( net, backend ) )
+    {
+        std::cerr << "Backend " << getDnnBackendName( backend )
+                  << " is not available, using opencv\n";
+    }
 
+    return ImageClassifier( net, classFile, params );
+}
+
+ImageClassifier createTensorflowClassifier( DnnBackend backend )
+{
     //
     // Using Tensorflow models
     //
+    std::string weightFile = MODELS_ROOT + "/tensorflow_inception_graph.pb";
+    std::string classFile =
+        MODELS_ROOT + "/imagenet_comp_graph_label_strings.txt";
 
-    weightFile = MODELS_ROOT + "/tensorflow_inception_graph.pb";
+    ClassifierParams params;
+    params.scale = 1.0;
+    params.inputSize = cv::Size( 224, 224 );
+    params.swapRB = true;
+    params.mean = cv::Scalar( 117, 117, 117 );
 
-    float scale2 = 1.0;
-    int inHeight2 = 224;
-    int inWidth2 = 224;
-    bool swapRB2 = true;
-    cv::Scalar mean2 = cv::Scalar( 117, 117, 117 );
+    //! [Read and initialize network]
+    cv::dnn::Net net = cv::dnn::readNetFromTensorflow( weightFile );
+    setDnnBackend( net, backend );
 
-    std::vector< std::string > classes2;
+    return ImageClassifier( net, classFile, params );
+}
 
-    std::string classFile2 =
-        MODELS_ROOT + "/imagenet_comp_graph_label_strings.txt";
-    std::ifstream ifs2( classFile2.c_str( ) );
-    std::string line2;
-    while ( getline( ifs2, line2 ) )
+void printClassification( const ImageClassifier& classifier,
+                          const std::vector< Classification >& top )
+{
+    for ( const auto& [ classId, probability ] : top )
     {
-        classes2.push_back( line2 );
+        std::cout << cv::format( "    %-40s %.3f",
+                                 classifier.getLabel( classId ).c_str( ),
+                                 probability )
+                  << '\n';
     }
+}
 
-    //! [Read and initialize network]
-    cv::dnn::Net net2 = cv::dnn::readNetFromTensorflow( weightFile );
+// Classify every .jpg and .png in directory in batches and report the
+// throughput. Only one batch of images is held in memory.
+int classifyDirectory( ImageClassifier& classifier,
+                       const std::string& directory )
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector< std::string > files;
+    for ( const auto& entry :
+          std::filesystem::directory_iterator( directory ) )
+    {
+        const auto extension = entry.path( ).extension( );
+        if ( entry.is_regular_file( ) &&
+             ( extension == ".jpg" || extension == ".png" ) )
+        {
+            files.push_back( entry.path( ).string( ) );
+        }
+    }
+
+    if ( files.empty( ) )
+    {
+        std::cerr << "No images in " << directory << '\n';
+        return 1;
+    }
+
+    const auto chunk = static_cast< size_t >( batchSize );
+
+    std::vector< cv::Mat > images;
+    std::vector< std::string > names;
+    size_t classified = 0;
+    double inferenceSeconds = 0.0;
+
+    const auto start = Clock::now( );
+
+    for ( size_t first = 0; first < files.size( ); first += chunk )
+    {
+        images.clear( );
+        names.clear( );
+
+        const size_t last = std::min( first + chunk, files.size( ) );
+
+        for ( size_t i = first; i < last; i++ )
+        {
+            cv::Mat image = cv::imread( files[ i ] );
+            if ( image.empty( ) )
+            {
+                std::cerr << "Could not read " << files[ i ] << '\n';
+                continue;
+            }
+
+            images.push_back( image );
+            names.push_back( files[ i ] );
+        }
+
+        const auto inferenceStart = Clock::now( );
+        const auto results = classifier.classifyBatch( images, topK );
+        inferenceSeconds += std::chrono::duration< double >(
+                                Clock::now( ) - inferenceStart )
+                                .count( );
+
+        for ( size_t i = 0; i < results.size( ); i++ )
+        {
+            std::cout << names[ i ] << '\n';
+            printClassification( classifier, results[ i ] );
+        }
+
+        classified += results.size( );
+    }
+
+    const double totalSeconds =
+        std::chrono::duration< double >( Clock::now( ) - start ).count( );
+
+    std::cout << cv::format(
+                     "Classified %zu images in %.2f s: %.1f images/s overall, "
+                     "%.1f images/s inference (batch size %d)",
+                     classified,
+                     totalSeconds,
+                     static_cast< double >( classified ) / totalSeconds,
+                     static_cast< double >( classified ) / inferenceSeconds,
+                     batchSize )
+              << '\n';
+
+    return 0;
+}
+
+// Usage: deepLearningBasedImageClassification [--backend <name>] [--int8]
+//                                             [directory]
+//
+// Without a directory panda.jpg is classified by both networks. With a
+// directory all its images are classified by GoogLeNet in batches.
+//
+// --backend selects opencv (default), fp16 or openvino for both networks,
+// --int8 runs the INT8 quantized OpenVINO IR model of GoogLeNet instead of
+// the Caffe model (implies openvino).
+int main( int argc, char** argv )
+{
+    DnnBackend backend = DnnBackend::OpenCV;
+    bool int8 = false;
+    std::string directory;
 
-    // Process frames.
-    cv::Mat blob2;
-    //! [Create a 4D blob from a frame]
-    cv::dnn::blobFromImage( frame,
-                            blob2,
-                            scale2,
-                            cv::Size( inWidth2, inHeight2 ),
-                            mean2,
-                            swapRB2,
-                            false );
+    for ( int i = 1; i < argc; i++ )
+    {
+        const std::string arg = argv[ i ];
+
+        if ( arg == "--backend" && i + 1 < argc )
+        {
+            if ( ! parseDnnBackend( argv[ ++i ], backend ) )
+            {
+                std::cerr << "Unknown backend " << argv[ i ] << '\n';
+                return 1;
+            }
+        }
+        else if ( arg == "--int8" )
+        {
+            int8 = true;
+            backend = DnnBackend::OpenVino;
+        }
+        else
+        {
+            directory = arg;
+        }
+    }
 
-    //! [Set input blob]
-    net2.setInput( blob2 );
+    // The quantized model only runs on OpenVINO, there is no fallback
+    if ( int8 && ! isDnnBackendAvailable( DnnBackend::OpenVino ) )
+    {
+        std::cerr << "--int8 needs the openvino backend, which is not "
+                     "available\n";
+        return 1;
+    }
 
-    //! [Make forward pass]
+    if ( int8 && ( ! std::filesystem::exists( int8ModelFile ) ||
+                   ! std::filesystem::exists( int8WeightFile ) ) )
+    {
+        std::cerr << "INT8 model not found: " << int8ModelFile << ", "
+                  << int8WeightFile << '\n';
+        return 1;
+    }
 
-    cv::Mat prob2 = net2.forward( );
+    ImageClassifier classifier = createCaffeClassifier( backend, int8 );
 
-    //! [Get a class with a highest score]
-    cv::Point classIdPoint2;
-    double confidence2;
-    cv::minMaxLoc( prob2.reshape( 1, 1 ), 0, &confidence2, 0, &classIdPoint2 );
-    int classId2 = classIdPoint2.x;
+    if ( ! directory.empty( ) )
+    {
+        return classifyDirectory( classifier, directory );
+    }
+
+    std::string filename = IMAGES_ROOT + "/panda.jpg";
+
+    cv::Mat frame = cv::imread( filename );
+
+    //! [Get the classes with the highest scores]
+    std::cout << "Predicted classes (Caffe):" << '\n';
+    printClassification( classifier, classifier.classify( frame, topK ) );
+
+    showMat( frame, "Panda", true );
 
-    // Print predicted class.
-    label = cv::format( "Predicted Class : %s, confidence : %.3f",
-                        classes2[ static_cast< size_t >( classId2 ) ].c_str( ),
-                        confidence2 );
+    ImageClassifier classifier2 = createTensorflowClassifier( backend );
 
-    std::cout << label << '\n';
+    std::cout << "Predicted classes (Tensorflow):" << '\n';
+    printClassification( classifier2, classifier2.classify( frame, topK ) );
 
     showMat( frame, "Panda", true );
 
@@ -146,4 +272,4 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     cv::destroyAllWindows( );
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,3 +1,6 @@
+#include <Benchmark.h>
+#include <BlobPreprocessing.h>
+#include <DnnBackend.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -8,6 +11,7 @@ IGNORE_WARNINGS_OPENCV_PUSH
 IGNORE_WARNINGS_POP
 
 // STD includes
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 
@@ -22,18 +26,29 @@ constexpr float confidenceThreshold = 0.7f;
 const cv::Scalar meanVal( 127.5, 127.5, 127.5 );
 std::vector< std::string > classes;
 
+// ssd_mobilenet_v2_coco of the Open Model Zoo as OpenVINO IR quantized to
+// INT8. The Model Optimizer folded the channel swap, mean and scale into the
+// model, so it takes BGR input in 0..255. Classes and output layout are those
+// of the Tensorflow model.
+const std::string int8ConfigFile =
+    MODELS_ROOT + "/ssd_mobilenet_v2_coco/FP16-INT8/ssd_mobilenet_v2_coco.xml";
+const std::string int8WeightFile =
+    MODELS_ROOT + "/ssd_mobilenet_v2_coco/FP16-INT8/ssd_mobilenet_v2_coco.bin";
+
+// Same preprocessing as cv::dnn::blobFromImage( frame, inScaleFactor,
+// cv::Size( inWidth, inHeight ), meanVal, true, false ) in one pass
+BlobPreprocessor preprocessor( { cv::Size( inWidth, inHeight ),
+                                 inScaleFactor,
+                                 meanVal,
+                                 true } );
+
 // Detect Objects
 cv::Mat detect_objects( cv::dnn::Net net, const cv::Mat& frame )
 {
-    const cv::Mat inputBlob =
-        cv::dnn::blobFromImage( frame,
-                                inScaleFactor,
-                                cv::Size( inWidth, inHeight ),
-                                meanVal,
-                                true,
-                                false );
-    net.setInput( inputBlob );
-    cv::Mat detection = net.forward( "detection_out" );
+    net.setInput( preprocessor.process( frame ) );
+
+    // Both networks end with the detection output, named differently
+    cv::Mat detection = net.forward( );
     cv::Mat detectionMat( detection.size[ 2 ],
                           detection.size[ 3 ],
                           CV_32F,
@@ -103,8 +118,130 @@ void display_objects( cv::Mat& img, cv::Mat objects, float threshold = 0.25 )
     }
 }
 
-int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
+// Compare BlobPreprocessor with cv::dnn::blobFromImage on an image
+void benchmarkPreprocessing( const cv::Mat& img )
+{
+    const cv::Mat reference =
+        cv::dnn::blobFromImage( img,
+                                inScaleFactor,
+                                cv::Size( inWidth, inHeight ),
+                                meanVal,
+                                true,
+                                false );
+    const cv::Mat fused = preprocessor.process( img ).clone( );
+
+    // Maximum difference in intensity levels before scaling
+    const double maxDifference =
+        cv::norm( reference, fused, cv::NORM_INF ) / inScaleFactor;
+    std::cout << "Maximum difference to blobFromImage: " << maxDifference
+              << " levels\n";
+
+    BlobParams params;
+    params.scale = inScaleFactor;
+    params.mean = meanVal;
+    params.swapRB = true;
+
+    BenchmarkParams benchmarkParams;
+    benchmarkParams.iterations = 100;
+    benchmarkParams.perfCounters = true;
+
+    std::vector< BenchmarkResult > results;
+    cv::Mat blob;
+
+    // The SSD input and a typical classification input
+    for ( const cv::Size size : { cv::Size( 300, 300 ), cv::Size( 224, 224 ) } )
+    {
+        params.size = size;
+        BlobPreprocessor sized( params );
+
+        benchmarkParams.pixelsPerIteration =
+            static_cast< int64_t >( size.area( ) );
+
+        const std::string suffix = " " + std::to_string( size.width ) + "x" +
+                                   std::to_string( size.height );
+
+        results.push_back( runBenchmark(
+            "cv::dnn::blobFromImage" + suffix,
+            [ & ]( ) {
+                cv::dnn::blobFromImage(
+                    img, blob, inScaleFactor, size, meanVal, true, false );
+            },
+            benchmarkParams ) );
+        results.push_back( runBenchmark(
+            "BlobPreprocessor" + suffix,
+            [ & ]( ) { sized.process( img ); },
+            benchmarkParams ) );
+    }
+
+    for ( const auto& result : results )
+    {
+        printBenchmark( result, std::cout );
+    }
+
+    writeBenchmarkJson( results,
+                        RESULTS_ROOT + "/preprocessing_benchmark.json" );
+}
+
+// Usage: deepLearningBasedObjectDetectionSSD [--benchmark]
+//                                            [--backend opencv|fp16|openvino]
+//                                            [--int8]
+//
+// --int8 runs the INT8 quantized OpenVINO IR model of ssd_mobilenet_v2_coco
+// instead of the Tensorflow model (implies openvino).
+int main( int argc, char** argv )
 {
+    DnnBackend backend = DnnBackend::OpenCV;
+    bool int8 = false;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        const std::string arg = argv[ i ];
+
+        if ( arg == "--benchmark" )
+        {
+            const std::string imagePath = IMAGES_ROOT + "/street.jpg";
+            const cv::Mat img = cv::imread( imagePath );
+
+            if ( img.empty( ) )
+            {
+                std::cerr << "Could not read " << imagePath << '\n';
+                return 1;
+            }
+
+            benchmarkPreprocessing( img );
+            return 0;
+        }
+
+        if ( arg == "--backend" && i + 1 < argc &&
+             ! parseDnnBackend( argv[ ++i ], backend ) )
+        {
+            std::cerr << "Unknown backend " << argv[ i ] << '\n';
+            return 1;
+        }
+
+        if ( arg == "--int8" )
+        {
+            int8 = true;
+            backend = DnnBackend::OpenVino;
+        }
+    }
+
+    // The quantized model only runs on OpenVINO, there is no fallback
+    if ( int8 && ! isDnnBackendAvailable( DnnBackend::OpenVino ) )
+    {
+        std::cerr << "--int8 needs the openvino backend, which is not "
+                     "available\n";
+        return 1;
+    }
+
+    if ( int8 && ( ! std::filesystem::exists( int8ConfigFile ) ||
+                   ! std::filesystem::exists( int8WeightFile ) ) )
+    {
+        std::cerr << "INT8 model not found: " << int8ConfigFile << ", "
+                  << int8WeightFile << '\n';
+        return 1;
+    }
+
     //
     // Single Shot Multibox Detector
     //
@@ -118,10 +255,29 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     const std::string classFile = MODELS_ROOT + "/coco_class_labels.txt";
 
     //
-    // Read Tensorflow Model
+    // Read Tensorflow or INT8 OpenVINO IR Model
     //
 
-    cv::dnn::Net net = cv::dnn::readNetFromTensorflow( modelFile, configFile );
+    cv::dnn::Net net;
+
+    if ( int8 )
+    {
+        net = cv::dnn::readNet( int8ConfigFile, int8WeightFile );
+
+        BlobParams int8Params;
+        int8Params.size = cv::Size( inWidth, inHeight );
+        preprocessor = BlobPreprocessor( int8Params );
+    }
+    else
+    {
+        net = cv::dnn::readNetFromTensorflow( modelFile, configFile );
+    }
+
+    if ( ! setDnnBackend( net, backend ) )
+    {
+        std::cerr << "Backend " << getDnnBackendName( backend )
+                  << " is not available, using opencv\n";
+    }
 
     //
     // Check Class Labels
@@ -1,3 +1,4 @@
+#include <DnnBackend.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -8,6 +9,8 @@ IGNORE_WARNINGS_OPENCV_PUSH
 IGNORE_WARNINGS_POP
 
 // STD includes
+#include <cmath>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 
@@ -23,6 +26,83 @@ int inpWidth = 416;               // Width of network's input image
 int inpHeight = 416;              // Height of network's input image
 std::vector< std::string > classes;
 
+// yolo-v3-tf of the Open Model Zoo as OpenVINO IR quantized to INT8. The
+// Model Optimizer folded the channel swap and the scale into the model, so it
+// takes BGR input in 0..255. It outputs the RegionYolo maps of the three
+// scales instead of decoded detections, see decodeYoloRegions( ).
+const std::string int8ConfigFile =
+    MODELS_ROOT + "/yolo-v3-tf/FP16-INT8/yolo-v3-tf.xml";
+const std::string int8WeightFile =
+    MODELS_ROOT + "/yolo-v3-tf/FP16-INT8/yolo-v3-tf.bin";
+
+// YOLOv3 anchors ( width, height ) in input pixels, three per output scale
+// from the coarsest ( stride 32 ) to the finest ( stride 8 )
+const float yoloAnchors[ 3 ][ 6 ] = { { 116, 90, 156, 198, 373, 326 },
+                                      { 30, 61, 62, 45, 59, 119 },
+                                      { 10, 13, 16, 30, 33, 23 } };
+
+// Convert RegionYolo maps of shape 1 x ( 3 * ( 5 + classes ) ) x h x w, with
+// the logistic already applied to box centers, objectness and class scores,
+// into the rows the Darknet region layer outputs: center, width and height
+// relative to the image, objectness and per class the objectness times the
+// class score. postprocess( ) then handles both networks.
+std::vector< cv::Mat > decodeYoloRegions( const std::vector< cv::Mat >& maps )
+{
+    std::vector< cv::Mat > outs;
+
+    for ( const auto& map : maps )
+    {
+        CV_Assert( map.dims == 4 && map.size[ 1 ] % 3 == 0 );
+
+        const int entries = map.size[ 1 ] / 3;
+        const int gridHeight = map.size[ 2 ];
+        const int gridWidth = map.size[ 3 ];
+        const int area = gridWidth * gridHeight;
+
+        const int stride = inpWidth / gridWidth;
+        const auto* anchors =
+            yoloAnchors[ stride == 32 ? 0 : ( stride == 16 ? 1 : 2 ) ];
+
+        cv::Mat out( 3 * area, entries, CV_32F );
+
+        for ( int a = 0; a < 3; a++ )
+        {
+            const float* anchorData = map.ptr< float >( ) + a * entries * area;
+
+            for ( int cell = 0; cell < area; cell++ )
+            {
+                const auto entry = [ & ]( int e ) {
+                    return anchorData[ e * area + cell ];
+                };
+
+                float* row = out.ptr< float >( a * area + cell );
+                const float objectness = entry( 4 );
+
+                row[ 0 ] = ( static_cast< float >( cell % gridWidth ) +
+                             entry( 0 ) ) /
+                           static_cast< float >( gridWidth );
+                row[ 1 ] = ( static_cast< float >( cell / gridWidth ) +
+                             entry( 1 ) ) /
+                           static_cast< float >( gridHeight );
+                row[ 2 ] = std::exp( entry( 2 ) ) * anchors[ 2 * a ] /
+                           static_cast< float >( inpWidth );
+                row[ 3 ] = std::exp( entry( 3 ) ) * anchors[ 2 * a + 1 ] /
+                           static_cast< float >( inpHeight );
+                row[ 4 ] = objectness;
+
+                for ( int c = 5; c < entries; c++ )
+                {
+                    row[ c ] = objectness * entry( c );
+                }
+            }
+        }
+
+        outs.push_back( out );
+    }
+
+    return outs;
+}
+
 // Get the names of the output layers
 auto getOutputsNames( const cv::dnn::Net& net )
 {
@@ -164,8 +244,51 @@ void postprocess( cv::Mat& frame, const std::vector< cv::Mat >& outs )
     }
 }
 
-int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
+// Usage: deepLearningBasedObjectDetectionYolo [--backend opencv|fp16|openvino]
+//                                             [--int8]
+//
+// --int8 runs the INT8 quantized OpenVINO IR model of yolo-v3-tf instead of
+// the Darknet model (implies openvino).
+int main( int argc, char** argv )
 {
+    DnnBackend backend = DnnBackend::OpenCV;
+    bool int8 = false;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        const std::string arg = argv[ i ];
+
+        if ( arg == "--backend" && i + 1 < argc )
+        {
+            if ( ! parseDnnBackend( argv[ ++i ], backend ) )
+            {
+                std::cerr << "Unknown backend " << argv[ i ] << '\n';
+                return 1;
+            }
+        }
+        else if ( arg == "--int8" )
+        {
+            int8 = true;
+            backend = DnnBackend::OpenVino;
+        }
+    }
+
+    // The quantized model only runs on OpenVINO, there is no fallback
+    if ( int8 && ! isDnnBackendAvailable( DnnBackend::OpenVino ) )
+    {
+        std::cerr << "--int8 needs the openvino backend, which is not "
+                     "available\n";
+        return 1;
+    }
+
+    if ( int8 && ( ! std::filesystem::exists( int8ConfigFile ) ||
+                   ! std::filesystem::exists( int8WeightFile ) ) )
+    {
+        std::cerr << "INT8 model not found: " << int8ConfigFile << ", "
+                  << int8WeightFile << '\n';
+        return 1;
+    }
+
     // Load names of classes
     const std::string classesFile = MODELS_ROOT + "/coco.names";
     std::ifstream ifs( classesFile.c_str( ) );
@@ -182,19 +305,27 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
 
     // Load the network
     cv::dnn::Net net =
-        cv::dnn::readNetFromDarknet( modelConfiguration, modelWeights );
+        int8 ? cv::dnn::readNet( int8ConfigFile, int8WeightFile )
+             : cv::dnn::readNetFromDarknet( modelConfiguration, modelWeights );
+
+    if ( ! setDnnBackend( net, backend ) )
+    {
+        std::cerr << "Backend " << getDnnBackendName( backend )
+                  << " is not available, using opencv\n";
+    }
 
     std::string imagePath = IMAGES_ROOT + "/bird.jpg";
     cv::Mat frame = cv::imread( imagePath );
 
-    // Create a 4D blob from a frame.
+    // Create a 4D blob from a frame. The INT8 model scales and swaps the
+    // channels itself.
     cv::Mat blob;
     cv::dnn::blobFromImage( frame,
                             blob,
-                            1 / 255.0,
+                            int8 ? 1.0 : 1 / 255.0,
                             cv::Size( inpWidth, inpHeight ),
                             cv::Scalar( 0, 0, 0 ),
-                            true,
+                            ! int8,
                             false );
 
     // Sets the input to the network
@@ -204,6 +335,11 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     std::vector< cv::Mat > outs;
     net.forward( outs, getOutputsNames( net ) );
 
+    if ( int8 )
+    {
+        outs = decodeYoloRegions( outs );
+    }
+
     // Remove the bounding boxes with low confidence
     postprocess( frame, outs );
 
@@ -126,9 +126,7 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
 
     cv::Rect currWindow = initialRect;
 
-    cv::namedWindow( windowName );
-    cv::imshow( windowName, frame );
-    cv::waitKey( 250 );
+    showMat( frame, windowName, false, 1, 250 );
 
     while ( true )
     {
@@ -217,8 +215,7 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
                      cv::Scalar( 50, 170, 50 ),
                      2 );
 
-        cv::imshow( windowName, frame );
-        cv::waitKey( waitTime );
+        showMat( frame, windowName, false, 1, waitTime );
     }
 
     // Clean up
@@ -1,5 +1,6 @@
 #include <GUI.h>
 #include <macros.h>
+#include <PoissonBlending.h>
 
 // OpenCV includes
 IGNORE_WARNINGS_OPENCV_PUSH
@@ -70,13 +71,16 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     cv::Point center( static_cast< int >( m.m01 / m.m00 ),
                       static_cast< int >( m.m10 / m.m00 ) );
 
-    // Clone seamlessly
-    cv::Mat output_clone;
+    // Clone seamlessly, the Poisson equation is only solved on the bounding
+    // box of the mask
     src.convertTo( src, CV_8UC3 );
     dst.convertTo( dst, CV_8UC3 );
     src_mask.convertTo( src_mask, CV_8UC3 );
-    cv::seamlessClone( src, dst, src_mask, center, output_clone, cv::NORMAL_CLONE );
-    output_clone.convertTo( output_clone, CV_8UC3 );
+
+    cv::Mat output_clone = dst.clone( );
+    PoissonBlender blender;
+    blender.seamlessClone(
+        src, output_clone, src_mask, center, cv::NORMAL_CLONE );
 
     showMat( output_clone, "Obama cloned Trump", true );
 
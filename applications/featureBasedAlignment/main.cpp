@@ -1,3 +1,4 @@
+#include <FeatureMatching.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -95,23 +96,18 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     //
     // Step 3: Match Features - 6 Marks
     //
-    // Set up the matcher
-    cv::Ptr< cv::DescriptorMatcher > matcher =
-        cv::DescriptorMatcher::create( "BruteForce-Hamming" );
+    // Set up the matcher. Only the best GOOD_MATCH_PERCENT matches are kept,
+    // they are selected with a partial sort.
+    FeatureMatchingParams matchingParams;
+    matchingParams.goodMatchPercent = GOOD_MATCH_PERCENT;
 
     // Find Matches or Corresponding points
-    std::vector< cv::DMatch > matchesBlueGreen;
-    matcher->match(
-        descriptorsBlue, descriptorsGreen, matchesBlueGreen, cv::Mat( ) );
-
-    // Sort matches by score
-    std::sort( matchesBlueGreen.begin( ), matchesBlueGreen.end( ) );
-
-    // Remove not so good matches
-    int numGoodMatches = static_cast< int >(
-        static_cast< float >( matchesBlueGreen.size( ) ) * GOOD_MATCH_PERCENT );
-    matchesBlueGreen.erase( matchesBlueGreen.begin( ) + numGoodMatches,
-                            matchesBlueGreen.end( ) );
+    const FeatureMatches blueGreen = matchFeatures( keypointsBlue,
+                                                    descriptorsBlue,
+                                                    keypointsGreen,
+                                                    descriptorsGreen,
+                                                    matchingParams );
+    const std::vector< cv::DMatch >& matchesBlueGreen = blueGreen.matches;
 
     // Draw top matches
     cv::Mat imMatchesBlueGreen;
@@ -126,19 +122,12 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
 
     //
     //
-    std::vector< cv::DMatch > matchesRedGreen;
-
-    matcher->match(
-        descriptorsRed, descriptorsGreen, matchesRedGreen, cv::Mat( ) );
-
-    // Sort matches by score
-    std::sort( matchesRedGreen.begin( ), matchesRedGreen.end( ) );
-
-    // Remove not so good matches
-    numGoodMatches = static_cast< int >(
-        static_cast< float >( matchesRedGreen.size( ) ) * GOOD_MATCH_PERCENT );
-    matchesRedGreen.erase( matchesRedGreen.begin( ) + numGoodMatches,
-                           matchesRedGreen.end( ) );
+    const FeatureMatches redGreen = matchFeatures( keypointsRed,
+                                                   descriptorsRed,
+                                                   keypointsGreen,
+                                                   descriptorsGreen,
+                                                   matchingParams );
+    const std::vector< cv::DMatch >& matchesRedGreen = redGreen.matches;
 
     // Draw top matches
     cv::Mat imMatchesRedGreen;
@@ -155,50 +144,18 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     // Step 4: Calculate Homography - 12 Marks
     //
 
-    // Extract location of good matches
-    ///
-    /// YOUR CODE HERE
-    ///
+    // The locations of the good matches were already extracted by the
+    // matcher
 
     // Blue Green
-
-    std::vector< cv::Point2f > src_ptsBlueGreen, dst_ptsBlueGreen;
-
-    for ( size_t i = 0; i < matchesBlueGreen.size( ); i++ )
-    {
-        src_ptsBlueGreen.push_back(
-            keypointsBlue[ static_cast< size_t >(
-                               matchesBlueGreen[ i ].queryIdx ) ]
-                .pt );
-        dst_ptsBlueGreen.push_back(
-            keypointsGreen[ static_cast< size_t >(
-                                matchesBlueGreen[ i ].trainIdx ) ]
-                .pt );
-    }
-
-    cv::Mat hBlueGreen =
-        findHomography( src_ptsBlueGreen, dst_ptsBlueGreen, cv::RANSAC );
+    cv::Mat hBlueGreen = findHomography(
+        blueGreen.queryPoints, blueGreen.trainPoints, cv::RANSAC );
 
     //
     // Red Green
     //
-
-    std::vector< cv::Point2f > src_ptsRedGreen, dst_ptsRedGreen;
-
-    for ( size_t i = 0; i < matchesRedGreen.size( ); i++ )
-    {
-        src_ptsRedGreen.push_back(
-            keypointsRed[ static_cast< size_t >(
-                              matchesRedGreen[ i ].queryIdx ) ]
-                .pt );
-        dst_ptsRedGreen.push_back(
-            keypointsGreen[ static_cast< size_t >(
-                                matchesRedGreen[ i ].trainIdx ) ]
-                .pt );
-    }
-
-    cv::Mat hRedGreen =
-        findHomography( src_ptsRedGreen, dst_ptsRedGreen, cv::RANSAC );
+    cv::Mat hRedGreen = findHomography(
+        redGreen.queryPoints, redGreen.trainPoints, cv::RANSAC );
 
     //
     // Step 5: Warping Image - 6 Marks
@@ -1,4 +1,6 @@
+#include <FeatureMatching.h>
 #include <GUI.h>
+#include <ImageAlignment.h>
 #include <macros.h>
 
 // OpenCV includes
@@ -9,32 +11,21 @@ IGNORE_WARNINGS_POP
 
 // STD includes
 #include <iostream>
+#include <string>
 
 const std::string IMAGES_ROOT = "C:/images";
 const std::string RESULTS_ROOT = "C:/images/results";
 
-int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
+// ORB features of both images at full resolution and their best matches
+struct FullResolutionMatches
 {
-    //
-    // Step 1: Read in images
-    //
-
-    // Read reference image
-    const std::string refFilename( IMAGES_ROOT + "/form.jpg" );
-    std::cout << "Reading reference image : " << refFilename << '\n';
-    const cv::Mat imReference = cv::imread( refFilename );
-
-    // Read image to be aligned
-    const std::string imFilename( IMAGES_ROOT + "/scanned-form.jpg" );
-    std::cout << "Reading image to align : " << imFilename << '\n';
-    cv::Mat img = cv::imread( imFilename );
-
-    showMat( imReference, "Reference Image" );
-    showMat( img, "Image to be aligned", true );
+    std::vector< cv::KeyPoint > keypoints1, keypoints2;
+    FeatureMatches featureMatches;
+};
 
-    //
-    // Step 2: Detect features
-    //
+FullResolutionMatches matchFullResolution( const cv::Mat& img,
+                                           const cv::Mat& imReference )
+{
     int MAX_FEATURES = 500;
     float GOOD_MATCH_PERCENT = 0.15f;
 
@@ -43,25 +34,44 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     cv::cvtColor( img, im1Gray, cv::COLOR_BGR2GRAY );
     cv::cvtColor( imReference, im2Gray, cv::COLOR_BGR2GRAY );
 
-    // Variables to store keypoints and descriptors
-    std::vector< cv::KeyPoint > keypoints1, keypoints2;
+    FullResolutionMatches result;
     cv::Mat descriptors1, descriptors2;
 
     // Detect ORB features and compute descriptors.
     cv::Ptr< cv::Feature2D > orb = cv::ORB::create( MAX_FEATURES );
-    orb->detectAndCompute( im1Gray, cv::Mat( ), keypoints1, descriptors1 );
-    orb->detectAndCompute( im2Gray, cv::Mat( ), keypoints2, descriptors2 );
-
+    orb->detectAndCompute(
+        im1Gray, cv::Mat( ), result.keypoints1, descriptors1 );
+    orb->detectAndCompute(
+        im2Gray, cv::Mat( ), result.keypoints2, descriptors2 );
+
+    // Only the best GOOD_MATCH_PERCENT matches are kept. They are selected
+    // with a partial sort and the point locations are extracted right away.
+    FeatureMatchingParams matchingParams;
+    matchingParams.goodMatchPercent = GOOD_MATCH_PERCENT;
+
+    result.featureMatches = matchFeatures( result.keypoints1,
+                                           descriptors1,
+                                           result.keypoints2,
+                                           descriptors2,
+                                           matchingParams );
+
+    return result;
+}
+
+void showFullResolutionMatches( const cv::Mat& img,
+                                const cv::Mat& imReference,
+                                const FullResolutionMatches& full )
+{
     cv::Mat imgKp1;
     cv::drawKeypoints( img,
-                       keypoints1,
+                       full.keypoints1,
                        imgKp1,
                        cv::Scalar( 0, 0, 255 ),
                        cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS );
 
     cv::Mat imgKp2;
     cv::drawKeypoints( imReference,
-                       keypoints2,
+                       full.keypoints2,
                        imgKp2,
                        cv::Scalar( 0, 0, 255 ),
                        cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS );
@@ -69,49 +79,91 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     showMat( imgKp2, "Reference Image KP" );
     showMat( imgKp1, "Image to be aligned KP", true );
 
-    //
-    // Step 3: Match features
-    //
-    std::vector< cv::DMatch > matches;
-    cv::Ptr< cv::DescriptorMatcher > matcher =
-        cv::DescriptorMatcher::create( "BruteForce-Hamming" );
-    matcher->match( descriptors1, descriptors2, matches, cv::Mat( ) );
-
-    // Sort matches by score
-    std::sort( matches.begin( ), matches.end( ) );
-
-    // Remove not so good matches
-    const int numGoodMatches = static_cast< int >(
-        static_cast< float >( matches.size( ) ) * GOOD_MATCH_PERCENT );
-    matches.erase( matches.begin( ) + numGoodMatches, matches.end( ) );
-
     // Draw top matches
     cv::Mat imMatches;
-    cv::drawMatches(
-        img, keypoints1, imReference, keypoints2, matches, imMatches );
+    cv::drawMatches( img,
+                     full.keypoints1,
+                     imReference,
+                     full.keypoints2,
+                     full.featureMatches.matches,
+                     imMatches );
     cv::imwrite( RESULTS_ROOT + "/matches.jpg", imMatches );
 
     showMat( imMatches, "KP matches", true );
+}
+
+// Usage: imageAlignment [--compare]
+//
+// The homography is estimated coarse to fine. The full resolution ORB
+// matching only runs if that fails, or with --compare to show its keypoints
+// and matches and to compare the run times of both.
+int main( int argc, char** argv )
+{
+    const bool compare = argc > 1 && std::string( argv[ 1 ] ) == "--compare";
 
     //
-    // Step 4: Calculate Homography
+    // Step 1: Read in images
     //
-    // Extract location of good matches
-    std::vector< cv::Point2f > points1, points2;
 
-    for ( size_t i = 0; i < matches.size( ); i++ )
+    // Read reference image
+    const std::string refFilename( IMAGES_ROOT + "/form.jpg" );
+    std::cout << "Reading reference image : " << refFilename << '\n';
+    const cv::Mat imReference = cv::imread( refFilename );
+
+    // Read image to be aligned
+    const std::string imFilename( IMAGES_ROOT + "/scanned-form.jpg" );
+    std::cout << "Reading image to align : " << imFilename << '\n';
+    cv::Mat img = cv::imread( imFilename );
+
+    showMat( imReference, "Reference Image" );
+    showMat( img, "Image to be aligned", true );
+
+    //
+    // Step 2: Calculate Homography
+    //
+    // Coarse to fine estimation. The homography is estimated on a downscaled
+    // pyramid level and refined with features searched only around their
+    // predicted position at full resolution.
+    cv::TickMeter pyramidTimer;
+    pyramidTimer.start( );
+    cv::Mat h = estimateHomographyPyramid( img, imReference );
+    pyramidTimer.stop( );
+
+    if ( ! h.empty( ) )
     {
-        points1.push_back(
-            keypoints1[ static_cast< size_t >( matches[ i ].queryIdx ) ].pt );
-        points2.push_back(
-            keypoints2[ static_cast< size_t >( matches[ i ].trainIdx ) ].pt );
+        std::cout << "Coarse to fine homography ( "
+                  << pyramidTimer.getTimeMilli( ) << " ms ):\n"
+                  << h << '\n';
     }
 
-    // Find homography
-    cv::Mat h = findHomography( points1, points2, cv::RANSAC );
+    if ( h.empty( ) || compare )
+    {
+        // Find homography with all good matches at full resolution
+        cv::TickMeter fullTimer;
+        fullTimer.start( );
+        const FullResolutionMatches full =
+            matchFullResolution( img, imReference );
+        const cv::Mat hFull = findHomography( full.featureMatches.queryPoints,
+                                              full.featureMatches.trainPoints,
+                                              cv::RANSAC );
+        fullTimer.stop( );
+
+        std::cout << "Full resolution homography ( "
+                  << fullTimer.getTimeMilli( ) << " ms ):\n"
+                  << hFull << '\n';
+
+        showFullResolutionMatches( img, imReference, full );
+
+        if ( h.empty( ) )
+        {
+            std::cout << "Coarse to fine alignment failed, using full "
+                         "resolution homography\n";
+            h = hFull;
+        }
+    }
 
     //
-    // Step 5:  Warping Image
+    // Step 3:  Warping Image
     //
     // Use homography to warp image
     cv::Mat im1Reg;
@@ -123,4 +175,4 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     cv::destroyAllWindows( );
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,5 +1,7 @@
+#include <FrameSource.h>
 #include <GUI.h>
 #include <macros.h>
+#include <MultiTargetTracking.h>
 
 // OpenCV includes
 IGNORE_WARNINGS_OPENCV_PUSH
@@ -13,12 +15,6 @@ IGNORE_WARNINGS_POP
 const std::string IMAGES_ROOT = "C:/images";
 const std::string RESULTS_ROOT = "C:/images/results";
 
-// Compare rectangles
-bool rectAreaComparator( cv::Rect& r1, cv::Rect& r2 )
-{
-    return r1.area( ) < r2.area( );
-}
-
 int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
 {
     // Colors for display
@@ -54,8 +50,8 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     // Vector for storing objects rectangles
     std::vector< cv::Rect > objects;
 
-    // Load video
-    cv::VideoCapture cap( IMAGES_ROOT + "/boy-walking.mp4" );
+    // Load video, decoded ahead on a background thread
+    FrameSource cap( IMAGES_ROOT + "/boy-walking.mp4" );
 
     // Confirm video is open
     if ( ! cap.isOpened( ) )
@@ -66,103 +62,33 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     // Variables for storing frames
     cv::Mat frame, frameDisplayDetection, frameDisplay, output;
 
-    // Specify Kalman filter type
-    int type = CV_32F;
-
-    // Initialize Kalman filter.
-    // Internal state has 6 elements (x, y, width, vx, vy, vw)
-    // Measurement has 3 elements (x, y, width ).
-    // Note: Height = 2 x width, so it is not part of the state
-    // or measurement.
-    cv::KalmanFilter KF( 6, 3, 0, type );
-
-    cv::setIdentity( KF.transitionMatrix );
-
-    std::cout << KF.transitionMatrix << '\n';
-
-    cv::setIdentity( KF.measurementMatrix );
-
-    std::cout << KF.measurementMatrix << '\n';
-
-    // Variable to store detected x, y and w
-    cv::Mat measurement = cv::Mat::zeros( 3, 1, type );
-
-    // Variables to store detected object and tracked object
-    cv::Rect objectTracked, objectDetected;
-
-    // Variables to store results of the predict and update ( a.k.a correct step
-    // ).
-    cv::Mat updatedMeasurement, predictedMeasurement;
-
-    // Variable to indicate measurement was updated.
-    bool measurementWasUpdated = false;
-
-    // Timing variable
-    double ticks { }, preTicks { };
-
-    // Read frames until object is detected for the first time
-    while ( cap.read( frame ) )
-    {
-        // Detect object
-        hog.detectMultiScale( frame,
-                              objects,
-                              weights,
-                              hitThreshold,
-                              winStride,
-                              padding,
-                              scale,
-                              finalThreshold,
-                              useMeanshiftGrouping );
-
-        // Update timer
-        ticks = static_cast< double >( cv::getTickCount( ) );
-
-        if ( ! objects.empty( ) )
-        {
-            // First object detected
-            objectDetected =
-                *std::ranges::max_element( objects, rectAreaComparator );
-
-            // Update measurement
-            measurement.at< float >( 0 ) =
-                static_cast< float >( objectDetected.x );
-            measurement.at< float >( 1 ) =
-                static_cast< float >( objectDetected.y );
-            measurement.at< float >( 2 ) =
-                static_cast< float >( objectDetected.width );
-
-            // Update state. Note x, y, w are set to measured values.
-            // vx = vy = vw because we have no idea about the velocities
-            // yet.
-            KF.statePost.at< float >( 0 ) = measurement.at< float >( 0 );
-            KF.statePost.at< float >( 1 ) = measurement.at< float >( 1 );
-            KF.statePost.at< float >( 2 ) = measurement.at< float >( 2 );
-            KF.statePost.at< float >( 3 ) = 0;
-            KF.statePost.at< float >( 4 ) = 0;
-            KF.statePost.at< float >( 5 ) = 0;
-
-            // Set diagonal values for covariance matrices.
-            // processNoiseCov is Q
-            setIdentity( KF.processNoiseCov, cv::Scalar::all( 1e-2 ) );
-
-            // measurementNoiseCov is R
-            setIdentity( KF.measurementNoiseCov, cv::Scalar::all( 1e-2 ) );
-            break;
-        }
-
-        showMat( frame, "Tracking", false );
-    }
-
-    showMat( frame, "Tracking", true );
-
-    // Apply Kalman Filter
-    // dt for Transition matrix
-    double dt = 0;
+    // One Kalman filter per pedestrian. Like a single cv::KalmanFilter the
+    // state has 6 elements (x, y, width, vx, vy, vw) and the measurement 3
+    // elements (x, y, width). Height = 2 x width, so it is not part of the
+    // state or measurement. Detections are assigned to the predicted boxes
+    // by IoU, unmatched detections start new tracks and tracks without a
+    // detection for maxMissed frames are dropped.
+    KalmanTrackerParams trackerParams;
+    trackerParams.processNoise = 1e-2f;
+    trackerParams.measurementNoise = 1e-2f;
+    trackerParams.association = TrackAssociation::Hungarian;
+    trackerParams.minIou = 0.3;
+    trackerParams.minHits = 3;
+    trackerParams.maxMissed = 10;
+    trackerParams.aspectRatio = 2.0f;
+
+    KalmanTrackerBank tracker( trackerParams );
+
+    // dt for the transition matrix is the frame period of the video, the
+    // velocities are in pixels per second
+    const double fps = cap.getFps( ) > 0.0 ? cap.getFps( ) : 30.0;
+    const auto dt = static_cast< float >( 1.0 / fps );
+
+    // Show frames from a display thread, so the waitKey of every showMat
+    // no longer limits the tracking rate
+    const auto previousSink = getDisplaySink( );
+    setDisplaySink( std::make_shared< AsyncDisplaySink >( previousSink ) );
 
-    // Random number generator for randomly selecting frames for update
-    cv::RNG rng( 0xFFFFFFFF );
-
-    // We will display only first 5 frames
     int count = 0;
 
     // Loop over all frames
@@ -174,20 +100,6 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
         // Variable for displaying detection result
         frameDisplayDetection = frame.clone( );
 
-        // Update dt for transition matrix.
-        // dt = time elapsed.
-
-        preTicks = ticks;
-        ticks = static_cast< double >( cv::getTickCount( ) );
-        dt = ( ticks - preTicks ) / cv::getTickFrequency( );
-
-        KF.transitionMatrix.at< float >( 3 ) = static_cast< float >( dt );
-        KF.transitionMatrix.at< float >( 10 ) = static_cast< float >( dt );
-        KF.transitionMatrix.at< float >( 17 ) = static_cast< float >( dt );
-
-        // Kalman filter predict step
-        predictedMeasurement = KF.predict( );
-
         // Clear objects detected in previous frame.
         objects.clear( );
 
@@ -202,67 +114,30 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
                               finalThreshold,
                               useMeanshiftGrouping );
 
-        // Find largest object
-        objectDetected =
-            *std::ranges::max_element( objects, rectAreaComparator );
-
-        // Display detected rectangle
-        rectangle( frameDisplayDetection, objectDetected, red, 2, 4 );
+        // Predict all tracks, then correct them with the detections
+        tracker.update( objects, dt );
 
-        // We will update measurements 15% of the time.
-        // Frames are randomly chosen.
-
-        if ( bool update = rng.uniform( 0.0, 1.0 ) < 0.15 )
-        {
-            // Kalman filter update step
-            if ( ! objects.empty( ) )
-            {
-                // Copy x, y, w from the detected rectangle
-                measurement.at< float >( 0 ) =
-                    static_cast< float >( objectDetected.x );
-                measurement.at< float >( 1 ) =
-                    static_cast< float >( objectDetected.y );
-                measurement.at< float >( 2 ) =
-                    static_cast< float >( objectDetected.width );
-
-                // Perform Kalman update step
-                updatedMeasurement = KF.correct( measurement );
-                measurementWasUpdated = true;
-            }
-            else
-            {
-                // Measurement not updated because no object detected
-                measurementWasUpdated = false;
-            }
-        }
-        else
+        // Display detected rectangles
+        for ( const auto& objectDetected : objects )
         {
-            // Measurement not updated
-            measurementWasUpdated = false;
+            cv::rectangle( frameDisplayDetection, objectDetected, red, 2, 4 );
         }
 
-        if ( measurementWasUpdated )
+        // Draw confirmed tracks with their id. Tracks without a detection
+        // in this frame show the prediction.
+        for ( const auto& track : tracker.getTracks( ) )
         {
-            // Use updated measurement if measurement was updated
-            objectTracked = cv::Rect(
-                static_cast< int >( updatedMeasurement.at< float >( 0 ) ),
-                static_cast< int >( updatedMeasurement.at< float >( 1 ) ),
-                static_cast< int >( updatedMeasurement.at< float >( 2 ) ),
-                2 * static_cast< int >( updatedMeasurement.at< float >( 2 ) ) );
+            const cv::Rect objectTracked( track.box );
+
+            cv::rectangle( frameDisplay, objectTracked, blue, 2, 4 );
+            cv::putText( frameDisplay,
+                         std::to_string( track.id ),
+                         objectTracked.tl( ) + cv::Point( 4, 20 ),
+                         cv::FONT_HERSHEY_SIMPLEX,
+                         0.6,
+                         blue,
+                         2 );
         }
-        else
-        {
-            // If measurement was not updated, use predicted values.
-            objectTracked = cv::Rect(
-                static_cast< int >( predictedMeasurement.at< float >( 0 ) ),
-                static_cast< int >( predictedMeasurement.at< float >( 1 ) ),
-                static_cast< int >( predictedMeasurement.at< float >( 2 ) ),
-                2 * static_cast< int >(
-                        predictedMeasurement.at< float >( 2 ) ) );
-        }
-
-        // Draw tracked object
-        cv::rectangle( frameDisplay, objectTracked, blue, 2, 4 );
 
         // Text indicating Tracking or Detection.
         cv::putText( frameDisplay,
@@ -286,12 +161,15 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
         showMat( output, "Tracking", false );
 
         count += 1;
-        /*if ( count == 5 )
-            break;*/
     }
 
-    // Clean up
-    cv::waitKey( 0 );
+    std::cout << "Frames: " << count << ", tracks: " << tracker.size( )
+              << '\n';
+
+    showMat( output, "Tracking", true );
+
+    // Clean up, this also closes the windows of the display thread
+    setDisplaySink( previousSink );
     cv::destroyAllWindows( );
 
     return 0;
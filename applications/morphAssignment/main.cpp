@@ -1,3 +1,6 @@
+#include <Benchmark.h>
+#include <FastKernels.h>
+#include <FrameSink.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -79,10 +82,10 @@ void dilateSelf( )
     ///
     // Define the codec and create VideoWriter object.
     // The output is stored in 'outputChaplin.mp4' file.
-    cv::VideoWriter videoDilate( RESULTS_ROOT + "/dilationScratch.avi",
-                                 cv::VideoWriter::fourcc( 'F', 'M', 'P', '4' ),
-                                 10,
-                                 cv::Size( 50, 50 ) );
+    FrameSink videoDilate( RESULTS_ROOT + "/dilationScratch.avi",
+                           cv::VideoWriter::fourcc( 'F', 'M', 'P', '4' ),
+                           10,
+                           cv::Size( 50, 50 ) );
 
     cv::Mat bitAnd;
 
@@ -155,7 +158,7 @@ void dilateSelf( )
         std::cout << "Images not equal\n";
     }
 
-    videoDilate.release( );
+    videoDilate.close( );
 }
 
 void erodeSelf( )
@@ -224,10 +227,10 @@ void erodeSelf( )
     ///
     // Define the codec and create VideoWriter object.
     // The output is stored in 'outputChaplin.mp4' file.
-    cv::VideoWriter out( RESULTS_ROOT + "/erosionScratch.avi",
-                         cv::VideoWriter::fourcc( 'F', 'M', 'P', '4' ),
-                         10,
-                         cv::Size( 50, 50 ) );
+    FrameSink out( RESULTS_ROOT + "/erosionScratch.avi",
+                   cv::VideoWriter::fourcc( 'F', 'M', 'P', '4' ),
+                   10,
+                   cv::Size( 50, 50 ) );
 
     cv::Mat bitAnd;
 
@@ -301,7 +304,80 @@ void erodeSelf( )
         std::cout << "Images not equal\n";
     }
 
-    out.release( );
+    out.close( );
+}
+
+// The loops above show the principle. For large structuring elements the
+// separable van Herk/Gil-Werman kernels of cvHelper are compared against
+// OpenCV on a full size image.
+void largeKernelMorphology( )
+{
+    cv::Mat image =
+        cv::imread( IMAGES_ROOT + "/threshold.png", cv::IMREAD_GRAYSCALE );
+    if ( image.empty( ) )
+    {
+        // Random test pattern if the image is missing
+        image.create( cv::Size( 2048, 1536 ), CV_8UC1 );
+        cv::randu( image, 0, 256 );
+    }
+
+    BenchmarkParams benchmarkParams;
+    benchmarkParams.iterations = 20;
+    benchmarkParams.pixelsPerIteration =
+        static_cast< int64_t >( image.total( ) );
+
+    std::vector< BenchmarkResult > results;
+
+    for ( const int ksize : { 3, 31, 61 } )
+    {
+        const cv::Size kernelSize( ksize, ksize );
+        const cv::Mat element =
+            cv::getStructuringElement( cv::MORPH_RECT, kernelSize );
+
+        cv::Mat dilatedCV, dilatedFast, erodedCV, erodedFast;
+        cv::dilate( image, dilatedCV, element );
+        dilateRect( image, dilatedFast, kernelSize );
+        cv::erode( image, erodedCV, element );
+        erodeRect( image, erodedFast, kernelSize );
+
+        const bool equal = cv::countNonZero( dilatedCV != dilatedFast ) == 0 &&
+                           cv::countNonZero( erodedCV != erodedFast ) == 0;
+        std::cout << ksize << "x" << ksize << ": "
+                  << ( equal ? "Images are equal\n" : "Images not equal\n" );
+
+        const std::string suffix =
+            " " + std::to_string( ksize ) + "x" + std::to_string( ksize );
+
+        results.push_back( runBenchmark(
+            "cv::dilate" + suffix,
+            [ & ]( ) { cv::dilate( image, dilatedCV, element ); },
+            benchmarkParams ) );
+        results.push_back( runBenchmark(
+            "dilateRect" + suffix,
+            [ & ]( ) { dilateRect( image, dilatedFast, kernelSize ); },
+            benchmarkParams ) );
+        results.push_back( runBenchmark(
+            "cv::erode" + suffix,
+            [ & ]( ) { cv::erode( image, erodedCV, element ); },
+            benchmarkParams ) );
+        results.push_back( runBenchmark(
+            "erodeRect" + suffix,
+            [ & ]( ) { erodeRect( image, erodedFast, kernelSize ); },
+            benchmarkParams ) );
+
+        if ( ksize == 31 )
+        {
+            showMat( dilatedFast, "Dilated 31x31", false, 0.5 );
+            showMat( erodedFast, "Eroded 31x31", true, 0.5 );
+        }
+    }
+
+    for ( const auto& result : results )
+    {
+        printBenchmark( result, std::cout );
+    }
+
+    writeBenchmarkJson( results, RESULTS_ROOT + "/morphology_benchmark.json" );
 }
 
 int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
@@ -310,6 +386,8 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
 
     erodeSelf( );
 
+    largeKernelMorphology( );
+
     // Clean up
     cv::destroyAllWindows( );
 
@@ -1,4 +1,5 @@
 #include <GUI.h>
+#include <IncrementalPanorama.h>
 #include <macros.h>
 
 // OpenCV includes
@@ -8,21 +9,40 @@ IGNORE_WARNINGS_OPENCV_PUSH
 IGNORE_WARNINGS_POP
 
 // STD includes
+#include <filesystem>
 #include <iostream>
+#include <string>
 
 const std::string IMAGES_ROOT = "C:/images";
 const std::string RESULTS_ROOT = "C:/images/results";
 
-int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
+// Usage: multiImagePanorama [--stitcher]
+//
+// The panorama is built with IncrementalPanorama and written as full
+// resolution tiles. It only estimates planar homographies and feathers the
+// overlaps, so for scenes with a wide field of view or differing exposures
+// the result falls behind cv::Stitcher, which warps onto a sphere, adjusts
+// the bundle, compensates exposure and blends along seams. --stitcher
+// additionally stitches all images with cv::Stitcher in one shot for a
+// final output of that quality.
+int main( int argc, char** argv )
 {
+    const bool useStitcher =
+        argc > 1 && std::string( argv[ 1 ] ) == "--stitcher";
+
     std::string dirName = IMAGES_ROOT + "/scene/";
     std::vector< cv::Mat > images;
     std::vector< cv::String > files;
-    cv::String destination = "panorama.jpg";
 
     cv::glob( dirName, files );
     std::sort( files.begin( ), files.end( ) );
 
+    // The panorama is built incrementally. Every image is matched only
+    // against the latest images when it arrives and only the latest
+    // homographies are refined, so a live preview is available after each
+    // image without stitching everything again.
+    IncrementalPanorama panorama;
+
     for ( size_t i = 0; i < files.size( ); ++i )
     {
         cv::Mat img = cv::imread( files[ i ] ); // load the image
@@ -32,40 +52,67 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
             continue;
         }
 
-        // Create a list of images
-        images.push_back( img );
-
-        showMat( img, "Image " + std::to_string( i ), true );
-    }
-
-    ///
-    /// YOUR CODE HERE
-    ///
+        if ( useStitcher )
+        {
+            images.push_back( img );
+        }
 
-    // Define a image for the final output
-    cv::Mat imgPanorama;
+        showMat( img, "Image " + std::to_string( i ), false );
 
-    // Create a stitcher for panorama images
-    const cv::Ptr< cv::Stitcher > stitcher =
-        cv::Stitcher::create( cv::Stitcher::PANORAMA );
+        if ( ! panorama.addImage( img ) )
+        {
+            std::cout << files[ i ] << " does not overlap with the panorama\n";
+            continue;
+        }
 
-    // Call the stitcher to stitch all the images in the image array
-    const cv::Stitcher::Status status = stitcher->stitch( images, imgPanorama );
+        showMat( panorama.renderPreview( 0.25 ), "Panorama preview", true );
+    }
 
-    if ( status != cv::Stitcher::OK )
+    if ( panorama.size( ) < 2 )
     {
         std::cout << "Can't stitch images\n";
         return -1;
     }
 
-    // Store a new image stitched from the given
-    // set of images as "result.jpg"
-    cv::imwrite( RESULTS_ROOT + "/result.jpg", imgPanorama );
+    // The full resolution panorama is rendered tile by tile and every tile
+    // is written to disk, so the whole canvas is never held in memory. Only
+    // a downscaled overview is returned.
+    const std::string tileDirectory = RESULTS_ROOT + "/panorama";
+    std::filesystem::create_directories( tileDirectory );
+
+    const cv::Mat imgPanorama = panorama.createCompositor( ).render(
+        TiledPanoramaCompositor::writeTilesTo( tileDirectory ), 0.25 );
+
+    cv::imwrite( RESULTS_ROOT + "/result_preview.jpg", imgPanorama );
 
     showMat( imgPanorama, "Panorama", true );
 
+    if ( useStitcher )
+    {
+        // Create a stitcher for panorama images
+        const cv::Ptr< cv::Stitcher > stitcher =
+            cv::Stitcher::create( cv::Stitcher::PANORAMA );
+
+        // Call the stitcher to stitch all the images in the image array
+        cv::Mat imgStitched;
+        const cv::Stitcher::Status status =
+            stitcher->stitch( images, imgStitched );
+
+        if ( status != cv::Stitcher::OK )
+        {
+            std::cout << "cv::Stitcher can't stitch images\n";
+            return -1;
+        }
+
+        // Store a new image stitched from the given
+        // set of images as "result.jpg"
+        cv::imwrite( RESULTS_ROOT + "/result.jpg", imgStitched );
+
+        showMat( imgStitched, "Panorama (cv::Stitcher)", true );
+    }
+
     // Clean up
     cv::destroyAllWindows( );
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,3 +1,4 @@
+#include <FrameSource.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -80,8 +81,9 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
         return -1;
     }
 
-    // Read video
-    cv::VideoCapture video( IMAGES_ROOT + "/hockey.mp4" );
+    // Read video, the next frames are decoded while the current one is
+    // tracked
+    FrameSource video( IMAGES_ROOT + "/hockey.mp4" );
 
     // Exit if video is not opened
     if ( ! video.isOpened( ) )
@@ -145,6 +147,13 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     // Display bounding box.
     cv::rectangle( frame, bbox, blue, 2, 1 );
 
+    // Show frames from a display thread, so the waitKey of every showMat
+    // no longer limits the tracking rate. The sink is installed before the
+    // first window is created: HighGUI windows belong to the thread that
+    // created them, so all of them have to come from the display thread.
+    const auto previousSink = getDisplaySink( );
+    setDisplaySink( std::make_shared< AsyncDisplaySink >( previousSink ) );
+
     showMat( frame, "Tracking", true );
 
     // We will display only first 5 frames
@@ -225,10 +234,10 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
             break;*/
     }
 
-    //showMat( frame, "Tracking", true );
+    showMat( frame, "Tracking", true );
 
-    // Clean up
-    cv::waitKey( 0 );
+    // Clean up, this also closes the windows of the display thread
+    setDisplaySink( previousSink );
     cv::destroyAllWindows( );
 
     return 0;
@@ -1,3 +1,7 @@
+#include <DenseOpticalFlow.h>
+#include <FeatureTracking.h>
+#include <FrameSink.h>
+#include <FrameSource.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -26,54 +30,46 @@ void getRandomColors( std::vector< cv::Scalar >& colors, int numColors )
     }
 }
 
-int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
+void sparseFlow( const std::string& videoFileName )
 {
-    const std::string videoFileName = IMAGES_ROOT + "/cycle.mp4";
-    cv::VideoCapture cap( videoFileName );
-
-    const auto width =
-        static_cast< int32_t >( cap.get( cv::CAP_PROP_FRAME_WIDTH ) );
-    const auto height =
-        static_cast< int32_t >( cap.get( cv::CAP_PROP_FRAME_HEIGHT ) );
-
-    cv::VideoWriter out( RESULTS_ROOT + "/sparse-output.mp4",
-                         cv::VideoWriter::fourcc( 'M', 'P', '4', 'V' ),
-                         20,
-                         cv::Size( width, height ) );
-
-    cv::TermCriteria termcrit(
+    FrameSource cap( videoFileName );
+
+    FrameSink out( RESULTS_ROOT + "/sparse-output.mp4",
+                   cv::VideoWriter::fourcc( 'M', 'P', '4', 'V' ),
+                   20,
+                   cap.getFrameSize( ) );
+
+    // The tracker keeps up to 100 features, replaces lost ones in empty
+    // grid cells and reuses the image pyramid of the previous frame
+    KltTrackerParams trackerParams;
+    trackerParams.maxFeatures = 100;
+    trackerParams.qualityLevel = 0.3;
+    trackerParams.minDistance = 7;
+    trackerParams.blockSize = 7;
+    trackerParams.winSize = cv::Size( 15, 15 );
+    trackerParams.maxLevel = 2;
+    trackerParams.criteria = cv::TermCriteria(
         cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 10, 0.03 );
 
+    KltTracker tracker( trackerParams );
+
     // Take first frame and find corners in it
     cv::Mat old_frame;
-    cap >> old_frame;
+    cap.read( old_frame );
 
     showMat( old_frame, "First frame", true );
 
     cv::Mat old_gray;
     cvtColor( old_frame, old_gray, cv::COLOR_BGR2GRAY );
 
-    std::vector< cv::Point2f > old_points;
-    std::vector< uchar > status;
-    std::vector< float > err;
-    std::vector< cv::Point2f > new_points;
-
-    std::vector< cv::Point2f > good_new;
-    std::vector< cv::Point2f > good_old;
+    tracker.update( old_gray );
 
+    // One color per feature id
     std::vector< cv::Scalar > colors;
+    getRandomColors( colors, 256 );
 
     cv::Point2f pt1, pt2;
 
-    cv::goodFeaturesToTrack( old_gray,
-                             old_points,
-                             100,        // maxCorners
-                             0.3,        // qualityLevel
-                             7,          // minDistance
-                             cv::Mat( ), // mask
-                             7           // blockSize
-    );
-
     cv::Mat display_frame;
 
     // Create a mask image for drawing the tracks
@@ -86,51 +82,33 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
 
     while ( true )
     {
-        cap >> frame;
-
-        if ( frame.empty( ) )
+        if ( ! cap.read( frame ) )
         {
             std::cout << "over" << '\n';
+            break;
         }
 
         cv::cvtColor( frame, frame_gray, cv::COLOR_BGR2GRAY );
 
         count += 1;
 
-        // calculate optical flow
-        cv::calcOpticalFlowPyrLK( old_gray,
-                                  frame_gray,
-                                  old_points,
-                                  new_points,
-                                  status,
-                                  err,
-                                  cv::Size( 15, 15 ), // winSize
-                                  2,                  // maxLevel
-                                  termcrit            // criteria
-        );
-
-        // Clearing the good points of the previous frames
-        good_new.clear( );
-        good_old.clear( );
-
-        for ( size_t i = 0; i < new_points.size( ); i++ )
-        {
-            if ( status[ i ] == 1 )
-            {
-                good_new.push_back( new_points[ i ] );
-                good_old.push_back( old_points[ i ] );
-            }
-        }
+        // calculate optical flow, replenish lost features
+        tracker.update( frame_gray );
 
-        getRandomColors( colors, static_cast< int >( new_points.size( ) ) );
+        const auto& good_new = tracker.getTrackedPoints( );
+        const auto& good_old = tracker.getPreviousPoints( );
+        const auto& ids = tracker.getIds( );
 
         // draw the tracks
         for ( size_t j = 0; j < good_new.size( ); j++ )
         {
+            const cv::Scalar& color =
+                colors[ static_cast< size_t >( ids[ j ] ) % colors.size( ) ];
+
             pt1 = good_new[ j ];
             pt2 = good_old[ j ];
-            cv::line( mask, pt1, pt2, colors[ j ], 2, cv::LINE_AA );
-            cv::circle( frame, pt1, 3, colors[ j ], -1 );
+            cv::line( mask, pt1, pt2, color, 2, cv::LINE_AA );
+            cv::circle( frame, pt1, 3, color, -1 );
         }
 
         cv::add( frame, mask, display_frame );
@@ -146,17 +124,88 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
         {
             break;
         }
-
-        // Now update the previous frame and previous_points
-        old_gray = frame_gray.clone( );
-        old_points.clear( );
-        old_points = good_new;
     }
 
     // Clean up
-    cap.release( );
-    out.release( );
+    out.close( );
     cv::destroyAllWindows( );
+}
+
+// Dense flow for every pixel, shown color coded next to a heatmap of the
+// accumulated motion
+void denseFlow( const std::string& videoFileName )
+{
+    FrameSource cap( videoFileName );
+
+    // DIS at half resolution on 2x2 parallel tiles, upsampled to full size
+    DenseFlowParams flowParams;
+    flowParams.method = DenseFlowMethod::Dis;
+    flowParams.scale = 0.5;
+    flowParams.tiles = cv::Size( 2, 2 );
+    flowParams.overlap = 16;
+
+    DenseOpticalFlow denseOpticalFlow( flowParams );
+
+    FrameSink out( RESULTS_ROOT + "/dense-output.mp4",
+                   cv::VideoWriter::fourcc( 'M', 'P', '4', 'V' ),
+                   20,
+                   cv::Size( cap.getFrameSize( ).width * 2,
+                             cap.getFrameSize( ).height ) );
+
+    cv::Mat frame, gray, flow, flowComponents[ 2 ], magnitude;
+    cv::Mat heat, heatColor, display;
+
+    int count = 0;
+
+    while ( cap.read( frame ) )
+    {
+        cv::cvtColor( frame, gray, cv::COLOR_BGR2GRAY );
+
+        if ( ! denseOpticalFlow.update( gray, flow ) )
+        {
+            heat = cv::Mat::zeros( gray.size( ), CV_32FC1 );
+            continue;
+        }
+
+        count += 1;
+
+        // Exponentially decaying motion heatmap
+        cv::split( flow, flowComponents );
+        cv::magnitude( flowComponents[ 0 ], flowComponents[ 1 ], magnitude );
+        cv::accumulateWeighted( magnitude, heat, 0.1 );
+
+        cv::Mat heat8U;
+        cv::normalize( heat, heat8U, 0, 255, cv::NORM_MINMAX, CV_8U );
+        cv::applyColorMap( heat8U, heatColor, cv::COLORMAP_JET );
+
+        cv::hconcat( flowToColor( flow ), heatColor, display );
+        out.write( display );
+
+        showMat( display, "Dense flow | motion heatmap", false, 0.5 );
+
+        if ( count > 200 )
+        {
+            break;
+        }
+    }
+
+    out.close( );
+    cv::destroyAllWindows( );
+}
+
+int main( int argc, char** argv )
+{
+    const std::string videoFileName = IMAGES_ROOT + "/cycle.mp4";
+
+    // "--dense" switches from sparse Lucas-Kanade to dense flow
+    if ( argc > 1 && std::string( argv[ 1 ] ) == "--dense" )
+    {
+        denseFlow( videoFileName );
+    }
+    else
+    {
+        sparseFlow( videoFileName );
+    }
 
     return 0;
 }
\ No newline at end of file
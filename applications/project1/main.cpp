@@ -1,5 +1,7 @@
+#include <EdgePreservingSmoothing.h>
 #include <GUI.h>
 #include <macros.h>
+#include <Retouching.h>
 
 // OpenCV includes
 IGNORE_WARNINGS_OPENCV_PUSH
@@ -8,6 +10,8 @@ IGNORE_WARNINGS_OPENCV_PUSH
 IGNORE_WARNINGS_POP
 
 // STD includes
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 
 const std::string IMAGES_ROOT = "C:/images";
@@ -26,88 +30,28 @@ int fontThickness = 2;
 std::string windowName = "Instagram Filters";
 bool cartoonifyFilterCv = false;
 std::vector< cv::Point2i > patchCenter { };
-std::vector< cv::Rect > patchRegions { };
 std::vector< std::string > help;
 int regionRadius = 15;
 
-std::vector< double >
-getAverageGradient( const std::vector< cv::Rect >& regions )
-{
-    std::vector< double > averages;
-
-    for ( const auto& region : regions )
-    {
-        // Crop the current region
-        cv::Mat roi = sourceImage( region );
-
-        cv::Mat roiGray;
-        cv::cvtColor( roi, roiGray, cv::COLOR_BGR2GRAY );
-
-        cv::Mat SobelX;
-        cv::Mat SobelY;
-
-        // Step 3:
-        cv::Sobel( roiGray, SobelX, CV_32F, 1, 0 );
-        cv::Sobel( roiGray, SobelY, CV_32F, 0, 1 );
-
-        // Step 4:
-        cv::Mat magnitudeImage;
-        cv::Mat angleImage;
-        cv::cartToPolar( SobelX, SobelY, magnitudeImage, angleImage );
-
-        cv::Scalar mean;
-        cv::Scalar stdDev;
-
-        cv::meanStdDev( magnitudeImage, mean, stdDev );
+// Edge preserving filter of the pencil sketch and cartoon filters
+SmoothingBackend smoothingBackend = SmoothingBackend::DomainTransform;
+double smoothingQuality = 1.0;
 
-        averages.push_back( mean[ 0 ] );
-    }
-
-    return averages;
-}
-
-std::vector< cv::Rect >
-getBlemishNeighbourRegions( const cv::Rect& centerRegion )
+const char* smoothingBackendName( SmoothingBackend backend )
 {
-    std::vector< cv::Rect > returnRegions;
-
-    const int xOrg = centerRegion.x;
-    const int yOrg = centerRegion.y;
-    const int size = 2 * regionRadius;
-
-    for ( int y = -1; y <= 1; y++ )
+    switch ( backend )
     {
-        for ( int x = -1; x <= 1; x++ )
-        {
-            if ( x == 0 && y == 0 )
-            {
-                continue;
-            }
-
-            const int xCur = xOrg + size * x;
-            const int yCur = yOrg + size * y;
-
-            // Make sure that the regions are in range
-            if ( xCur < 0 || yCur < 0 ||
-                 xCur + size >= sourceImage.size( ).width ||
-                 yCur + size >= sourceImage.size( ).height )
-            {
-                continue;
-            }
-
-            cv::Rect curRect( xCur, yCur, size, size );
-
-            returnRegions.push_back( curRect );
-
-            cv::rectangle( overlayImage,
-                           curRect,
-                           cv::Scalar( 0, 0, 255 ),
-                           1,
-                           cv::LINE_AA );
-        }
+    case SmoothingBackend::Bilateral:
+        return "bilateral filter";
+    case SmoothingBackend::BilateralGrid:
+        return "bilateral grid";
+    case SmoothingBackend::Guided:
+        return "guided filter";
+    case SmoothingBackend::DomainTransform:
+        return "domain transform";
     }
 
-    return returnRegions;
+    return "";
 }
 
 void updateView( const cv::Mat& result )
@@ -210,8 +154,8 @@ void pencilSketchFilter( )
      * now.
      *
      * Step 2:
-     *     Apply a bilateral filter to smooth the surface and preserver the
-     * edges.
+     *     Apply an edge preserving filter to smooth the surface and preserve
+     * the edges.
      *
      * Step 3:
      *      Calculate Sobel X and Sobel Y to get the edges in X and Y direction.
@@ -241,23 +185,21 @@ void pencilSketchFilter( )
     cv::cvtColor( sourceImage, grayImage, cv::COLOR_BGR2GRAY );
 
     // Step 2:
-    // diameter of the pixel neighbourhood used during filtering
-    const int dia = 5;
+    SmoothingParams smoothingParams;
+    smoothingParams.backend = smoothingBackend;
+    smoothingParams.quality = smoothingQuality;
+
+    // Extent of the neighbourhood used during filtering
+    smoothingParams.sigmaSpace = 5;
 
     // Larger the value the distant colours will be mixed together
     // to produce areas of semi equal colors
-    const double sigmaColor = 20;
-
-    // Larger the value more the influence of the farther placed pixels
-    // as long as their colors are close enough
-    // If sigma space should be used diameter needs to be -1
-    const double sigmaSpace = 20;
+    smoothingParams.sigmaColor = 20;
 
     cv::Mat bilateralFiltered;
 
-    // Apply bilateral filter
-    cv::bilateralFilter(
-        grayImage, bilateralFiltered, dia, sigmaColor, sigmaSpace );
+    // Apply the edge preserving filter
+    smoothEdgePreserving( grayImage, bilateralFiltered, smoothingParams );
 
     // Step 3:
     cv::Sobel( bilateralFiltered, SobelX, CV_32F, 1, 0 );
@@ -302,8 +244,8 @@ void cartoonifyFilter( )
      *      Apply adaptiveThreshold
      *
      * Step 3:
-     *      Apply bilateral filter to get surfaces of constant color and
-     *      preserve edges.
+     *      Apply an edge preserving filter to get surfaces of constant color
+     *      and preserve edges.
      *
      * Step 4:
      *      Convert the segmented image to color to apply it as mask.
@@ -334,23 +276,21 @@ void cartoonifyFilter( )
                            5 );
 
     // Step 3:
-    // diameter of the pixel neighbourhood used during filtering
-    const int dia = 15;
+    SmoothingParams smoothingParams;
+    smoothingParams.backend = smoothingBackend;
+    smoothingParams.quality = smoothingQuality;
+
+    // Extent of the neighbourhood used during filtering
+    smoothingParams.sigmaSpace = 15;
 
     // Larger the value the distant colours will be mixed together
     // to produce areas of semi equal colors
-    const double sigmaColor = 80;
-
-    // Larger the value more the influence of the farther placed pixels
-    // as long as their colors are close enough
-    // If sigma space should be used diameter needs to be -1
-    const double sigmaSpace = 80;
+    smoothingParams.sigmaColor = 80;
 
     cv::Mat bilateralFiltered;
 
-    // Apply bilateral filter
-    cv::bilateralFilter(
-        sourceImage, bilateralFiltered, dia, sigmaColor, sigmaSpace );
+    // Apply the edge preserving filter
+    smoothEdgePreserving( sourceImage, bilateralFiltered, smoothingParams );
 
     // Step 4:
     cv::cvtColor( segmentedImage, segmentedImage, cv::COLOR_GRAY2BGR );
@@ -363,41 +303,76 @@ void cartoonifyFilter( )
 
 void blemishRemovalSeamlessCloning( )
 {
-    for ( size_t i = 0; i < patchRegions.size( ); i++ )
+    BlemishRemovalParams params;
+    params.patchRadius = regionRadius;
+    params.flags = cv::NORMAL_CLONE;
+
+    // Patches that do not touch each other are blended in parallel
+    const auto chosen = removeBlemishes( resultImage, patchCenter, params );
+
+    for ( size_t i = 0; i < patchCenter.size( ); i++ )
     {
-        const auto neighbourRegions =
-            getBlemishNeighbourRegions( patchRegions[ i ] );
-
-        const auto averageGradients = getAverageGradient( neighbourRegions );
-
-        // Get the minimum
-        const auto minAvg = std::min_element( averageGradients.begin( ),
-                                              averageGradients.end( ) );
-
-        const auto minIdx = static_cast< size_t >(
-            std::distance( averageGradients.begin( ), minAvg ) );
-
-        cv::rectangle( overlayImage,
-                       neighbourRegions[ minIdx ],
-                       cv::Scalar( 0, 255, 0 ),
-                       1,
-                       cv::LINE_AA );
-
-        cv::Mat srcRoi = resultImage( neighbourRegions[ minIdx ] );
-        cv::Mat srcMask =
-            cv::Mat( srcRoi.size( ), CV_8UC3, cv::Scalar::all( 255 ) );
-
-        cv::seamlessClone( srcRoi,
-                           resultImage,
-                           srcMask,
-                           patchCenter[ i ],
-                           resultImage,
-                           cv::NORMAL_CLONE );
+        for ( const auto& candidate : getBlemishCandidates(
+                  patchCenter[ i ], regionRadius, sourceImage.size( ) ) )
+        {
+            cv::rectangle( overlayImage,
+                           candidate,
+                           cv::Scalar( 0, 0, 255 ),
+                           1,
+                           cv::LINE_AA );
+        }
+
+        if ( ! chosen[ i ].empty( ) )
+        {
+            cv::rectangle( overlayImage,
+                           chosen[ i ],
+                           cv::Scalar( 0, 255, 0 ),
+                           1,
+                           cv::LINE_AA );
+        }
     }
 
     updateView( resultImage );
 }
 
+// Remove the blemishes listed in a text file ("x y" per line) from an image
+// without any interaction and write the result
+int batchBlemishRemoval( const std::string& imageFileName,
+                         const std::string& centersFileName,
+                         const std::string& outputFileName )
+{
+    cv::Mat image = cv::imread( imageFileName );
+    std::ifstream centersFile( centersFileName );
+
+    if ( image.empty( ) || ! centersFile )
+    {
+        std::cerr << "Unable to read " << imageFileName << " or "
+                  << centersFileName << '\n';
+        return 1;
+    }
+
+    std::vector< cv::Point > centers;
+    cv::Point center;
+
+    while ( centersFile >> center.x >> center.y )
+    {
+        centers.push_back( center );
+    }
+
+    BlemishRemovalParams params;
+    params.patchRadius = regionRadius;
+
+    const auto chosen = removeBlemishes( image, centers, params );
+
+    const auto removed = std::ranges::count_if(
+        chosen, []( const cv::Rect& rect ) { return ! rect.empty( ); } );
+
+    std::cout << "Removed " << removed << " of " << centers.size( )
+              << " blemishes\n";
+
+    return cv::imwrite( outputFileName, image ) ? 0 : 1;
+}
+
 void blemishRemovalInPainting( )
 {
     cv::Mat inpaintMask = cv::Mat::zeros( sourceImage.size( ), CV_8U );
@@ -418,7 +393,6 @@ void reset( )
     overlayImage = sourceImage.clone( );
     resultImage = sourceImage.clone( );
     patchCenter.clear( );
-    patchRegions.clear( );
     updateView( sourceImage );
 }
 
@@ -446,8 +420,6 @@ void onMouse( int action, int x, int y, [[maybe_unused]] int flags,
                                2 * regionRadius,
                                2 * regionRadius );
 
-        patchRegions.push_back( region );
-
         cv::circle(
             overlayImage, center, 1, cv::Scalar( 255, 0, 0 ), 5, cv::LINE_AA );
 
@@ -458,12 +430,20 @@ void onMouse( int action, int x, int y, [[maybe_unused]] int flags,
     }
 }
 
-int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
+int main( int argc, char** argv )
 {
+    // project1 --batch <image> <centers> <output>
+    if ( argc == 5 && std::string( argv[ 1 ] ) == "--batch" )
+    {
+        return batchBlemishRemoval( argv[ 2 ], argv[ 3 ], argv[ 4 ] );
+    }
+
     help.push_back( "Press 'p' for pencil sketch" );
     help.push_back( "Press 'c' for cartoon sketch" );
     help.push_back( "Press 'i' for blemish removal using in-painting." );
     help.push_back( "Press 's' for blemish removal using seamless cloning." );
+    help.push_back( "Press 'b' to switch the smoothing backend of p and c" );
+    help.push_back( "Press 'q' to toggle fast / full quality smoothing" );
     help.push_back( "Press 'r' for reset" );
     help.push_back( "Press 'ESC' for exit" );
     help.push_back( "" );
@@ -503,6 +483,20 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
             blemishRemovalSeamlessCloning( );
         }
 
+        if ( key == 'b' )
+        {
+            smoothingBackend = static_cast< SmoothingBackend >(
+                ( static_cast< int >( smoothingBackend ) + 1 ) % 4 );
+            std::cout << "Smoothing: "
+                      << smoothingBackendName( smoothingBackend ) << '\n';
+        }
+
+        if ( key == 'q' )
+        {
+            smoothingQuality = smoothingQuality < 1.0 ? 1.0 : 0.5;
+            std::cout << "Smoothing quality: " << smoothingQuality << '\n';
+        }
+
         if ( key == 'r' )
         {
             reset( );
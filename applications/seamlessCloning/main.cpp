@@ -1,5 +1,6 @@
 #include <GUI.h>
 #include <macros.h>
+#include <PoissonBlending.h>
 
 // OpenCV includes
 IGNORE_WARNINGS_OPENCV_PUSH
@@ -47,12 +48,17 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     // The location of the center of the src in the dst
     cv::Point center( 800, 100 );
 
-    // Seamlessly clone src into dst and put the results in output
-    cv::Mat normal_clone;
-    cv::Mat mixed_clone;
+    // Seamlessly clone src into copies of dst. The Poisson equation is only
+    // solved on the bounding box of the mask, the rest stays untouched.
+    PoissonBlender blender;
+
+    cv::Mat normal_clone = dst.clone( );
+    cv::Mat mixed_clone = dst.clone( );
 
-    seamlessClone( src, dst, src_mask, center, normal_clone, cv::NORMAL_CLONE );
-    seamlessClone( src, dst, src_mask, center, mixed_clone, cv::MIXED_CLONE );
+    blender.seamlessClone(
+        src, normal_clone, src_mask, center, cv::NORMAL_CLONE );
+    blender.seamlessClone(
+        src, mixed_clone, src_mask, center, cv::MIXED_CLONE );
 
     showMat( normal_clone, "Normal Clone", false );
     showMat( mixed_clone, "Mixed Clone", true );
@@ -72,8 +78,13 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     center = cv::Point( img.cols / 2, img.rows / 2 );
 
     // Seamlessly clone src into dst and put the results in output
-    seamlessClone( obj, img, src_mask, center, normal_clone, cv::NORMAL_CLONE );
-    seamlessClone( obj, img, src_mask, center, mixed_clone, cv::MIXED_CLONE );
+    normal_clone = img.clone( );
+    mixed_clone = img.clone( );
+
+    blender.seamlessClone(
+        obj, normal_clone, src_mask, center, cv::NORMAL_CLONE );
+    blender.seamlessClone(
+        obj, mixed_clone, src_mask, center, cv::MIXED_CLONE );
 
     showMat( normal_clone, "Normal Clone", false );
     showMat( mixed_clone, "Mixed Clone", true );
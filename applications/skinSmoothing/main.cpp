@@ -1,5 +1,8 @@
+#include <ColorRuleTable.h>
+#include <EdgePreservingSmoothing.h>
 #include <GUI.h>
 #include <macros.h>
+#include <Retouching.h>
 
 // OpenCV includes
 IGNORE_WARNINGS_OPENCV_PUSH
@@ -32,17 +35,39 @@ int skinDetector = 1;
 int skinDetectorMax = 1;
 cv::dnn::Net net;
 
+// Faces whose rectangles overlap, processed as one region
+struct SmoothingUnit
+{
+    cv::Rect region;
+    std::vector< cv::Rect > faces;
+
+    // Scratch buffers, reused by the next run
+    cv::Mat faceMask;
+    cv::Mat mask;
+    cv::Mat smoothed;
+    EdgePreservingSmoother smoother;
+};
+
+std::vector< SmoothingUnit > smoothingUnits;
+
+// zeroSumGameTheoryModelRule( ) for all 2^24 colors
+ColorRuleTable zeroSumSkinTable;
+
 //
 // Function declarations
 //
 std::vector< cv::Rect > detectFaces( const cv::Mat& image );
 void updateView( const cv::Mat& result );
 void skinSmoothing( );
+void smoothUnit( SmoothingUnit& unit );
+void tintOverlay( cv::Mat& overlay, const cv::Mat& mask );
 void reset( );
 void applySkinSmoothing( int, void* );
-cv::Mat calculateMask( const cv::Rect& faceLocation );
-cv::Mat zeroSumGameTheoryModelSkinMask( const cv::Rect& faceLocation );
-cv::Mat meanColorSkinMask( const cv::Rect& faceLocation );
+void calculateMask( const cv::Rect& faceLocation, cv::Mat& mask );
+void zeroSumGameTheoryModelSkinMask( const cv::Rect& faceLocation,
+                                     cv::Mat& mask );
+void meanColorSkinMask( const cv::Rect& faceLocation, cv::Mat& mask );
+void zeroSumGameTheoryModelRule( const cv::Mat& bgr, cv::Mat& mask );
 
 //
 //
@@ -77,6 +102,8 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
                                           tensorflowConfigFile );
 #endif
 
+    zeroSumSkinTable.build( zeroSumGameTheoryModelRule );
+
     help.emplace_back( "Press 's' for skin smoothing" );
     help.emplace_back( "Press 'r' for reset" );
     help.emplace_back( "Press 'ESC' for exit" );
@@ -280,94 +307,138 @@ void updateView( const cv::Mat& result )
     cv::imshow( windowName, combinedImage );
 }
 
-void skinSmoothing()
+void skinSmoothing( )
 {
-    reset();
+    reset( );
 
     // Detect face locations
-    const auto faceLocations = detectFaces(sourceImage);
+    const auto faceLocations = detectFaces( sourceImage );
+
+    //
+    // Overlapping faces are merged into disjoint work units, so units can
+    // write into overlayImage and resultImage in parallel
+    //
+    const auto regions = mergeOverlappingRects( faceLocations );
+
+    smoothingUnits.resize( regions.size( ) );
+
+    for ( size_t i = 0; i < regions.size( ); i++ )
+    {
+        auto& unit = smoothingUnits[ i ];
+        unit.region = regions[ i ];
+        unit.faces.clear( );
 
-    // Apply skin smoothing in parallel
-    cv::parallel_for_(cv::Range(0, static_cast<int>(faceLocations.size())), [&](const cv::Range& range) {
-        for (int i = range.start; i < range.end; ++i)
+        for ( const auto& loc : faceLocations )
         {
-            const auto& loc = faceLocations[ static_cast< size_t >( ( i ) ) ];
-
-            //
-            // Show face locations
-            //
-            cv::rectangle(overlayImage,
-                          loc,
-                          cv::Scalar(0, 255, 0),
-                          sourceImage.rows / 150,
-                          8);
-
-            // Get the mask for the skin
-            auto mask = calculateMask(loc);
-
-            //
-            // Show mask as overlay
-            //
-            cv::Mat maskOverlay;
-            cv::Mat empty =
-                cv::Mat(mask.rows, mask.cols, CV_8UC1, cv::Scalar(0));
-            cv::merge(std::vector<cv::Mat>{mask, empty, empty}, maskOverlay);
-            cv::Mat overlayRoi = overlayImage(loc);
-
-            cv::addWeighted(overlayRoi, 0.75, maskOverlay, 0.5, 0, overlayRoi);
-
-            //
-            // Get the current ROI
-            //
-            cv::Mat roi = sourceImage(loc).clone();
-
-            // Scale the mask values to 0..1
-            mask.convertTo(mask, CV_32F, 1 / 255.0f);
-
-            // Convert the image to float values in range 0..1
-            cv::Mat roiF;
-            roi.convertTo(roiF, CV_32F, 1.0 / 255.0f);
-
-            // Smooth the mask
-            cv::GaussianBlur(mask, mask, cv::Size(7, 7), 0, 0);
-
-            //
-            // Perform filtering
-            //
-
-            // Blur the image using the edge-preserving filter
-            cv::Mat imageBlurred;
-            cv::GaussianBlur(roiF,
-                             imageBlurred,
-                             cv::Size(blurRadius * 2 + 1, blurRadius * 2 + 1),
-                             0);
-
-            // Combine the blurred and the original part of the image, making a
-            // seamless transition between these regions
-
-            // 1) The blurred part
-            cv::Mat mask3F;
-            cv::merge(std::vector<cv::Mat>{mask, mask, mask}, mask3F);
-            cv::multiply(imageBlurred, mask3F, imageBlurred);
-
-            // 2) The original part
-            mask3F.convertTo(mask3F, -1, -1, 1); // invert the mask
-            cv::multiply(roiF, mask3F, roiF);
-
-            // 3) Combined image
-            imageBlurred += roiF;
-
-            imageBlurred.convertTo(imageBlurred, CV_8U, 255.0f);
-
-            imageBlurred.copyTo(roi);
-
-            // Get the result ROI
-            cv::Mat dstRoi = resultImage(loc);
-            imageBlurred.copyTo(dstRoi);
+            if ( ! loc.empty( ) && ( loc & unit.region ) == loc )
+            {
+                unit.faces.push_back( loc );
+            }
         }
-    });
+    }
+
+    //
+    // A single unit runs on this thread, so the filters inside it can use all
+    // threads. A nested cv::parallel_for_ would run sequentially.
+    //
+    if ( smoothingUnits.size( ) == 1 )
+    {
+        smoothUnit( smoothingUnits.front( ) );
+    }
+    else
+    {
+        cv::parallel_for_(
+            cv::Range( 0, static_cast< int >( smoothingUnits.size( ) ) ),
+            [ & ]( const cv::Range& range ) {
+                for ( int i = range.start; i < range.end; i++ )
+                {
+                    smoothUnit( smoothingUnits[ static_cast< size_t >( i ) ] );
+                }
+            } );
+    }
+
+    //
+    // Show face locations. The lines reach beyond the units, so they are
+    // drawn after the parallel part.
+    //
+    for ( const auto& loc : faceLocations )
+    {
+        cv::rectangle( overlayImage,
+                       loc,
+                       cv::Scalar( 0, 255, 0 ),
+                       sourceImage.rows / 150,
+                       8 );
+    }
+
+    updateView( resultImage );
+}
+
+void smoothUnit( SmoothingUnit& unit )
+{
+    //
+    // Skin mask of the unit, the maximum of the masks of its faces
+    //
+    unit.mask.create( unit.region.size( ), CV_8UC1 );
+    unit.mask.setTo( cv::Scalar::all( 0 ) );
+
+    for ( const auto& loc : unit.faces )
+    {
+        calculateMask( loc, unit.faceMask );
+
+        // Show mask as overlay
+        cv::Mat overlayRoi = overlayImage( loc );
+        tintOverlay( overlayRoi, unit.faceMask );
+
+        cv::Mat unitMask = unit.mask( loc - unit.region.tl( ) );
+        cv::max( unitMask, unit.faceMask, unitMask );
+    }
+
+    // Smooth the mask
+    cv::GaussianBlur( unit.mask, unit.mask, cv::Size( 7, 7 ), 0, 0 );
+
+    //
+    // Perform filtering
+    //
+    const cv::Mat roi = sourceImage( unit.region );
+
+    if ( blurRadius > 0 )
+    {
+        // Blur the image using the edge-preserving filter, the blur radius
+        // sets the spatial extent
+        SmoothingParams smoothingParams;
+        smoothingParams.sigmaSpace = 2.0 * blurRadius;
+        smoothingParams.sigmaColor = 20.0;
+        unit.smoother.smooth( roi, unit.smoothed, smoothingParams );
+    }
+    else
+    {
+        roi.copyTo( unit.smoothed );
+    }
 
-    updateView(resultImage);
+    // Combine the blurred and the original part of the image, making a
+    // seamless transition between these regions
+    cv::Mat dstRoi = resultImage( unit.region );
+    blendMasked( unit.smoothed, roi, unit.mask, dstRoi );
+}
+
+void tintOverlay( cv::Mat& overlay, const cv::Mat& mask )
+{
+    // overlay = 0.75 * overlay + 0.5 * ( mask, 0, 0 ), like cv::addWeighted
+    for ( int y = 0; y < overlay.rows; y++ )
+    {
+        uchar* o = overlay.ptr< uchar >( y );
+        const uchar* m = mask.ptr< uchar >( y );
+
+        for ( int x = 0; x < overlay.cols; x++ )
+        {
+            const auto i = static_cast< size_t >( x * 3 );
+
+            o[ i ] = cv::saturate_cast< uchar >(
+                ( 3 * o[ i ] + 2 * m[ x ] + 2 ) >> 2 );
+            o[ i + 1 ] = static_cast< uchar >( ( 3 * o[ i + 1 ] + 2 ) >> 2 );
+            o[ i + 2 ] = static_cast< uchar >( ( 3 * o[ i + 2 ] + 2 ) >> 2 );
+        }
+    }
 }
 
 void reset( )
@@ -382,28 +453,30 @@ void applySkinSmoothing( int, void* )
     skinSmoothing( );
 }
 
-cv::Mat calculateMask( const cv::Rect& faceLocation )
+void calculateMask( const cv::Rect& faceLocation, cv::Mat& mask )
 {
-    std::ignore = faceLocation;
-
     switch ( skinDetector )
     {
     case 0:
     {
-        return meanColorSkinMask( faceLocation );
+        meanColorSkinMask( faceLocation, mask );
+        break;
     }
 
     case 1:
     {
-        return zeroSumGameTheoryModelSkinMask( faceLocation );
+        zeroSumGameTheoryModelSkinMask( faceLocation, mask );
+        break;
     }
 
     default:
-        return { };
+        mask.create( faceLocation.size( ), CV_8UC1 );
+        mask.setTo( cv::Scalar::all( 0 ) );
+        break;
     }
 }
 
-cv::Mat zeroSumGameTheoryModelSkinMask( const cv::Rect& faceLocation )
+void zeroSumGameTheoryModelRule( const cv::Mat& bgr, cv::Mat& mask )
 {
     /*
     Djamila Dahmani, Mehdi Cheref, Slimane Larabi, Zero-sum game theory model
@@ -411,19 +484,14 @@ cv::Mat zeroSumGameTheoryModelSkinMask( const cv::Rect& faceLocation )
     103925,ISSN 0262-8856, https://doi.org/10.1016/j.imavis.2020.103925.
     */
 
-    //
-    // Get the current roi
-    //
-    cv::Mat roi = sourceImage( faceLocation );
-
     //
     // Convert input image to HSV and YCrCb
     //
     cv::Mat imageHsv;
     cv::Mat imageYCrCb;
 
-    cv::cvtColor( roi, imageHsv, cv::COLOR_BGR2HSV );
-    cv::cvtColor( roi, imageYCrCb, cv::COLOR_BGR2YCrCb );
+    cv::cvtColor( bgr, imageHsv, cv::COLOR_BGR2HSV );
+    cv::cvtColor( bgr, imageYCrCb, cv::COLOR_BGR2YCrCb );
 
     //
     // Get the mask in HSV range
@@ -444,25 +512,35 @@ cv::Mat zeroSumGameTheoryModelSkinMask( const cv::Rect& faceLocation )
                  maskYCrCb );
 
     //
-    // Remove some artifacts using morphology
+    // Merge skin masks
     //
-    const cv::Mat element =
-        cv::getStructuringElement( cv::MORPH_RECT, cv::Size( 3, 3 ) );
+    cv::bitwise_and( maskHsv, maskYCrCb, mask );
+}
+
+void zeroSumGameTheoryModelSkinMask( const cv::Rect& faceLocation,
+                                     cv::Mat& mask )
+{
+    //
+    // Get the current roi
+    //
+    cv::Mat roi = sourceImage( faceLocation );
 
-    cv::morphologyEx( maskHsv, maskHsv, cv::MORPH_OPEN, element );
-    cv::morphologyEx( maskYCrCb, maskYCrCb, cv::MORPH_OPEN, element );
+    //
+    // The color rule is tabulated for all colors, one look up per pixel
+    // replaces both color conversions and range checks
+    //
+    zeroSumSkinTable.apply( roi, mask );
 
     //
-    // Merge skin masks
+    // Remove some artifacts using morphology
     //
-    cv::Mat finaleMask;
-    cv::bitwise_and( maskHsv, maskYCrCb, finaleMask );
-    cv::morphologyEx( finaleMask, finaleMask, cv::MORPH_OPEN, element );
+    const cv::Mat element =
+        cv::getStructuringElement( cv::MORPH_RECT, cv::Size( 3, 3 ) );
 
-    return finaleMask;
+    cv::morphologyEx( mask, mask, cv::MORPH_OPEN, element );
 }
 
-cv::Mat meanColorSkinMask( const cv::Rect& faceLocation )
+void meanColorSkinMask( const cv::Rect& faceLocation, cv::Mat& mask )
 {
     //
     // Get the current roi
@@ -470,42 +548,66 @@ cv::Mat meanColorSkinMask( const cv::Rect& faceLocation )
     cv::Mat roi = sourceImage( faceLocation );
 
     //
-    // Convert input image to HSV and YCrCb
+    // The statistics only need a sample of the pixels, take every 4th pixel
+    // in both directions
+    //
+    cv::Mat sample;
+    cv::resize( roi,
+                sample,
+                cv::Size( ( roi.cols + 3 ) / 4, ( roi.rows + 3 ) / 4 ),
+                0,
+                0,
+                cv::INTER_NEAREST );
+
+    //
+    // Convert the sample to HSV
     //
     cv::Mat imageHsv;
 
-    cv::cvtColor( roi, imageHsv, cv::COLOR_BGR2HSV );
+    cv::cvtColor( sample, imageHsv, cv::COLOR_BGR2HSV );
 
     cv::Scalar mean, stdDev;
     cv::meanStdDev( imageHsv, mean, stdDev );
 
-    cv::Scalar lowerBound(
+    const cv::Scalar lowerBound(
         mean[ 0 ] - stdDev[ 0 ], mean[ 1 ] - stdDev[ 1 ], 0 );
 
-    cv::Scalar upperBound(
+    const cv::Scalar upperBound(
         mean[ 0 ] + stdDev[ 0 ], mean[ 1 ] + stdDev[ 1 ], 255 );
 
-    cv::Mat mask;
-    cv::inRange( imageHsv, lowerBound, upperBound, mask );
+    //
+    // With the bounds known the rule only depends on the color. Tabulate it
+    // on a 32^3 grid, cheap enough per face, and look up every pixel.
+    //
+    const ColorRuleTable table(
+        [ & ]( const cv::Mat& bgr, cv::Mat& binMask ) {
+            cv::Mat hsv;
+            cv::cvtColor( bgr, hsv, cv::COLOR_BGR2HSV );
+            cv::inRange( hsv, lowerBound, upperBound, binMask );
 
-    constexpr double maxHue = 360;
+            constexpr double maxHue = 360;
 
-    if ( lowerBound[ 0 ] < 0 && upperBound[ 0 ] < maxHue )
-    {
-        cv::Mat tmpMask;
-        lowerBound[ 0 ] = lowerBound[ 0 ] + maxHue;
-        upperBound[ 0 ] = maxHue;
-        cv::inRange( imageHsv, lowerBound, upperBound, tmpMask );
-        cv::bitwise_or( mask, tmpMask, mask );
-    }
-    else if ( lowerBound[ 0 ] > 0 && upperBound[ 0 ] > maxHue )
-    {
-        cv::Mat tmpMask;
-        lowerBound[ 0 ] = 0;
-        upperBound[ 0 ] = upperBound[ 0 ] - maxHue;
-        cv::inRange( imageHsv, lowerBound, upperBound, tmpMask );
-        cv::bitwise_or( mask, tmpMask, mask );
-    }
+            cv::Scalar lower = lowerBound;
+            cv::Scalar upper = upperBound;
+
+            if ( lower[ 0 ] < 0 && upper[ 0 ] < maxHue )
+            {
+                cv::Mat tmpMask;
+                lower[ 0 ] = lower[ 0 ] + maxHue;
+                upper[ 0 ] = maxHue;
+                cv::inRange( hsv, lower, upper, tmpMask );
+                cv::bitwise_or( binMask, tmpMask, binMask );
+            }
+            else if ( lower[ 0 ] > 0 && upper[ 0 ] > maxHue )
+            {
+                cv::Mat tmpMask;
+                lower[ 0 ] = 0;
+                upper[ 0 ] = upper[ 0 ] - maxHue;
+                cv::inRange( hsv, lower, upper, tmpMask );
+                cv::bitwise_or( binMask, tmpMask, binMask );
+            }
+        },
+        5 );
 
-    return mask;
+    table.apply( roi, mask );
 }
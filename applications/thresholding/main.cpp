@@ -1,3 +1,5 @@
+#include <Benchmark.h>
+#include <FastKernels.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -47,50 +49,62 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     showMat( src, "Input image" );
 
     cv::Mat dst = src.clone( );
-    clock_t t;
-    double cpu_time_used;
 
-    t = clock( );
     thresholdingUsingForLoop( src, dst, thresh, maxValue );
-    t = clock( ) - t;
-    cpu_time_used = ( ( double )t ) / CLOCKS_PER_SEC;
-    std::cout << "Time taken = " << cpu_time_used << "\n";
-
     showMat( dst, "Segmented own" );
 
-    t = clock( );
     cv::threshold( src, dst, thresh, maxValue, cv::THRESH_BINARY );
-    t = clock( ) - t;
-    cpu_time_used = ( ( double )t ) / CLOCKS_PER_SEC;
-    std::cout << "Time taken = " << cpu_time_used << std::endl;
-
     showMat( dst, "Segmented CV", true );
 
-    clock_t t_loop { }, t_opencv { };
-    double time_opencv = 0;
-    double time_loops = 0;
-    double n_samples = 10.0;
+    // The vectorized kernel has to match cv::threshold exactly
+    cv::Mat dstFast;
+    thresholdBinary( src, dstFast, thresh, static_cast< uchar >( maxValue ) );
 
-    for ( int i = 0; i < ( int )n_samples; i++ )
+    if ( cv::countNonZero( dstFast != dst ) == 0 )
+    {
+        std::cout << "thresholdBinary: Images are equal\n";
+    }
+    else
     {
-        t = clock( );
-        thresholdingUsingForLoop( src, dst, thresh, maxValue );
-        t = clock( ) - t;
-        t_loop += t;
-
-        t = clock( );
-        threshold( src, dst, thresh, maxValue, cv::THRESH_BINARY );
-        t = clock( ) - t;
-        t_opencv += t;
+        std::cout << "thresholdBinary: Images not equal\n";
     }
 
-    time_opencv = t_opencv / ( n_samples * CLOCKS_PER_SEC );
-    time_loops = t_loop / ( n_samples * CLOCKS_PER_SEC );
+    // Compare both implementations with the benchmark harness. It warms up
+    // first, measures wall clock time per run and reports the distribution
+    // instead of a single average.
+    BenchmarkParams benchmarkParams;
+    benchmarkParams.iterations = 50;
+    benchmarkParams.pixelsPerIteration = static_cast< int64_t >( src.total( ) );
+    benchmarkParams.perfCounters = true;
+
+    const std::vector< BenchmarkResult > results {
+        runBenchmark(
+            "thresholdingUsingForLoop",
+            [ & ]( ) {
+                thresholdingUsingForLoop( src, dst, thresh, maxValue );
+            },
+            benchmarkParams ),
+        runBenchmark(
+            "cv::threshold",
+            [ & ]( ) {
+                cv::threshold( src, dst, thresh, maxValue, cv::THRESH_BINARY );
+            },
+            benchmarkParams ),
+        runBenchmark(
+            "thresholdBinary",
+            [ & ]( ) {
+                thresholdBinary(
+                    src, dst, thresh, static_cast< uchar >( maxValue ) );
+            },
+            benchmarkParams ) };
+
+    for ( const auto& result : results )
+    {
+        printBenchmark( result, std::cout );
+    }
 
-    std::cout << "Average time taken by For Loop Code = " << time_loops
-              << " seconds\n";
-    std::cout << "Average time taken by OpenCV Code = " << time_opencv
-              << " seconds\n";
+    writeBenchmarkJson( results,
+                        RESULTS_ROOT + "/thresholding_benchmark.json" );
 
     // Other thresholding types
     thresh = 100;
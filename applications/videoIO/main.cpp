@@ -1,3 +1,5 @@
+#include <FrameSink.h>
+#include <FrameSource.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -15,34 +17,28 @@ const std::string RESULTS_ROOT = "C:/images/results";
 
 int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
 {
-    cv::VideoCapture cap( IMAGES_ROOT + "/chaplin.mp4" );
-
-    // Check if camera opened successfully
-    if ( ! cap.isOpened( ) )
-    {
-        std::cout << "Error opening video stream or file" << '\n';
-    }
-
-    // Read until video is completed
-    while ( cap.isOpened( ) )
     {
+        // FrameSource decodes the next frames on a background thread while
+        // the current one is shown. Reading into the same cv::Mat recycles
+        // its buffer.
+        FrameSource cap( IMAGES_ROOT + "/chaplin.mp4" );
+
+        // Check if camera opened successfully
+        if ( ! cap.isOpened( ) )
+        {
+            std::cout << "Error opening video stream or file" << '\n';
+        }
+
+        // Read until video is completed
         cv::Mat frame;
-
-        // Capture frame-by-frame
-        cap >> frame;
-
-        // If the frame is empty, break immediately
-        if ( frame.empty( ) )
-            break;
-
-        // Write the frame into the file 'outputChaplin.mp4'
-        // Wait for 25 ms before moving on to the next frame
-        // This will slow down the video
-        showMat( frame, "Frame", false, 1, 25 );
+        while ( cap.read( frame ) )
+        {
+            // Wait for 25 ms before moving on to the next frame
+            // This will slow down the video
+            showMat( frame, "Frame", false, 1, 25 );
+        }
     }
 
-    cap.release( );
-
     // Let's create the VideoCapture object
     cv::VideoCapture cap2( IMAGES_ROOT + "/chaplin.mp4" );
 
@@ -75,7 +71,7 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     cap2.release( );
 
     // Write a Video
-    cv::VideoCapture cap3( IMAGES_ROOT + "/chaplin.mp4" );
+    FrameSource cap3( IMAGES_ROOT + "/chaplin.mp4" );
 
     // Check if camera opened successfully
     if ( ! cap3.isOpened( ) )
@@ -85,30 +81,21 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
 
     // Default resolutions of the frame are obtained.The default resolutions are
     // system dependent.
-    int32_t frame_width =
-        static_cast< int32_t >( cap3.get( cv::CAP_PROP_FRAME_WIDTH ) );
-    int32_t frame_height =
-        static_cast< int32_t >( cap3.get( cv::CAP_PROP_FRAME_HEIGHT ) );
+    int32_t frame_width = cap3.getFrameSize( ).width;
+    int32_t frame_height = cap3.getFrameSize( ).height;
 
-    // Define the codec and create VideoWriter object.
+    // Define the codec and create the writer. FrameSink encodes on a
+    // background thread, the loop only copies the frames.
     // The output is stored in 'outputChaplin.mp4' file.
-    cv::VideoWriter out( RESULTS_ROOT + "/outputChaplin.mp4",
-                         cv::VideoWriter::fourcc( 'M', 'J', 'P', 'G' ),
-                         10,
-                         cv::Size( frame_width, frame_height ) );
+    FrameSink out( RESULTS_ROOT + "/outputChaplin.mp4",
+                   cv::VideoWriter::fourcc( 'M', 'J', 'P', 'G' ),
+                   10,
+                   cv::Size( frame_width, frame_height ) );
 
     // Read until video is completed
-    while ( cap3.isOpened( ) )
+    cv::Mat frameRead;
+    while ( cap3.read( frameRead ) )
     {
-        cv::Mat frameRead;
-
-        // Capture frame-by-frame
-        cap3 >> frameRead;
-
-        // If the frame is empty, break immediately
-        if ( frameRead.empty( ) )
-            break;
-
         // Write the frame into the file 'outputChaplin.mp4'
         out.write( frameRead );
 
@@ -120,9 +107,8 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
 
     cv::waitKey( 0 );
 
-    // When everything done, release the VideoCapture and VideoWriter objects
-    cap3.release( );
-    out.release( );
+    // When everything done, encode the remaining frames and close the file
+    out.close( );
 
     cv::destroyAllWindows( );
 
@@ -1,3 +1,6 @@
+#include <FeatureTracking.h>
+#include <FrameSink.h>
+#include <FrameSource.h>
 #include <GUI.h>
 #include <macros.h>
 
@@ -129,35 +132,45 @@ void fixBorder( cv::Mat& frame_stabilized )
 
 int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
 {
-    // Read input video
-    cv::VideoCapture cap( IMAGES_ROOT + "/video.mp4" );
+    // Read input video, decoded ahead on a background thread
+    const std::string videoFileName = IMAGES_ROOT + "/video.mp4";
+    FrameSource cap( videoFileName );
 
     // Get frame count
-    int n_frames = static_cast< int >( cap.get( cv::CAP_PROP_FRAME_COUNT ) );
+    int n_frames = static_cast< int >( cap.getFrameCount( ) );
 
     // Get width and height of video stream
-    int w = static_cast< int >( cap.get( cv::CAP_PROP_FRAME_WIDTH ) );
-    int h = static_cast< int >( cap.get( cv::CAP_PROP_FRAME_HEIGHT ) );
+    int w = cap.getFrameSize( ).width;
+    int h = cap.getFrameSize( ).height;
 
     // Get frames per second (fps)
-    double fps = cap.get( cv::CAP_PROP_FPS );
+    double fps = cap.getFps( );
 
     // Set up output video
-    cv::VideoWriter out( RESULTS_ROOT + "/video_out.avi",
-                         cv::VideoWriter::fourcc( 'M', 'J', 'P', 'G' ),
-                         fps,
-                         cv::Size( 2 * w, h ) );
+    FrameSink out( RESULTS_ROOT + "/video_out.avi",
+                   cv::VideoWriter::fourcc( 'M', 'J', 'P', 'G' ),
+                   fps,
+                   cv::Size( 2 * w, h ) );
 
     // Define variable for storing frames
     cv::Mat curr, curr_gray;
     cv::Mat prev, prev_gray;
 
     // Read first frame
-    cap >> prev;
+    cap.read( prev );
 
     // Convert frame to grayscale
     cv::cvtColor( prev, prev_gray, cv::COLOR_BGR2GRAY );
 
+    // Features are detected once and then tracked from frame to frame. Only
+    // grid cells that lost all their features get new corners.
+    KltTrackerParams trackerParams;
+    trackerParams.maxFeatures = 200;
+    trackerParams.qualityLevel = 0.01;
+    trackerParams.minDistance = 30;
+    KltTracker tracker( trackerParams );
+    tracker.update( prev_gray );
+
     // Pre-define transformation-store array
     std::vector< TransformParam > transforms;
 
@@ -165,12 +178,6 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
 
     for ( int i = 1; i < n_frames - 1; i++ )
     {
-        // Vector from previous and current feature points
-        std::vector< cv::Point2f > prev_pts, curr_pts;
-
-        // Detect features in previous frame
-        cv::goodFeaturesToTrack( prev_gray, prev_pts, 200, 0.01, 30 );
-
         // Read next frame
         bool success = cap.read( curr );
 
@@ -182,30 +189,12 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
         // Convert to grayscale
         cv::cvtColor( curr, curr_gray, cv::COLOR_BGR2GRAY );
 
-        // Calculate optical flow (i.e. track feature points)
-        std::vector< uchar > status;
-        std::vector< float > err;
+        // Track feature points (optical flow), failed ones are dropped
+        tracker.update( curr_gray );
 
-        cv::calcOpticalFlowPyrLK(
-            prev_gray, curr_gray, prev_pts, curr_pts, status, err );
+        const auto& prev_pts = tracker.getPreviousPoints( );
+        const auto& curr_pts = tracker.getTrackedPoints( );
 
-        // Filter only valid points
-        auto prev_it = prev_pts.begin( );
-        auto curr_it = curr_pts.begin( );
-
-        for ( size_t k = 0; k < status.size( ); k++ )
-        {
-            if ( status[ k ] )
-            {
-                prev_it++;
-                curr_it++;
-            }
-            else
-            {
-                prev_it = prev_pts.erase( prev_it );
-                curr_it = curr_pts.erase( curr_it );
-            }
-        }
         // Find transformation matrix
         cv::Mat T = cv::estimateAffinePartial2D( prev_pts, curr_pts );
 
@@ -228,9 +217,6 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
         // Store transformation
         transforms.emplace_back( dx, dy, da );
 
-        // Move to next frame
-        curr_gray.copyTo( prev_gray );
-
         std::cout << "Frame: " << i << "/" << n_frames
                   << " -  Tracked points : " << prev_pts.size( ) << '\n';
     }
@@ -259,14 +245,16 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
         transforms_smooth.emplace_back( dx, dy, da );
     }
 
-    cap.set( cv::CAP_PROP_POS_FRAMES, 0 );
+    // Read the video again from the start. A FrameSource can't seek, its
+    // decode thread is ahead of the consumer.
+    FrameSource replay( videoFileName );
 
     cv::Mat T( 2, 3, CV_64F );
     cv::Mat frame, frame_stabilized, frame_out;
 
     for ( int i = 0; i < n_frames - 1; i++ )
     {
-        bool success = cap.read( frame );
+        bool success = replay.read( frame );
 
         if ( ! success )
         {
@@ -299,8 +287,7 @@ int main( [[maybe_unused]] int argc, [[maybe_unused]] char** argv )
     }
 
     // Release video
-    cap.release( );
-    out.release( );
+    out.close( );
 
     // Clean up
     cv::destroyAllWindows( );
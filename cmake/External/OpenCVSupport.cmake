@@ -41,6 +41,20 @@ if (BUILD_WITH_OPENCV_CONTRIB)
 
 endif()
 
+if (BUILD_WITH_OPENVINO)
+
+    # Inference engine backend of the dnn module (DNN_BACKEND_INFERENCE_ENGINE)
+    list(APPEND OpenCV_DEPENDS "openvino")
+
+    list(APPEND OPENCV_EXTRA_BUILD_FLAGS
+        -DWITH_INF_ENGINE:BOOL=ON
+        -DWITH_NGRAPH:BOOL=ON
+        -DInferenceEngine_DIR:PATH=${InferenceEngine_DIR}
+        -Dngraph_DIR:PATH=${ngraph_DIR}
+    )
+
+endif()
+
 MESSAGE(STATUS "OPENCV_EXTRA_BUILD_FLAGS: ${OPENCV_EXTRA_BUILD_FLAGS}")
 
 ExternalProject_Add(
@@ -31,6 +31,11 @@ if( BUILD_WITH_NLOHMAN_JSON )
     include( NLohmannJsonSupport )
 endif( BUILD_WITH_NLOHMAN_JSON )
 
+# OpenCV is built against OpenVINO, so it has to be added first
+if( BUILD_WITH_OPENVINO )
+    include( OpenVinoSupport )
+endif( BUILD_WITH_OPENVINO )
+
 if( BUILD_WITH_OPENCV )
     include( OpenCVSupport )
 endif( BUILD_WITH_OPENCV )
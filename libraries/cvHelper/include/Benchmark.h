@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct BenchmarkParams
+{
+    // Untimed runs before measuring, so caches, page mappings and lazily
+    // allocated buffers are warm
+    int32_t warmupIterations = 3;
+    int32_t iterations = 30;
+
+    // Pixels processed per run, used to report throughput. 0 disables it.
+    int64_t pixelsPerIteration = 0;
+
+    // Collect hardware counters (cycles, instructions, cache and branch
+    // misses) with perf_event_open. Only available on Linux; the counters are
+    // left empty elsewhere or if the kernel denies access. The counters cover
+    // the calling thread only, so the kernel runs with cv::setNumThreads( 1 )
+    // and the timings are single threaded as well.
+    bool perfCounters = false;
+};
+
+struct BenchmarkResult
+{
+    std::string name;
+    int32_t iterations = 0;
+
+    // Wall clock times of the single runs in milliseconds, measured with
+    // std::chrono::steady_clock
+    double minMs = 0.0;
+    double meanMs = 0.0;
+    double medianMs = 0.0;
+    double p95Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+    double stdDevMs = 0.0;
+
+    // Based on the median, 0 if no pixel count was given
+    double megaPixelsPerSecond = 0.0;
+
+    // Hardware counters per run, averaged over all timed runs
+    std::map< std::string, double > perfCounters;
+
+    std::vector< double > samplesMs;
+};
+
+// Run kernel warmupIterations + iterations times and return the statistics of
+// the timed runs.
+CVHELPER_EXPORT
+BenchmarkResult runBenchmark( const std::string& name,
+                              const std::function< void( ) >& kernel,
+                              const BenchmarkParams& params = { } );
+
+// Human readable one line summary
+CVHELPER_EXPORT
+void printBenchmark( const BenchmarkResult& result, std::ostream& stream );
+
+// JSON array of the results without the raw samples
+CVHELPER_EXPORT
+std::string benchmarkToJson( const std::vector< BenchmarkResult >& results );
+
+// Write benchmarkToJson( ) to a file. Returns false if it can't be opened.
+CVHELPER_EXPORT
+bool writeBenchmarkJson( const std::vector< BenchmarkResult >& results,
+                         const std::string& fileName );
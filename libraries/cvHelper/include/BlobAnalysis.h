@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+IGNORE_WARNINGS_POP
+
+// Statistics of a single connected component. All values are accumulated
+// while the component is labeled, so no additional pass over the label image
+// is required.
+struct BlobStatistics
+{
+    int32_t label = 0;
+    int64_t area = 0;
+    cv::Rect boundingBox;
+    cv::Point2d centroid;
+    cv::Moments moments;
+};
+
+// Run-length based connected component labeling of a CV_8UC1 image. Every non
+// zero pixel is treated as foreground.
+//
+// The image is scanned once and converted into horizontal runs. Runs are
+// joined with a union-find structure and the spatial moments of every run are
+// added to its provisional component in closed form, so area, bounding box,
+// centroid and moments up to third order are available right after the scan.
+//
+// labels:       Optional CV_32S label image. Background is 0, blobs are
+//               numbered 1..N in raster order of their first pixel.
+//               Pass cv::noArray( ) to skip writing the label image.
+// blobs:        Statistics of all N blobs, blobs[ i ].label == i + 1.
+// connectivity: 4 or 8.
+// numStrips:    Number of horizontal strips labeled in parallel. The strips
+//               are merged along their borders afterwards. 1 runs
+//               sequentially, 0 selects the strip count from the number of
+//               OpenCV threads.
+//
+// Returns the number of labels including the background, like
+// cv::connectedComponents.
+CVHELPER_EXPORT
+int32_t labelRunLength( const cv::Mat& binary, cv::OutputArray labels,
+                        std::vector< BlobStatistics >& blobs,
+                        int32_t connectivity = 8, int32_t numStrips = 1 );
+
+// Colorize a CV_32S label image with the JET color map in a single pass. Looks
+// the same as normalizing the labels to 0..255 and calling cv::applyColorMap,
+// but without the intermediate images.
+CVHELPER_EXPORT
+cv::Mat colorizeLabels( const cv::Mat& labels, int32_t numLabels );
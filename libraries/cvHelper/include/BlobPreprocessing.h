@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+IGNORE_WARNINGS_POP
+
+struct BlobParams
+{
+    // Network input size
+    cv::Size size = cv::Size( 224, 224 );
+
+    // blob = ( pixel - mean ) * scale, mean in the channel order of the blob
+    double scale = 1.0;
+    cv::Scalar mean = cv::Scalar( 0, 0, 0 );
+
+    // Write BGR input as RGB planes
+    bool swapRB = false;
+};
+
+// Network input blobs from BGR images in a single pass.
+//
+// cv::dnn::blobFromImage resizes, converts to float, swaps the channels,
+// subtracts the mean, scales and transposes from interleaved (HWC) to planar
+// (CHW) layout, each as a separate pass over a temporary image. This does all
+// of it per output pixel: bilinear interpolation with the pixel center
+// convention of cv::resize( INTER_LINEAR ), one multiply add per channel and a
+// store into the plane of the blob. Output rows run in parallel. The blob and
+// the interpolation tables are kept and reused while the sizes stay the same.
+//
+// The result equals blobFromImage( image, scale, size, mean, swapRB, false )
+// up to the fixed point rounding cv::resize uses for 8 bit images, at most
+// one intensity level before scaling.
+class CVHELPER_EXPORT BlobPreprocessor
+{
+public:
+    explicit BlobPreprocessor( const BlobParams& _params = { } );
+
+    // 1 x 3 x height x width CV_32F blob of a CV_8UC3 image. The returned blob
+    // is overwritten by the next call.
+    const cv::Mat& process( const cv::Mat& image );
+
+    // N x 3 x height x width blob of N CV_8UC3 images of any sizes
+    const cv::Mat& process( const std::vector< cv::Mat >& images );
+
+    const BlobParams& getParams( ) const { return params; }
+
+private:
+    void updateTables( cv::Size imageSize );
+    void fill( const cv::Mat& image, float* planes );
+
+    BlobParams params;
+    cv::Mat blob;
+
+    // Source size the tables were built for
+    cv::Size tableSize;
+
+    // Per output column the byte offsets of the left and right source pixel
+    // and the weight of the right one, per output row the same for the rows
+    std::vector< int32_t > left;
+    std::vector< int32_t > right;
+    std::vector< float > weightX;
+    std::vector< int32_t > top;
+    std::vector< int32_t > bottom;
+    std::vector< float > weightY;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+IGNORE_WARNINGS_POP
+
+// Binary decision over BGR colors, evaluated once per color and looked up per
+// pixel afterwards.
+//
+// A rule chaining color conversions and range checks (e.g. a skin color
+// model) costs several full image passes. If it only depends on the color of
+// the pixel, it can be tabulated: the rule is run once on an image holding
+// every color of a grid with 2^bits values per channel and the results are
+// stored as a bitset. With 8 bits all 2^24 colors are tabulated exactly in
+// 2 MiB. Fewer bits evaluate the rule at the bin centers, which is cheap
+// enough to rebuild the table per image region, at the cost of exactness
+// close to the rule boundaries.
+class CVHELPER_EXPORT ColorRuleTable
+{
+public:
+    // Maps a CV_8UC3 BGR image to a CV_8UC1 mask, non zero inside the rule.
+    // Has to be a pure per pixel function of the color and thread safe.
+    using Rule = std::function< void( const cv::Mat& bgr, cv::Mat& mask ) >;
+
+    ColorRuleTable( ) = default;
+    explicit ColorRuleTable( const Rule& rule, int32_t _bits = 8 );
+
+    // Tabulate rule with 2^_bits values per channel, _bits in 1..8. The rule
+    // is evaluated in parallel, one slice of the color cube per call.
+    void build( const Rule& rule, int32_t _bits = 8 );
+
+    // Look up every pixel of a CV_8UC3 BGR image. mask becomes CV_8UC1, 255
+    // inside the rule and 0 outside. Rows run in parallel.
+    void apply( const cv::Mat& bgr, cv::Mat& mask ) const;
+
+    bool empty( ) const { return table.empty( ); }
+
+private:
+    int32_t bits = 0;
+
+    // One bit per color, index ( r << 2 * bits ) | ( g << bits ) | b of the
+    // channel values reduced to bits
+    std::vector< uint64_t > table;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/video/tracking.hpp>
+IGNORE_WARNINGS_POP
+
+enum class DenseFlowMethod
+{
+    // cv::DISOpticalFlow, fast and the default for real time use
+    Dis,
+
+    // cv::FarnebackOpticalFlow, smoother but several times slower
+    Farneback
+};
+
+struct DenseFlowParams
+{
+    DenseFlowMethod method = DenseFlowMethod::Dis;
+
+    // cv::DISOpticalFlow::PRESET_ULTRAFAST, _FAST or _MEDIUM
+    int32_t disPreset = cv::DISOpticalFlow::PRESET_FAST;
+
+    // The flow is computed at this fraction of the input size and upsampled
+    // to full resolution. 1 disables the downscaling.
+    double scale = 0.5;
+
+    // Tiles per column and row, processed in parallel. Each tile has its own
+    // flow instance.
+    cv::Size tiles = cv::Size( 2, 2 );
+
+    // Pixels (at the processing scale) a tile reaches into its neighbors.
+    // Only the inner part of a tile is used, so motion crossing the tile
+    // borders is still seen and there are no seams.
+    int32_t overlap = 16;
+};
+
+// Dense optical flow of a grayscale sequence, see DenseFlowParams.
+class CVHELPER_EXPORT DenseOpticalFlow
+{
+public:
+    explicit DenseOpticalFlow( const DenseFlowParams& _params = { } );
+
+    // Flow from the previous frame to this CV_8UC1 frame as CV_32FC2 in
+    // pixels of the input size. Returns false for the first frame, which
+    // only initializes the previous frame.
+    bool update( const cv::Mat& gray, cv::Mat& flow );
+
+    // Forget the previous frame
+    void reset( ) { previous.release( ); }
+
+private:
+    DenseFlowParams params;
+
+    // One instance per tile, the OpenCV algorithms keep per call state
+    std::vector< cv::Ptr< cv::DenseOpticalFlow > > tileFlows;
+    std::vector< cv::Rect > tileRects;
+    std::vector< cv::Mat > tileResults;
+
+    cv::Mat previous;
+    cv::Mat current;
+    cv::Mat smallFlow;
+};
+
+// Color coded flow: hue is the direction, brightness the magnitude relative
+// to maxMagnitude (0: the largest magnitude in the field)
+CVHELPER_EXPORT
+cv::Mat flowToColor( const cv::Mat& flow, double maxMagnitude = 0.0 );
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <string>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/dnn.hpp>
+IGNORE_WARNINGS_POP
+
+enum class DnnBackend
+{
+    // OpenCV's own implementation on the CPU in FP32, always available
+    OpenCV,
+
+    // OpenCV on an OpenCL device with FP16 weights and activations
+    OpenCLFP16,
+
+    // OpenVINO inference engine with the CPU plugin. Needs OpenCV built with
+    // BUILD_WITH_OPENVINO. Besides the original model it runs OpenVINO IR
+    // models (.xml / .bin), e.g. INT8 models from post training quantization.
+    OpenVino
+};
+
+// "opencv", "fp16" or "openvino"
+CVHELPER_EXPORT
+const char* getDnnBackendName( DnnBackend backend );
+
+// Inverse of getDnnBackendName( ). Returns false for an unknown name.
+CVHELPER_EXPORT
+bool parseDnnBackend( const std::string& name, DnnBackend& backend );
+
+// Whether the OpenCV build and the machine support the backend
+CVHELPER_EXPORT
+bool isDnnBackendAvailable( DnnBackend backend );
+
+// Select backend and target of net. An unavailable backend leaves net on
+// DnnBackend::OpenCV and returns false.
+CVHELPER_EXPORT
+bool setDnnBackend( cv::dnn::Net& net, DnnBackend backend );
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+IGNORE_WARNINGS_POP
+
+enum class SmoothingBackend
+{
+    // cv::bilateralFilter, the reference. Cost grows with sigmaSpace squared.
+    Bilateral,
+
+    // Bilateral filter on a downsampled (x, y, intensity) grid: splat, blur,
+    // trilinear slice. Cost nearly independent of sigmaSpace.
+    BilateralGrid,
+
+    // Self guided filter from box filtered statistics, O( 1 ) per pixel
+    Guided,
+
+    // Domain transform with the recursive filter, O( 1 ) per pixel
+    DomainTransform
+};
+
+struct SmoothingParams
+{
+    SmoothingBackend backend = SmoothingBackend::DomainTransform;
+
+    // Spatial extent in pixels and range extent in intensity levels (0..255)
+    double sigmaSpace = 10.0;
+    double sigmaColor = 30.0;
+
+    // Quality / speed trade off in ( 0, 1 ]. Lower values use a coarser
+    // bilateral grid, compute the guided filter coefficients on a subsampled
+    // image and run fewer domain transform iterations.
+    double quality = 1.0;
+};
+
+// Edge preserving smoothing with the working images kept in the instance.
+// Repeated calls on images of the same size reuse them instead of allocating
+// the float copy, grid and coefficient images again.
+class CVHELPER_EXPORT EdgePreservingSmoother
+{
+public:
+    // See smoothEdgePreserving( )
+    void smooth( const cv::Mat& src, cv::Mat& dst,
+                 const SmoothingParams& params = { } );
+
+private:
+    void bilateralGrid( const cv::Mat& src, const SmoothingParams& params );
+    void guidedFilter( const cv::Mat& src, const SmoothingParams& params );
+    void domainTransform( const cv::Mat& src, const SmoothingParams& params );
+
+    cv::Mat result;
+
+    // Bilateral grid
+    cv::Mat gray;
+    std::vector< float > grid;
+    std::vector< float > blurred;
+
+    // Guided filter and domain transform
+    cv::Mat image;
+    cv::Mat small;
+    cv::Mat meanA;
+    cv::Mat meanB;
+    cv::Mat fullA;
+    cv::Mat fullB;
+    cv::Mat dHdx;
+    cv::Mat dVdy;
+    cv::Mat weights;
+};
+
+// Edge preserving smoothing of a CV_8UC1 or CV_8UC3 image with the selected
+// backend. All backends except Bilateral are parallelized with
+// cv::parallel_for_. dst gets the type of src, src and dst may be the same.
+CVHELPER_EXPORT
+void smoothEdgePreserving( const cv::Mat& src, cv::Mat& dst,
+                           const SmoothingParams& params = { } );
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+IGNORE_WARNINGS_POP
+
+// Same result as cv::threshold( src, dst, thresh, maxValue,
+// cv::THRESH_BINARY ) for CV_8UC1 images. Works on row pointers with OpenCV
+// universal intrinsics instead of per pixel at< uchar >( ) access.
+CVHELPER_EXPORT
+void thresholdBinary( const cv::Mat& src, cv::Mat& dst, int32_t thresh,
+                      uchar maxValue );
+
+// Dilation / erosion of a CV_8UC1 image with a rectangular structuring element
+// of size ksize and centered anchor. Same result as cv::dilate / cv::erode
+// with cv::getStructuringElement( cv::MORPH_RECT, ksize ) and the default
+// border.
+//
+// The rectangle is separated into a horizontal and a vertical pass, each
+// using the van Herk/Gil-Werman algorithm: block wise prefix and suffix
+// extrema give every window result with three comparisons per pixel,
+// independent of the kernel size.
+CVHELPER_EXPORT
+void dilateRect( const cv::Mat& src, cv::Mat& dst, cv::Size ksize );
+
+CVHELPER_EXPORT
+void erodeRect( const cv::Mat& src, cv::Mat& dst, cv::Size ksize );
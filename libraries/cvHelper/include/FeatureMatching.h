@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+IGNORE_WARNINGS_POP
+
+struct FeatureMatchingParams
+{
+    // Fraction of the best matches to keep after all other filters. Values
+    // <= 0 or >= 1 keep every match.
+    float goodMatchPercent = 0.15f;
+
+    // Lowe's ratio test. A match is kept only if its distance is smaller than
+    // ratio times the distance of the second best candidate. 0 disables the
+    // test.
+    float ratio = 0.0f;
+
+    // Keep only matches where the query descriptor is also the best match of
+    // its train descriptor.
+    bool crossCheck = false;
+};
+
+struct FeatureMatches
+{
+    std::vector< cv::DMatch > matches;
+
+    // Contiguous point arrays in the order of matches, ready to be passed to
+    // cv::findHomography.
+    std::vector< cv::Point2f > queryPoints;
+    std::vector< cv::Point2f > trainPoints;
+};
+
+// Hamming distance of two binary descriptors of length bytes. Descriptors
+// with a multiple of 8 bytes (e.g. 32 byte ORB) are compared with 64 bit
+// popcounts, others with cv::hal::normHamming.
+CVHELPER_EXPORT
+uint32_t hammingDistance( const uchar* a, const uchar* b, int32_t length );
+
+// Brute force matching of query against train descriptors. CV_8U descriptors
+// are treated as binary and compared with hammingDistance( ) in parallel,
+// other types are matched with cv::BFMatcher and NORM_L2. The best two
+// candidates are tracked per query, so the ratio test needs no extra pass.
+// The result is not sorted.
+CVHELPER_EXPORT
+std::vector< cv::DMatch >
+matchDescriptors( const cv::Mat& queryDescriptors,
+                  const cv::Mat& trainDescriptors,
+                  const FeatureMatchingParams& params = { } );
+
+// Keep the best fraction of the matches. Uses std::nth_element instead of a
+// full sort, so the kept matches are in no particular order.
+CVHELPER_EXPORT
+void keepBestMatches( std::vector< cv::DMatch >& matches, float fraction );
+
+// Copy the keypoint locations of the matches into two contiguous arrays.
+CVHELPER_EXPORT
+void extractMatchedPoints( const std::vector< cv::KeyPoint >& queryKeypoints,
+                           const std::vector< cv::KeyPoint >& trainKeypoints,
+                           const std::vector< cv::DMatch >& matches,
+                           std::vector< cv::Point2f >& queryPoints,
+                           std::vector< cv::Point2f >& trainPoints );
+
+// matchDescriptors( ) followed by extractMatchedPoints( ).
+CVHELPER_EXPORT
+FeatureMatches matchFeatures( const std::vector< cv::KeyPoint >& queryKeypoints,
+                              const cv::Mat& queryDescriptors,
+                              const std::vector< cv::KeyPoint >& trainKeypoints,
+                              const cv::Mat& trainDescriptors,
+                              const FeatureMatchingParams& params = { } );
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+IGNORE_WARNINGS_POP
+
+struct KltTrackerParams
+{
+    // Upper limit of tracked features
+    int32_t maxFeatures = 200;
+
+    // Replenishment grid in cells. New corners are only detected in cells
+    // without any tracked feature, at most maxFeatures / cell count per cell.
+    cv::Size gridSize = cv::Size( 8, 8 );
+
+    // cv::goodFeaturesToTrack parameters
+    double qualityLevel = 0.01;
+    double minDistance = 10.0;
+    int32_t blockSize = 7;
+
+    // cv::calcOpticalFlowPyrLK parameters
+    cv::Size winSize = cv::Size( 21, 21 );
+    int32_t maxLevel = 3;
+    cv::TermCriteria criteria = cv::TermCriteria(
+        cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 30, 0.01 );
+};
+
+// Pyramidal Lucas-Kanade tracker keeping a set of features over a sequence.
+//
+// Every update( ) tracks the features of the previous frame, drops the ones
+// that failed or left the image and detects new corners in grid cells that
+// ran empty. The image pyramid of a frame is built once and reused as the
+// previous pyramid for the next frame.
+class CVHELPER_EXPORT KltTracker
+{
+public:
+    explicit KltTracker( const KltTrackerParams& _params = { } );
+
+    // Process the next CV_8UC1 frame. The first frame only detects features.
+    void update( const cv::Mat& gray );
+
+    // Forget all features and the previous frame
+    void reset( );
+
+    // Features of the latest frame: the tracked ones first, followed by the
+    // ones detected in this update. ids are unique over the tracker lifetime
+    // and stay the same while a feature is tracked.
+    const std::vector< cv::Point2f >& getPoints( ) const { return points; }
+    const std::vector< int64_t >& getIds( ) const { return ids; }
+
+    // Features tracked by the latest update( ): their position in the
+    // previous frame and in the latest frame, index aligned. These are the
+    // first getNumTracked( ) entries of getPoints( ).
+    const std::vector< cv::Point2f >& getPreviousPoints( ) const
+    {
+        return previousPoints;
+    }
+    const std::vector< cv::Point2f >& getTrackedPoints( ) const
+    {
+        return trackedPoints;
+    }
+    size_t getNumTracked( ) const { return trackedPoints.size( ); }
+
+private:
+    void track( );
+    void replenish( const cv::Mat& gray );
+
+    KltTrackerParams params;
+
+    std::vector< cv::Mat > pyramid;
+    std::vector< cv::Mat > previousPyramid;
+    int32_t pyramidLevels = 0;
+
+    std::vector< cv::Point2f > points;
+    std::vector< int64_t > ids;
+    std::vector< cv::Point2f > previousPoints;
+    std::vector< cv::Point2f > trackedPoints;
+    int64_t nextId = 0;
+
+    // Scratch buffers kept between frames
+    std::vector< cv::Point2f > lkPoints;
+    std::vector< uchar > lkStatus;
+    std::vector< float > lkError;
+    std::vector< cv::Point2f > corners;
+    std::vector< int32_t > cellCounts;
+    cv::Mat mask;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+IGNORE_WARNINGS_POP
+
+struct FrameSinkParams
+{
+    // Frames queued per writer thread before write( ) blocks. Bounds the
+    // memory to numWriters * queueSize frames.
+    int32_t queueSize = 8;
+
+    // Frames per output file, 0 writes a single file. Segments are named
+    // <name>_<index><extension>, e.g. out_0000.avi, out_0001.avi, ...
+    int64_t segmentLength = 0;
+
+    // Writer threads. Consecutive segments go to different writers and are
+    // encoded in parallel, so more than one requires segmentLength > 0.
+    int32_t numWriters = 1;
+};
+
+// Drop-in replacement for cv::VideoWriter that encodes on background
+// threads, so the processing loop only pays for copying the frame.
+//
+// write( ) is meant to be called from a single thread. Frames are copied
+// into recycled buffers, the caller may modify its frame right after the
+// call. close( ) (also called by the destructor) writes everything queued
+// before it returns.
+class CVHELPER_EXPORT FrameSink
+{
+public:
+    FrameSink( const std::string& _fileName, int32_t _fourcc, double _fps,
+               cv::Size _frameSize, bool _isColor = true,
+               const FrameSinkParams& _params = { } );
+    ~FrameSink( );
+
+    FrameSink( const FrameSink& ) = delete;
+    FrameSink& operator=( const FrameSink& ) = delete;
+
+    // True if the first output file could be opened
+    bool isOpened( ) const { return opened; }
+
+    // Queue a copy of frame. Blocks only while the queue of the responsible
+    // writer is full. Ignored after close( ).
+    void write( const cv::Mat& frame );
+
+    // Wait until every queued frame is encoded
+    void flush( );
+
+    // flush( ), then release the writers and stop their threads
+    void close( );
+
+    int64_t getWrittenFrames( ) const;
+
+private:
+    struct Pending
+    {
+        cv::Mat frame;
+        int64_t segment;
+    };
+
+    struct Writer
+    {
+        std::deque< Pending > queue;
+        bool busy = false;
+        cv::VideoWriter videoWriter;
+        int64_t segment = -1;
+        std::thread thread;
+    };
+
+    std::string segmentFileName( int64_t segment ) const;
+    void run( Writer& writer );
+
+    std::string fileName;
+    int32_t fourcc;
+    double fps;
+    cv::Size frameSize;
+    bool isColor;
+    FrameSinkParams params;
+
+    bool opened = false;
+    int64_t frameIndex = 0;
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::vector< std::unique_ptr< Writer > > writers;
+    std::vector< cv::Mat > pool;
+    int64_t writtenFrames = 0;
+    bool closing = false;
+    bool closed = false;
+};
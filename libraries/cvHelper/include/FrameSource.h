@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+IGNORE_WARNINGS_POP
+
+enum class FrameDropPolicy
+{
+    // The decoder waits until the consumer took a frame. Nothing is lost,
+    // the right choice for files.
+    Block,
+
+    // A full queue discards its oldest frame, so the consumer always gets the
+    // most recent ones. For live sources where latency matters.
+    DropOldest,
+
+    // A full queue discards the frame just decoded. For live sources where a
+    // continuous sequence matters more than latency.
+    DropNewest
+};
+
+struct FrameSourceParams
+{
+    // Decoded frames buffered ahead of the consumer
+    int32_t queueSize = 4;
+
+    FrameDropPolicy dropPolicy = FrameDropPolicy::Block;
+
+    // Restart at the first frame when the end of a file is reached, read( )
+    // then never runs out of frames
+    bool loop = false;
+};
+
+// Reads a video or camera on a background thread, so decoding the next
+// frames overlaps with processing the current one.
+//
+// Frames are decoded into a pool of recycled buffers. read( ) swaps the
+// buffer of the passed frame back into the pool, so a loop reading into the
+// same cv::Mat doesn't allocate once the pool is warm. A buffer that is still
+// referenced elsewhere (e.g. a clone-free copy of the previous frame) is never
+// overwritten; the pool lets go of it and allocates a new one instead.
+class CVHELPER_EXPORT FrameSource
+{
+public:
+    explicit FrameSource( const std::string& fileName,
+                          const FrameSourceParams& params = { } );
+    explicit FrameSource( int32_t cameraIndex,
+                          const FrameSourceParams& params = { } );
+    ~FrameSource( );
+
+    FrameSource( const FrameSource& ) = delete;
+    FrameSource& operator=( const FrameSource& ) = delete;
+
+    bool isOpened( ) const { return opened; }
+
+    // Next frame in decode order. Blocks until it is available and returns
+    // false once the source is exhausted.
+    bool read( cv::Mat& frame );
+
+    // Capture properties, read once when the source was opened
+    double getFps( ) const { return fps; }
+    cv::Size getFrameSize( ) const { return frameSize; }
+
+    // Number of frames reported by the container, -1 for live sources
+    int64_t getFrameCount( ) const { return frameCount; }
+
+    // Frames discarded by DropOldest / DropNewest
+    int64_t getDroppedFrames( ) const;
+
+private:
+    void start( );
+    void run( );
+
+    FrameSourceParams params;
+    cv::VideoCapture capture;
+
+    bool opened = false;
+    double fps = 0.0;
+    cv::Size frameSize;
+    int64_t frameCount = -1;
+
+    mutable std::mutex mutex;
+    std::condition_variable frameReady;
+    std::condition_variable slotFree;
+    std::deque< cv::Mat > queue;
+    std::vector< cv::Mat > pool;
+    int64_t droppedFrames = 0;
+    bool finished = false;
+    bool stop = false;
+
+    std::thread thread;
+};
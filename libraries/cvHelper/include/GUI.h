@@ -3,7 +3,17 @@
 #include <cvHelper/export.h>
 
 // STD includes
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <initializer_list>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <macros.h>
@@ -19,62 +29,272 @@ namespace cv
 class Mat;
 }
 
+// Destination of everything passed to showMat / showBar. The global sink is
+// created on first use from the environment variable CVHELPER_DISPLAY:
+//   window  - HighGUI window (default)
+//   file    - write PNG files to CVHELPER_DISPLAY_DIR (default: working dir)
+//   none    - discard, no HighGUI calls at all
+//   capture - keep copies in memory, see CaptureDisplaySink
+//   async   - windows updated by a display thread at CVHELPER_DISPLAY_FPS
+//             (default 30), see AsyncDisplaySink
+// Applications that take input through HighGUI (trackbars, mouse callbacks,
+// key loops) draw into their windows directly and need the window sink.
+class CVHELPER_EXPORT DisplaySink
+{
+public:
+    virtual ~DisplaySink( ) = default;
+
+    virtual void show( const cv::Mat& image, const std::string& name,
+                       bool wait, double scale, int32_t waitTime ) = 0;
+
+    // False if images are dropped anyway, so callers can skip rendering them
+    virtual bool acceptsImages( ) const { return true; }
+
+    // Called by AsyncDisplaySink from its display thread when there is
+    // nothing new to show, and before the thread ends
+    virtual void poll( ) { }
+    virtual void close( ) { }
+};
+
+class CVHELPER_EXPORT WindowDisplaySink : public DisplaySink
+{
+public:
+    void show( const cv::Mat& image, const std::string& name, bool wait,
+               double scale, int32_t waitTime ) override;
+
+    void poll( ) override;
+    void close( ) override;
+};
+
+// Writes every image to <directory>/<name>_<index>.png, the index counts the
+// images shown under the same name
+class CVHELPER_EXPORT FileDisplaySink : public DisplaySink
+{
+public:
+    explicit FileDisplaySink( const std::string& _directory );
+    FileDisplaySink( const FileDisplaySink& ) = delete;
+    FileDisplaySink& operator=( const FileDisplaySink& ) = delete;
+
+    void show( const cv::Mat& image, const std::string& name, bool wait,
+               double scale, int32_t waitTime ) override;
+
+private:
+    std::string directory;
+
+    std::mutex mutex;
+    std::map< std::string, int32_t > counters;
+};
+
+class CVHELPER_EXPORT NullDisplaySink : public DisplaySink
+{
+public:
+    void show( const cv::Mat&, const std::string&, bool, double,
+               int32_t ) override
+    {
+    }
+
+    bool acceptsImages( ) const override { return false; }
+};
+
+// Keeps a deep copy of every image, e.g. to check results in batch runs
+class CVHELPER_EXPORT CaptureDisplaySink : public DisplaySink
+{
+public:
+    struct Frame
+    {
+        std::string name;
+        cv::Mat image;
+    };
+
+    CaptureDisplaySink( ) = default;
+    CaptureDisplaySink( const CaptureDisplaySink& ) = delete;
+    CaptureDisplaySink& operator=( const CaptureDisplaySink& ) = delete;
+
+    void show( const cv::Mat& image, const std::string& name, bool wait,
+               double scale, int32_t waitTime ) override;
+
+    // Return the captured frames in display order and clear the list
+    std::vector< Frame > takeFrames( );
+
+private:
+    std::mutex mutex;
+    std::vector< Frame > frames;
+};
+
+// Forwards images to another sink from a dedicated display thread, so
+// show( ) never waits for HighGUI. Every name has a single slot mailbox:
+// show( ) copies the image into it and returns, an image that wasn't displayed
+// yet is replaced by the newer one. The thread passes the latest images on at
+// most refreshRate times per second. Only show( ..., wait = true ) blocks until
+// the target returns, so explicit pauses keep working.
+//
+// HighGUI is not thread safe: while this sink is alive, don't call cv::imshow
+// or cv::waitKey from other threads. The windows are closed with the sink.
+class CVHELPER_EXPORT AsyncDisplaySink : public DisplaySink
+{
+public:
+    explicit AsyncDisplaySink( std::shared_ptr< DisplaySink > _target =
+                                   std::make_shared< WindowDisplaySink >( ),
+                               double refreshRate = 30.0 );
+    ~AsyncDisplaySink( ) override;
+
+    AsyncDisplaySink( const AsyncDisplaySink& ) = delete;
+    AsyncDisplaySink& operator=( const AsyncDisplaySink& ) = delete;
+
+    void show( const cv::Mat& image, const std::string& name, bool wait,
+               double scale, int32_t waitTime ) override;
+
+    bool acceptsImages( ) const override { return target->acceptsImages( ); }
+
+    // Images that were replaced in their mailbox before being displayed
+    int64_t getDroppedFrames( ) const;
+
+private:
+    struct Mailbox
+    {
+        cv::Mat image;
+        double scale = 1.0;
+        bool pending = false;
+        bool wait = false;
+        uint64_t serial = 0;
+        uint64_t shownSerial = 0;
+    };
+
+    void run( );
+
+    std::shared_ptr< DisplaySink > target;
+    std::chrono::steady_clock::duration interval;
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable shown;
+    std::map< std::string, Mailbox > mailboxes;
+    int32_t pendingWaits = 0;
+    int64_t droppedFrames = 0;
+    bool stop = false;
+
+    std::thread thread;
+};
+
+// Sink selected by CVHELPER_DISPLAY, see DisplaySink
+CVHELPER_EXPORT
+std::shared_ptr< DisplaySink > createDisplaySinkFromEnvironment( );
+
+CVHELPER_EXPORT
+std::shared_ptr< DisplaySink > getDisplaySink( );
+
+// Replace the global sink. nullptr restores the one from the environment.
+CVHELPER_EXPORT
+void setDisplaySink( std::shared_ptr< DisplaySink > sink );
+
 CVHELPER_EXPORT
 void showMat( const cv::Mat& imageIn, const std::string& szName,
               bool bWait = false, double scale = 1, int32_t waitTime = 25 );
 
+// Reused canvas for the plot window szName with dataWidth columns of data and
+// the legend, cleared to black. The canvas is only reallocated if the width
+// changes.
+CVHELPER_EXPORT
+cv::Mat& getPlotCanvas( const std::string& szName, int32_t dataWidth );
+
+// Zero line and min / max legend right of the data columns
+CVHELPER_EXPORT
+void drawPlotLegend( cv::Mat& canvas, int32_t dataWidth, double minVal,
+                     double maxVal );
+
 template < typename ValueType >
-void showBar( std::vector< ValueType > profile, const std::string& szName,
-              bool bWait = false, double scale = 1,
-              cv::Scalar color = cv::Scalar( 0, 0, 255 ) )
+struct PlotSeries
 {
-    // Use 256 extra pixel for legend
-    const auto matWidth = static_cast< int32_t >( profile.size( ) + 256 );
-    const auto dataWidth = static_cast< int32_t >( profile.size( ) );
-    auto matShow = cv::Mat( 256, matWidth, CV_8UC3, cv::Scalar::all( 0x00 ) );
+    std::span< const ValueType > values;
+    cv::Scalar color = cv::Scalar( 0, 0, 255 );
+};
 
-    const auto [ min, max ] =
-        std::minmax_element( profile.begin( ), profile.end( ) );
+// Bar plot of several series with a common value range, e.g.
+// showBars< float >( { { histB, blue }, { histR, red } }, "Histograms" ).
+// Later series are drawn on top of earlier ones.
+template < typename ValueType >
+void showBars( std::initializer_list< PlotSeries< ValueType > > series,
+               const std::string& szName, bool bWait = false,
+               double scale = 1 )
+{
+    if ( ! getDisplaySink( )->acceptsImages( ) || series.size( ) == 0 )
+    {
+        return;
+    }
 
-    const double minVal = *min;
-    const double maxVal = *max;
+    size_t dataWidth = 0;
+    double minVal = std::numeric_limits< double >::max( );
+    double maxVal = std::numeric_limits< double >::lowest( );
 
-    double c1 = minVal * -1.0;
-    double c2 = 255 / ( maxVal - minVal );
+    for ( const auto& s : series )
+    {
+        dataWidth = std::max( dataWidth, s.values.size( ) );
+
+        if ( ! s.values.empty( ) )
+        {
+            const auto [ min, max ] = std::minmax_element( s.values.begin( ),
+                                                           s.values.end( ) );
+            minVal = std::min( minVal, static_cast< double >( *min ) );
+            maxVal = std::max( maxVal, static_cast< double >( *max ) );
+        }
+    }
 
-    for ( int32_t x = 0; x < dataWidth; x++ )
+    if ( dataWidth == 0 )
     {
-        const double newVal =
-            ( profile[ static_cast< size_t >( x ) ] + c1 ) * c2;
-        const auto p1 = cv::Point( x, matShow.rows );
-        const auto p2 =
-            cv::Point( x, matShow.rows - static_cast< int32_t >( newVal ) );
-        cv::line( matShow, p1, p2, color );
+        return;
     }
 
-    const auto yValueZero =
-        matShow.rows - static_cast< int32_t >( std::round( ( 0 + c1 ) * c2 ) );
-    const auto p1 = cv::Point( 0, yValueZero );
-    const auto p2 = cv::Point( dataWidth, yValueZero );
+    cv::Mat& canvas =
+        getPlotCanvas( szName, static_cast< int32_t >( dataWidth ) );
 
-    cv::line( matShow, p1, p2, cv::Scalar( 255, 255, 255 ) );
+    const double range = maxVal - minVal;
+    const double c2 = range > 0.0 ? canvas.rows / range : 0.0;
 
-    const std::string textMax = "Max: " + std::to_string( *max );
-    const std::string textMin = "Min: " + std::to_string( *min );
+    for ( const auto& s : series )
+    {
+        const cv::Vec3b color( static_cast< uchar >( s.color[ 0 ] ),
+                               static_cast< uchar >( s.color[ 1 ] ),
+                               static_cast< uchar >( s.color[ 2 ] ) );
 
-    putText( matShow,
-             textMax,
-             { dataWidth, 15 },
-             cv::FONT_HERSHEY_PLAIN,
-             1,
-             cv::Scalar( 0, 255, 0 ) );
+        // One column per sample, filled from the bottom up to the value
+        for ( size_t x = 0; x < s.values.size( ); x++ )
+        {
+            const double height =
+                ( static_cast< double >( s.values[ x ] ) - minVal ) * c2;
+            const int32_t top =
+                std::clamp( canvas.rows - static_cast< int32_t >( height ),
+                            0,
+                            canvas.rows );
 
-    putText( matShow,
-             textMin,
-             { dataWidth, 30 },
-             cv::FONT_HERSHEY_PLAIN,
-             1,
-             cv::Scalar( 0, 255, 0 ) );
+            for ( int32_t y = top; y < canvas.rows; y++ )
+            {
+                canvas.ptr< cv::Vec3b >( y )[ x ] = color;
+            }
+        }
+    }
 
-    showMat( matShow, szName, bWait, scale );
+    drawPlotLegend(
+        canvas, static_cast< int32_t >( dataWidth ), minVal, maxVal );
+
+    showMat( canvas, szName, bWait, scale );
+}
+
+template < typename ValueType >
+void showBar( std::span< const ValueType > profile, const std::string& szName,
+              bool bWait = false, double scale = 1,
+              cv::Scalar color = cv::Scalar( 0, 0, 255 ) )
+{
+    showBars< ValueType >( { { profile, color } }, szName, bWait, scale );
+}
+
+template < typename ValueType >
+void showBar( const std::vector< ValueType >& profile,
+              const std::string& szName, bool bWait = false, double scale = 1,
+              cv::Scalar color = cv::Scalar( 0, 0, 255 ) )
+{
+    showBar( std::span< const ValueType >( profile ),
+             szName,
+             bWait,
+             scale,
+             color );
 }
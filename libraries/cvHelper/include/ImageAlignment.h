@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+IGNORE_WARNINGS_POP
+
+struct PyramidAlignmentParams
+{
+    // Number of cv::pyrDown steps to the coarse level
+    int32_t pyramidLevels = 2;
+
+    // ORB features at the coarse level and at full resolution. 0 fine
+    // features skips the refinement and returns the scaled coarse result.
+    int32_t coarseFeatures = 500;
+    int32_t fineFeatures = 2000;
+
+    // Fraction of the coarse matches used for the first estimate
+    float goodMatchPercent = 0.15f;
+
+    // Full resolution search radius around the position predicted by the
+    // coarse homography
+    float searchRadius = 16.0f;
+
+    // Ratio test between the two best candidates inside the search radius
+    float ratio = 0.8f;
+
+    // RANSAC reprojection threshold at full resolution
+    double ransacThreshold = 3.0;
+};
+
+// Coarse-to-fine estimation of the homography mapping image onto reference.
+//
+// ORB features are detected and matched on a downscaled pyramid level to get
+// a first homography. At full resolution features are only detected where the
+// two images overlap according to that estimate, and every feature is only
+// compared to the reference features within searchRadius of its predicted
+// position. The refined homography is estimated from these guided matches.
+//
+// Returns an empty matrix if no homography could be found. If the refinement
+// fails the scaled coarse homography is returned.
+CVHELPER_EXPORT
+cv::Mat estimateHomographyPyramid( const cv::Mat& image,
+                                   const cv::Mat& reference,
+                                   const PyramidAlignmentParams& params = { } );
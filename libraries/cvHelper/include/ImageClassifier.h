@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <BlobPreprocessing.h>
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+IGNORE_WARNINGS_POP
+
+struct ClassifierParams
+{
+    // Preprocessing, same meaning as for cv::dnn::blobFromImages
+    double scale = 1.0;
+    cv::Size inputSize = cv::Size( 224, 224 );
+    cv::Scalar mean = cv::Scalar( 0, 0, 0 );
+    bool swapRB = false;
+
+    // Turn the network output into probabilities. Leave it off for networks
+    // that end in a softmax layer.
+    bool applySoftmax = false;
+
+    // Images per forward pass of classifyBatch( )
+    int32_t batchSize = 16;
+};
+
+struct Classification
+{
+    int32_t classId;
+    float probability;
+};
+
+// The k highest of the class scores of one image (continuous CV_32F, e.g. a
+// row of the network output), highest first. With applySoftmax the scores are
+// logits and the probabilities are their softmax. The order is found with
+// std::partial_sort on the raw scores, softmax does not change it.
+CVHELPER_EXPORT
+std::vector< Classification > getTopK( const cv::Mat& scores, int32_t k,
+                                       bool applySoftmax = false );
+
+// Classifier around a loaded network with its class labels.
+//
+// The labels are read once on construction, one per line. Input blobs are
+// built with BlobPreprocessor, which keeps the blob and reuses it for the next
+// call.
+class CVHELPER_EXPORT ImageClassifier
+{
+public:
+    ImageClassifier( const cv::dnn::Net& _net, const std::string& labelFile,
+                     const ClassifierParams& _params = { } );
+
+    // Top k classes of one BGR image
+    std::vector< Classification > classify( const cv::Mat& image,
+                                            int32_t k = 5 );
+
+    // Top k classes of every image. The images run through the network in
+    // batches of params.batchSize.
+    std::vector< std::vector< Classification > >
+    classifyBatch( const std::vector< cv::Mat >& images, int32_t k = 5 );
+
+    // Label of a class, empty if the label file had no line for it
+    const std::string& getLabel( int32_t classId ) const;
+
+    size_t getClassCount( ) const { return labels.size( ); }
+
+private:
+    cv::dnn::Net net;
+    std::vector< std::string > labels;
+    ClassifierParams params;
+
+    BlobPreprocessor preprocessor;
+    std::vector< cv::Mat > batch;
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <vector>
+
+#include <PanoramaCompositing.h>
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+IGNORE_WARNINGS_POP
+
+struct IncrementalPanoramaParams
+{
+    // ORB features per image, detected on a copy scaled by featureScale
+    int32_t maxFeatures = 2000;
+    double featureScale = 0.5;
+
+    // A new image is matched against this many of the latest images
+    int32_t matchWindow = 3;
+
+    // Ratio test for the descriptor matches
+    float ratio = 0.8f;
+
+    // Minimal RANSAC inliers for two images to be considered overlapping
+    int32_t minInliers = 20;
+    double ransacThreshold = 3.0;
+
+    // After adding an image, the latest refineWindow images are re-estimated
+    // from their cached matches for refineIterations rounds
+    int32_t refineWindow = 3;
+    int32_t refineIterations = 2;
+};
+
+// Builds a planar panorama from images that arrive one at a time, e.g. from a
+// nadir looking drone camera.
+//
+// Features of every image are computed once when it is added. The new image is
+// only matched against the latest matchWindow images, the pairwise inlier
+// matches are cached, and only the homographies of the latest refineWindow
+// images are re-estimated from these cached matches. The first image defines
+// the panorama plane and is never moved.
+class CVHELPER_EXPORT IncrementalPanorama
+{
+public:
+    explicit IncrementalPanorama(
+        const IncrementalPanoramaParams& _params = { } );
+
+    // Add the next image. Returns false if it could not be connected to any
+    // previous image; it is not added then.
+    bool addImage( const cv::Mat& image );
+
+    size_t size( ) const { return frames.size( ); }
+
+    // Homography mapping image index onto the panorama plane
+    cv::Mat getHomography( size_t index ) const;
+
+    // Bounding box of all warped images on the panorama plane
+    cv::Rect2d getBounds( ) const;
+
+    // Compositor for the full resolution panorama, all images already added
+    TiledPanoramaCompositor
+    createCompositor( cv::Size tileSize = cv::Size( 1024, 1024 ),
+                      PanoramaBlendMode blendMode =
+                          PanoramaBlendMode::Feather ) const;
+
+    // Downscaled panorama for a live preview
+    cv::Mat renderPreview( double scale ) const;
+
+private:
+    struct Frame
+    {
+        cv::Mat image;
+        std::vector< cv::KeyPoint > keypoints;
+        cv::Mat descriptors;
+        cv::Matx33d homography;
+        std::vector< size_t > pairs;
+    };
+
+    // Inlier correspondences of two frames, pointsA in frame a, pointsB in b
+    struct FramePair
+    {
+        size_t a;
+        size_t b;
+        std::vector< cv::Point2f > pointsA;
+        std::vector< cv::Point2f > pointsB;
+    };
+
+    void refineFrame( size_t index );
+
+    TiledPanoramaCompositor makeCompositor( const cv::Matx33d& planeToCanvas,
+                                            cv::Size canvasSize,
+                                            cv::Size tileSize,
+                                            PanoramaBlendMode blendMode ) const;
+
+    IncrementalPanoramaParams params;
+    cv::Ptr< cv::ORB > orb;
+    std::vector< Frame > frames;
+    std::vector< FramePair > framePairs;
+};
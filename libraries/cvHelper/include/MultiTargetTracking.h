@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+IGNORE_WARNINGS_POP
+
+enum class TrackAssociation
+{
+    // Optimal assignment maximizing the total IoU (Hungarian algorithm)
+    Hungarian,
+
+    // Highest IoU pairs first, cheaper but may be suboptimal in crowds
+    Greedy
+};
+
+struct KalmanTrackerParams
+{
+    // Diagonal process (Q) and measurement (R) noise variances
+    float processNoise = 1e-2f;
+    float measurementNoise = 1e-2f;
+
+    // Diagonal of the state covariance of a new track
+    float initialCovariance = 1.0f;
+
+    TrackAssociation association = TrackAssociation::Hungarian;
+
+    // Minimum IoU between a predicted box and a detection to match them
+    double minIou = 0.3;
+
+    // A track is confirmed (reported) after minHits matched frames in a row
+    // and deleted after more than maxMissed frames without a match
+    int32_t minHits = 3;
+    int32_t maxMissed = 10;
+
+    // Box height / width, the state only holds the width
+    float aspectRatio = 2.0f;
+};
+
+struct TrackedObject
+{
+    int64_t id;
+    cv::Rect2f box;
+    cv::Point2f velocity;
+    int32_t hits;
+    int32_t missed;
+};
+
+// Multi target tracker with one constant velocity Kalman filter per target.
+//
+// The state of every track is ( x, y, w, vx, vy, vw ) with the measurement
+// ( x, y, w ), like the single cv::KalmanFilter of kalmanFilterTracking.
+// Transition and measurement matrices couple each position only with its own
+// velocity, so with diagonal noise the covariance separates into one 2x2
+// block per axis. The bank stores these blocks and the state as struct of
+// arrays and runs predict / correct as plain loops over all tracks, which
+// gives the same result as one cv::KalmanFilter per track at a fraction of
+// the cost.
+class CVHELPER_EXPORT KalmanTrackerBank
+{
+public:
+    explicit KalmanTrackerBank( const KalmanTrackerParams& _params = { } );
+
+    // Predict all tracks dt seconds ahead, associate them with the detections
+    // of the new frame, correct the matched tracks, start tracks for
+    // unmatched detections and delete tracks that were missed too often.
+    void update( const std::vector< cv::Rect >& detections, float dt );
+
+    // Current tracks, only the confirmed ones (minHits) by default
+    std::vector< TrackedObject > getTracks( bool confirmedOnly = true ) const;
+
+    size_t size( ) const { return ids.size( ); }
+
+private:
+    // Position, velocity and covariance block of one axis for all tracks
+    struct Axis
+    {
+        std::vector< float > position;
+        std::vector< float > velocity;
+        std::vector< float > pPP;
+        std::vector< float > pPV;
+        std::vector< float > pVV;
+    };
+
+    void predict( float dt );
+    void correct( size_t track, const cv::Rect& detection );
+    void addTrack( const cv::Rect& detection );
+    void removeTrack( size_t track );
+    cv::Rect2f trackBox( size_t track ) const;
+
+    KalmanTrackerParams params;
+
+    // x, y and width
+    Axis axes[ 3 ];
+
+    std::vector< int64_t > ids;
+    std::vector< int32_t > hits;
+    std::vector< int32_t > missed;
+    std::vector< uchar > confirmed;
+    int64_t nextId = 0;
+
+    // Scratch buffers for the association
+    std::vector< double > cost;
+    std::vector< int32_t > assignment;
+    std::vector< uchar > detectionUsed;
+};
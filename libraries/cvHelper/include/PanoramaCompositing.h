@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+IGNORE_WARNINGS_POP
+
+enum class PanoramaBlendMode
+{
+    // Later images overwrite earlier ones
+    Overwrite,
+
+    // Weighted average, the weight falls off towards the image borders
+    Feather
+};
+
+// Composites warped images into a panorama canvas tile by tile.
+//
+// The full canvas is never allocated. Each tile is rendered on its own by
+// warping only the part of every image that falls into it, blended and handed
+// to a sink (e.g. written to disk) before the next one is started. Tiles are
+// rendered in parallel, so memory is bounded by the number of threads times
+// the tile size plus the source images.
+class CVHELPER_EXPORT TiledPanoramaCompositor
+{
+public:
+    // Called once per rendered tile. tileIndex is ( column, row ) of the tile,
+    // tileRect its position in the canvas.
+    using TileSink = std::function< void( const cv::Point& tileIndex,
+                                          const cv::Rect& tileRect,
+                                          const cv::Mat& tile ) >;
+
+    TiledPanoramaCompositor(
+        cv::Size canvasSize, cv::Size tileSize = cv::Size( 1024, 1024 ),
+        PanoramaBlendMode blendMode = PanoramaBlendMode::Feather );
+
+    // Add a CV_8UC1 or CV_8UC3 image. The homography maps image coordinates to
+    // canvas coordinates. The pixel data is shared, not copied, so the image
+    // must not be modified until rendering is done.
+    void addImage( const cv::Mat& image, const cv::Mat& homography );
+
+    // Render every tile touched by at least one image and pass it to the
+    // sink. Tiles without any image are skipped. The sink is called from
+    // worker threads and has to be thread safe.
+    //
+    // If previewScale is > 0 a downscaled overview of the canvas is built from
+    // the tiles and returned.
+    cv::Mat render( const TileSink& sink, double previewScale = 0.0 ) const;
+
+    // Sink writing every tile to <directory>/tile_<row>_<column>.png
+    static TileSink writeTilesTo( const std::string& directory );
+
+    cv::Size getCanvasSize( ) const { return canvasSize; }
+    cv::Size getTileSize( ) const { return tileSize; }
+
+private:
+    struct Source
+    {
+        cv::Mat image;
+        cv::Matx33d canvasToImage;
+        cv::Rect canvasRect;
+    };
+
+    void renderTile( const cv::Rect& tileRect, cv::Mat& tile ) const;
+
+    cv::Size canvasSize;
+    cv::Size tileSize;
+    PanoramaBlendMode blendMode;
+    int32_t imageType = -1;
+    std::vector< Source > sources;
+};
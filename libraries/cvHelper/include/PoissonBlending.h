@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/photo.hpp>
+IGNORE_WARNINGS_POP
+
+// Seamless cloning restricted to the patch.
+//
+// cv::seamlessClone copies the whole destination for every call. This solves
+// the Poisson equation only on the bounding box of the mask placed in the
+// destination, with the one pixel ring around it as Dirichlet boundary, and
+// writes the result back in place. The solver diagonalizes the Laplacian with
+// a discrete sine transform (cv::dft on the odd extension), so a patch costs
+// O( n log n ) in its own pixel count, independent of the image size. Scratch
+// buffers are kept in the instance and reused by the next patch.
+class CVHELPER_EXPORT PoissonBlender
+{
+public:
+    // Clone the non zero mask area of src into dst, centered at center, like
+    // cv::seamlessClone( src, dst, mask, center, dst, flags ).
+    //
+    // src and dst are CV_8UC3, mask is CV_8UC1 or CV_8UC3 of the size of src.
+    // flags is cv::NORMAL_CLONE or cv::MIXED_CLONE. A patch reaching over the
+    // border of dst is clipped. src may be a view of dst.
+    void seamlessClone( const cv::Mat& src, cv::Mat& dst, const cv::Mat& mask,
+                        cv::Point center, int32_t flags = cv::NORMAL_CLONE );
+
+    // Pixels of dst that seamlessClone( ) reads and writes for this mask and
+    // center, including the boundary ring. Empty if nothing is cloned.
+    static cv::Rect getDestinationRect( const cv::Mat& mask, cv::Point center,
+                                        cv::Size dstSize );
+
+private:
+    void solve( const cv::Mat& b, cv::Mat& u );
+    void sineTransform( const cv::Mat& src, cv::Mat& dst );
+    void sineTransformRows( const cv::Mat& src, cv::Mat& dst );
+
+    cv::Mat maskChannel;
+    cv::Mat maskPatch;
+    cv::Mat srcPatch8U;
+    cv::Mat srcPatch;
+    cv::Mat dstPatch;
+    cv::Mat rhs;
+    std::vector< cv::Mat > solutionChannels;
+    cv::Mat result;
+
+    // Sine transform buffers
+    cv::Mat extended;
+    cv::Mat spectrum;
+    cv::Mat transformed;
+    cv::Mat transposed;
+    cv::Mat coefficients;
+    std::vector< float > eigenX;
+    std::vector< float > eigenY;
+};
+
+struct ClonePatch
+{
+    cv::Mat src;
+    cv::Mat mask;
+    cv::Point center;
+};
+
+// Clone all patches into dst in parallel, each with PoissonBlender.
+//
+// The patches are solved independently, so the getDestinationRect( ) areas
+// must not overlap each other, and no patch src may be a view of dst pixels
+// that another patch writes.
+CVHELPER_EXPORT
+void seamlessCloneBatch( const std::vector< ClonePatch >& patches,
+                         cv::Mat& dst, int32_t flags = cv::NORMAL_CLONE );
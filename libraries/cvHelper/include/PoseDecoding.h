@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+IGNORE_WARNINGS_POP
+
+// Layout of the output blob of an OpenPose network
+struct PoseModel
+{
+    // Heatmap channels come first, one per keypoint
+    int32_t keypointCount = 0;
+
+    // Limbs as keypoint pairs, ordered from the root outwards so the first
+    // keypoint of a limb is reached before its second one
+    std::vector< std::pair< int32_t, int32_t > > limbs;
+
+    // x and y channel of the part affinity field of every limb
+    std::vector< std::pair< int32_t, int32_t > > pafChannels;
+};
+
+// The 15 keypoint MPI model (mpi.prototxt, 44 output channels)
+CVHELPER_EXPORT
+PoseModel getMpiPoseModel( );
+
+struct PoseDecoderParams
+{
+    // Minimum heatmap confidence of a keypoint
+    float peakThreshold = 0.1f;
+
+    // A candidate limb is sampled at pafSamples points. It is accepted if the
+    // part affinity field points along it with at least minPafScore at
+    // minInlierRatio of the points and on average.
+    int32_t pafSamples = 10;
+    float minPafScore = 0.1f;
+    float minInlierRatio = 0.7f;
+
+    // Persons with fewer keypoints are dropped
+    int32_t minKeypoints = 3;
+};
+
+struct PoseKeypoint
+{
+    // Image coordinates, ( -1, -1 ) with confidence 0 if not found
+    cv::Point2f position;
+    float confidence;
+};
+
+struct Pose
+{
+    // One per keypoint of the model
+    std::vector< PoseKeypoint > keypoints;
+
+    // Sum of the keypoint confidences and limb scores
+    float score;
+};
+
+// Local maxima above threshold of the first keypointCount heatmaps of output
+// (1 x channels x height x width, CV_32F), per keypoint.
+//
+// A peak is a pixel not smaller than its 8 neighbors, found with a 3x3
+// dilation and a comparison over the whole map. Its position is refined to
+// sub-pixel accuracy with a parabola through the neighbors in x and y and
+// mapped to an image of imageSize. The heatmaps run in parallel.
+CVHELPER_EXPORT
+std::vector< std::vector< PoseKeypoint > >
+findPosePeaks( const cv::Mat& output, int32_t keypointCount,
+               cv::Size imageSize, float threshold );
+
+// All persons in output, mapped to an image of imageSize.
+//
+// Every limb connects the peaks of its two keypoints whose part affinity
+// field agrees best with the line between them, each peak used at most once
+// per limb. The limbs are scored in parallel, then walked from the root
+// outwards: a limb extends the person that already owns its first keypoint
+// or starts a new one.
+//
+// If peakKeypoints is given, it receives all peaks like findPosePeaks( ) with
+// params.peakThreshold, so they don't have to be searched a second time.
+CVHELPER_EXPORT
+std::vector< Pose > decodePoses(
+    const cv::Mat& output, const PoseModel& model, cv::Size imageSize,
+    const PoseDecoderParams& params = { },
+    std::vector< std::vector< PoseKeypoint > >* peakKeypoints = nullptr );
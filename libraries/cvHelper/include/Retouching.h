@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cvHelper/export.h>
+
+// STD includes
+#include <cstdint>
+#include <vector>
+
+#include <macros.h>
+
+// OpenCV includes
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/photo.hpp>
+IGNORE_WARNINGS_POP
+
+// Integral image of the Sobel gradient magnitude of an image, for the mean
+// gradient of any rectangle in constant time.
+//
+// The image is tracked by reference: after pixels of it were modified in
+// place, invalidate( ) the modified region. Gray image, gradient and the
+// affected part of the integral are only recomputed for that region, and only
+// when the next query needs them. An image that is reallocated (clone,
+// create with a new size) has to be passed to setImage( ) again.
+class CVHELPER_EXPORT GradientIntegral
+{
+public:
+    GradientIntegral( ) = default;
+    explicit GradientIntegral( const cv::Mat& _image );
+
+    // Track a CV_8UC3 (BGR) or CV_8UC1 image and rebuild everything
+    void setImage( const cv::Mat& _image );
+
+    // Pixels inside region were modified
+    void invalidate( const cv::Rect& region );
+
+    // Mean gradient magnitude inside region, clipped to the image. Returns 0
+    // for an empty intersection.
+    double meanGradient( const cv::Rect& region );
+
+    bool empty( ) const { return image.empty( ); }
+
+private:
+    void update( );
+
+    cv::Mat image;
+    cv::Mat gray;
+    cv::Mat magnitude;
+
+    // CV_64FC1, one row and column larger than the image
+    cv::Mat integral;
+
+    // Modified since the last update, empty if up to date
+    cv::Rect dirty;
+
+    // Scratch buffers of the update
+    cv::Mat gradX;
+    cv::Mat gradY;
+};
+
+struct BlemishRemovalParams
+{
+    // A blemish patch is the square of 2 * patchRadius pixels around its
+    // center. It is replaced by one of the eight adjacent squares.
+    int32_t patchRadius = 15;
+
+    // cv::NORMAL_CLONE or cv::MIXED_CLONE
+    int32_t flags = cv::NORMAL_CLONE;
+};
+
+// The up to eight squares adjacent to the blemish patch around center that lie
+// inside an image of imageSize, the candidates to replace the patch with
+CVHELPER_EXPORT
+std::vector< cv::Rect > getBlemishCandidates( cv::Point center,
+                                              int32_t patchRadius,
+                                              cv::Size imageSize );
+
+// Remove the blemishes around centers in image, a CV_8UC3 image modified in
+// place. Every patch is replaced by its candidate of the lowest mean gradient,
+// Poisson blended with PoissonBlender.
+//
+// Patches are partitioned into groups in which no patch writes pixels that
+// another one reads or writes. The groups run one after another, the patches
+// of a group in parallel, so the result is deterministic and equals
+// processing the patches sequentially group by group. The gradients of the
+// candidates are kept in a GradientIntegral that only updates the patches
+// written by the previous group.
+//
+// Returns the chosen candidate of every center, an empty rect if the patch
+// has no candidate inside the image.
+CVHELPER_EXPORT
+std::vector< cv::Rect >
+removeBlemishes( cv::Mat& image, const std::vector< cv::Point >& centers,
+                 const BlemishRemovalParams& params = { } );
+
+// Merge overlapping rectangles until the result is pairwise disjoint. Every
+// result is the bounding box of a group of input rectangles that overlap
+// directly or through other members of the group. Work on disjoint results
+// may write into one image in parallel.
+CVHELPER_EXPORT
+std::vector< cv::Rect >
+mergeOverlappingRects( const std::vector< cv::Rect >& rects );
+
+// dst = ( foreground * mask + background * ( 255 - mask ) ) / 255, rounded,
+// in 8 bit fixed point without temporaries. Rows run in parallel.
+//
+// foreground, background and dst are CV_8UC3 of one size, mask is CV_8UC1 of
+// that size. dst has to be allocated and may be a view of either input.
+CVHELPER_EXPORT
+void blendMasked( const cv::Mat& foreground, const cv::Mat& background,
+                  const cv::Mat& mask, cv::Mat& dst );
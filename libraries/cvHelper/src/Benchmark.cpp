@@ -0,0 +1,330 @@
+#include <Benchmark.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+#if defined( __linux__ )
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+// Nearest rank percentile of sorted samples
+double percentile( const std::vector< double >& sorted, double p )
+{
+    const auto rank = static_cast< size_t >(
+        std::ceil( p / 100.0 * static_cast< double >( sorted.size( ) ) ) );
+    return sorted[ std::clamp< size_t >( rank, 1, sorted.size( ) ) - 1 ];
+}
+
+std::string escapeJson( const std::string& text )
+{
+    std::string escaped;
+    escaped.reserve( text.size( ) );
+
+    for ( const char c : text )
+    {
+        const auto code = static_cast< unsigned char >( c );
+
+        // Control characters are not allowed in JSON strings
+        if ( code < 0x20 )
+        {
+            constexpr char hex[] = "0123456789abcdef";
+            escaped += "\\u00";
+            escaped += hex[ code >> 4 ];
+            escaped += hex[ code & 0xf ];
+            continue;
+        }
+
+        if ( c == '"' || c == '\\' )
+        {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+
+    return escaped;
+}
+
+// Hardware counters for the calling thread. Counters that can't be opened
+// are skipped silently.
+class PerfCounters
+{
+public:
+    PerfCounters( ) = default;
+    PerfCounters( const PerfCounters& ) = delete;
+    PerfCounters& operator=( const PerfCounters& ) = delete;
+
+#if defined( __linux__ )
+    ~PerfCounters( )
+    {
+        for ( const auto& counter : counters )
+        {
+            close( counter.fd );
+        }
+    }
+
+    void open( )
+    {
+        const std::pair< const char*, uint64_t > events[] = {
+            { "cycles", PERF_COUNT_HW_CPU_CYCLES },
+            { "instructions", PERF_COUNT_HW_INSTRUCTIONS },
+            { "cacheMisses", PERF_COUNT_HW_CACHE_MISSES },
+            { "branchMisses", PERF_COUNT_HW_BRANCH_MISSES } };
+
+        for ( const auto& [ name, config ] : events )
+        {
+            perf_event_attr attr { };
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof( attr );
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+
+            const auto fd = static_cast< int >(
+                syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 ) );
+            if ( fd >= 0 )
+            {
+                counters.push_back( { name, fd } );
+            }
+        }
+    }
+
+    void start( )
+    {
+        for ( const auto& counter : counters )
+        {
+            ioctl( counter.fd, PERF_EVENT_IOC_RESET, 0 );
+            ioctl( counter.fd, PERF_EVENT_IOC_ENABLE, 0 );
+        }
+    }
+
+    void stop( std::map< std::string, double >& values, int32_t iterations )
+    {
+        for ( const auto& counter : counters )
+        {
+            ioctl( counter.fd, PERF_EVENT_IOC_DISABLE, 0 );
+
+            uint64_t value = 0;
+            if ( read( counter.fd, &value, sizeof( value ) ) ==
+                 static_cast< ssize_t >( sizeof( value ) ) )
+            {
+                values[ counter.name ] =
+                    static_cast< double >( value ) / iterations;
+            }
+        }
+    }
+
+private:
+    struct Counter
+    {
+        std::string name;
+        int fd;
+    };
+
+    std::vector< Counter > counters;
+#else
+    ~PerfCounters( ) = default;
+
+    void open( ) { }
+    void start( ) { }
+    void stop( std::map< std::string, double >&, int32_t ) { }
+#endif
+};
+
+// Runs cv::parallel_for_ single threaded while alive if enabled. The thread
+// count is restored on destruction, also if the kernel throws.
+class SingleThreadScope
+{
+public:
+    explicit SingleThreadScope( bool _enabled )
+        : enabled( _enabled )
+        , numThreads( cv::getNumThreads( ) )
+    {
+        if ( enabled )
+        {
+            cv::setNumThreads( 1 );
+        }
+    }
+
+    ~SingleThreadScope( )
+    {
+        if ( enabled )
+        {
+            cv::setNumThreads( numThreads );
+        }
+    }
+
+    SingleThreadScope( const SingleThreadScope& ) = delete;
+    SingleThreadScope& operator=( const SingleThreadScope& ) = delete;
+
+private:
+    bool enabled;
+    int32_t numThreads;
+};
+} // namespace
+
+BenchmarkResult runBenchmark( const std::string& name,
+                              const std::function< void( ) >& kernel,
+                              const BenchmarkParams& params /*= { }*/ )
+{
+    using Clock = std::chrono::steady_clock;
+
+    BenchmarkResult result;
+    result.name = name;
+    result.iterations = std::max( params.iterations, 1 );
+
+    // The counters only see the calling thread. Work that cv::parallel_for_
+    // hands to the thread pool would be missing, so the kernel runs single
+    // threaded while counting, the warmup included.
+    const SingleThreadScope singleThreaded( params.perfCounters );
+
+    for ( int32_t i = 0; i < params.warmupIterations; i++ )
+    {
+        kernel( );
+    }
+
+    PerfCounters counters;
+    if ( params.perfCounters )
+    {
+        counters.open( );
+        counters.start( );
+    }
+
+    result.samplesMs.reserve( static_cast< size_t >( result.iterations ) );
+    for ( int32_t i = 0; i < result.iterations; i++ )
+    {
+        const auto start = Clock::now( );
+        kernel( );
+        const auto end = Clock::now( );
+
+        result.samplesMs.push_back(
+            std::chrono::duration< double, std::milli >( end - start )
+                .count( ) );
+    }
+
+    if ( params.perfCounters )
+    {
+        counters.stop( result.perfCounters, result.iterations );
+    }
+
+    std::vector< double > sorted = result.samplesMs;
+    std::sort( sorted.begin( ), sorted.end( ) );
+
+    const auto count = static_cast< double >( sorted.size( ) );
+    result.minMs = sorted.front( );
+    result.maxMs = sorted.back( );
+    result.meanMs =
+        std::accumulate( sorted.begin( ), sorted.end( ), 0.0 ) / count;
+    result.medianMs = sorted.size( ) % 2 == 1
+                          ? sorted[ sorted.size( ) / 2 ]
+                          : 0.5 * ( sorted[ sorted.size( ) / 2 - 1 ] +
+                                    sorted[ sorted.size( ) / 2 ] );
+    result.p95Ms = percentile( sorted, 95.0 );
+    result.p99Ms = percentile( sorted, 99.0 );
+
+    double sumSq = 0.0;
+    for ( const double sample : sorted )
+    {
+        sumSq += ( sample - result.meanMs ) * ( sample - result.meanMs );
+    }
+    result.stdDevMs =
+        sorted.size( ) > 1 ? std::sqrt( sumSq / ( count - 1.0 ) ) : 0.0;
+
+    if ( params.pixelsPerIteration > 0 && result.medianMs > 0.0 )
+    {
+        result.megaPixelsPerSecond =
+            static_cast< double >( params.pixelsPerIteration ) /
+            ( result.medianMs * 1000.0 );
+    }
+
+    return result;
+}
+
+void printBenchmark( const BenchmarkResult& result, std::ostream& stream )
+{
+    stream << result.name << ": median " << result.medianMs << " ms, p95 "
+           << result.p95Ms << " ms, p99 " << result.p99Ms << " ms, min "
+           << result.minMs << " ms, stddev " << result.stdDevMs << " ms ("
+           << result.iterations << " runs)";
+
+    if ( result.megaPixelsPerSecond > 0.0 )
+    {
+        stream << ", " << result.megaPixelsPerSecond << " MPixel/s";
+    }
+
+    for ( const auto& [ counter, value ] : result.perfCounters )
+    {
+        stream << ", " << counter << " " << value;
+    }
+
+    stream << "\n";
+}
+
+std::string benchmarkToJson( const std::vector< BenchmarkResult >& results )
+{
+    std::ostringstream json;
+    json << std::setprecision( 9 ) << "[\n";
+
+    for ( size_t i = 0; i < results.size( ); i++ )
+    {
+        const auto& result = results[ i ];
+
+        json << "  {\n"
+             << "    \"name\": \"" << escapeJson( result.name ) << "\",\n"
+             << "    \"iterations\": " << result.iterations << ",\n"
+             << "    \"minMs\": " << result.minMs << ",\n"
+             << "    \"meanMs\": " << result.meanMs << ",\n"
+             << "    \"medianMs\": " << result.medianMs << ",\n"
+             << "    \"p95Ms\": " << result.p95Ms << ",\n"
+             << "    \"p99Ms\": " << result.p99Ms << ",\n"
+             << "    \"maxMs\": " << result.maxMs << ",\n"
+             << "    \"stdDevMs\": " << result.stdDevMs << ",\n"
+             << "    \"megaPixelsPerSecond\": " << result.megaPixelsPerSecond
+             << ",\n"
+             << "    \"perfCounters\": {";
+
+        size_t counterIdx = 0;
+        for ( const auto& [ counter, value ] : result.perfCounters )
+        {
+            json << ( counterIdx++ == 0 ? " " : ", " ) << "\""
+                 << escapeJson( counter ) << "\": " << value;
+        }
+
+        json << " }\n  }" << ( i + 1 < results.size( ) ? ",\n" : "\n" );
+    }
+
+    json << "]\n";
+
+    return json.str( );
+}
+
+bool writeBenchmarkJson( const std::vector< BenchmarkResult >& results,
+                         const std::string& fileName )
+{
+    std::ofstream file( fileName );
+    if ( ! file )
+    {
+        return false;
+    }
+
+    file << benchmarkToJson( results );
+
+    return static_cast< bool >( file );
+}
@@ -0,0 +1,433 @@
+#include <BlobAnalysis.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+// Thinner strips spend more time in merging than they save in labeling
+constexpr int32_t MIN_STRIP_ROWS = 64;
+
+constexpr size_t NO_LABEL = std::numeric_limits< size_t >::max( );
+
+struct Run
+{
+    int32_t start; // First column of the run
+    int32_t end;   // Last column of the run, inclusive
+    int32_t row;
+    size_t label; // Provisional label, local to the strip
+};
+
+// Power sums 0^p + 1^p + ... + k^p used to get the moments of a run in
+// closed form
+double sumPow1( double k ) { return k * ( k + 1.0 ) / 2.0; }
+double sumPow2( double k ) { return k * ( k + 1.0 ) * ( 2.0 * k + 1.0 ) / 6.0; }
+double sumPow3( double k ) { return sumPow1( k ) * sumPow1( k ); }
+
+struct MomentAccumulator
+{
+    double m00 = 0.0;
+    double m10 = 0.0;
+    double m01 = 0.0;
+    double m20 = 0.0;
+    double m11 = 0.0;
+    double m02 = 0.0;
+    double m30 = 0.0;
+    double m21 = 0.0;
+    double m12 = 0.0;
+    double m03 = 0.0;
+
+    int32_t minX = std::numeric_limits< int32_t >::max( );
+    int32_t minY = std::numeric_limits< int32_t >::max( );
+    int32_t maxX = std::numeric_limits< int32_t >::min( );
+    int32_t maxY = std::numeric_limits< int32_t >::min( );
+
+    void addRun( int32_t start, int32_t end, int32_t row )
+    {
+        const double a = static_cast< double >( start ) - 1.0;
+        const double b = static_cast< double >( end );
+        const double y = static_cast< double >( row );
+
+        const double n = b - a;
+        const double sx = sumPow1( b ) - sumPow1( a );
+        const double sx2 = sumPow2( b ) - sumPow2( a );
+        const double sx3 = sumPow3( b ) - sumPow3( a );
+
+        m00 += n;
+        m10 += sx;
+        m01 += y * n;
+        m20 += sx2;
+        m11 += y * sx;
+        m02 += y * y * n;
+        m30 += sx3;
+        m21 += y * sx2;
+        m12 += y * y * sx;
+        m03 += y * y * y * n;
+
+        minX = std::min( minX, start );
+        maxX = std::max( maxX, end );
+        minY = std::min( minY, row );
+        maxY = std::max( maxY, row );
+    }
+
+    void merge( const MomentAccumulator& other )
+    {
+        m00 += other.m00;
+        m10 += other.m10;
+        m01 += other.m01;
+        m20 += other.m20;
+        m11 += other.m11;
+        m02 += other.m02;
+        m30 += other.m30;
+        m21 += other.m21;
+        m12 += other.m12;
+        m03 += other.m03;
+
+        minX = std::min( minX, other.minX );
+        maxX = std::max( maxX, other.maxX );
+        minY = std::min( minY, other.minY );
+        maxY = std::max( maxY, other.maxY );
+    }
+};
+
+struct StripResult
+{
+    std::vector< Run > runs;
+    std::vector< size_t > parent;
+    std::vector< MomentAccumulator > accumulators;
+
+    // runs[ 0, firstRowEnd ) lie in the first row of the strip and
+    // runs[ lastRowBegin, runs.size( ) ) in the last one. Only these have to
+    // be compared when the strips are merged.
+    size_t firstRowEnd = 0;
+    size_t lastRowBegin = 0;
+};
+
+size_t findRoot( std::vector< size_t >& parent, size_t label )
+{
+    while ( parent[ label ] != label )
+    {
+        // Path halving
+        parent[ label ] = parent[ parent[ label ] ];
+        label = parent[ label ];
+    }
+
+    return label;
+}
+
+// Always link to the smaller root. The root of a set is then its first label
+// in raster order, which makes the final numbering deterministic.
+void unite( std::vector< size_t >& parent, size_t a, size_t b )
+{
+    a = findRoot( parent, a );
+    b = findRoot( parent, b );
+
+    if ( a < b )
+    {
+        parent[ b ] = a;
+    }
+    else if ( b < a )
+    {
+        parent[ a ] = b;
+    }
+}
+
+// Run-length label the rows [ rowBegin, rowEnd ). A run is connected to a run
+// of the previous row if their column ranges overlap, extended by the
+// tolerance (1 for 8-connectivity, 0 for 4-connectivity).
+void labelStrip( const cv::Mat& binary, int32_t rowBegin, int32_t rowEnd,
+                 int32_t tolerance, StripResult& result )
+{
+    const int32_t cols = binary.cols;
+
+    size_t prevBegin = 0;
+    size_t prevEnd = 0;
+
+    for ( int32_t y = rowBegin; y < rowEnd; y++ )
+    {
+        const auto* row = binary.ptr< uchar >( y );
+        const size_t curBegin = result.runs.size( );
+        size_t prevIdx = prevBegin;
+
+        int32_t x = 0;
+        while ( x < cols )
+        {
+            while ( x < cols && row[ x ] == 0 )
+            {
+                x++;
+            }
+
+            if ( x == cols )
+            {
+                break;
+            }
+
+            const int32_t start = x;
+            while ( x < cols && row[ x ] != 0 )
+            {
+                x++;
+            }
+            const int32_t end = x - 1;
+
+            // Runs of the previous row are sorted, so the ones ending left of
+            // the current run can never touch a later run either
+            while ( prevIdx < prevEnd &&
+                    result.runs[ prevIdx ].end + tolerance < start )
+            {
+                prevIdx++;
+            }
+
+            size_t label = NO_LABEL;
+            for ( size_t k = prevIdx;
+                  k < prevEnd && result.runs[ k ].start <= end + tolerance;
+                  k++ )
+            {
+                if ( label == NO_LABEL )
+                {
+                    label = result.runs[ k ].label;
+                }
+                else
+                {
+                    unite( result.parent, label, result.runs[ k ].label );
+                }
+            }
+
+            if ( label == NO_LABEL )
+            {
+                label = result.parent.size( );
+                result.parent.push_back( label );
+                result.accumulators.emplace_back( );
+            }
+
+            result.accumulators[ label ].addRun( start, end, y );
+            result.runs.push_back( { start, end, y, label } );
+        }
+
+        if ( y == rowBegin )
+        {
+            result.firstRowEnd = result.runs.size( );
+        }
+
+        prevBegin = curBegin;
+        prevEnd = result.runs.size( );
+    }
+
+    result.lastRowBegin = prevBegin;
+}
+} // namespace
+
+int32_t labelRunLength( const cv::Mat& binary, cv::OutputArray labels,
+                        std::vector< BlobStatistics >& blobs,
+                        int32_t connectivity /*= 8*/,
+                        int32_t numStrips /*= 1*/ )
+{
+    CV_Assert( binary.type( ) == CV_8UC1 );
+    CV_Assert( connectivity == 4 || connectivity == 8 );
+
+    blobs.clear( );
+
+    if ( binary.empty( ) )
+    {
+        if ( labels.needed( ) )
+        {
+            labels.release( );
+        }
+        return 1;
+    }
+
+    const int32_t tolerance = connectivity == 8 ? 1 : 0;
+
+    if ( numStrips <= 0 )
+    {
+        numStrips = cv::getNumThreads( );
+    }
+    numStrips =
+        std::clamp( numStrips, 1, std::max( 1, binary.rows / MIN_STRIP_ROWS ) );
+
+    const auto stripBegin = [ & ]( int32_t strip ) {
+        return static_cast< int32_t >( static_cast< int64_t >( binary.rows ) *
+                                       strip / numStrips );
+    };
+
+    std::vector< StripResult > strips( static_cast< size_t >( numStrips ) );
+
+    cv::parallel_for_(
+        cv::Range( 0, numStrips ), [ & ]( const cv::Range& range ) {
+            for ( int32_t s = range.start; s < range.end; s++ )
+            {
+                labelStrip( binary,
+                            stripBegin( s ),
+                            stripBegin( s + 1 ),
+                            tolerance,
+                            strips[ static_cast< size_t >( s ) ] );
+            }
+        } );
+
+    // Move all provisional labels into one union-find structure
+    std::vector< size_t > offsets( strips.size( ) );
+    size_t numProvisional = 0;
+    for ( size_t s = 0; s < strips.size( ); s++ )
+    {
+        offsets[ s ] = numProvisional;
+        numProvisional += strips[ s ].parent.size( );
+    }
+
+    std::vector< size_t > parent( numProvisional );
+    for ( size_t s = 0; s < strips.size( ); s++ )
+    {
+        const auto& stripParent = strips[ s ].parent;
+        for ( size_t i = 0; i < stripParent.size( ); i++ )
+        {
+            parent[ offsets[ s ] + i ] = stripParent[ i ] + offsets[ s ];
+        }
+    }
+
+    // Join the components touching each other across the strip borders
+    for ( size_t s = 1; s < strips.size( ); s++ )
+    {
+        const auto& upper = strips[ s - 1 ];
+        const auto& lower = strips[ s ];
+
+        size_t k = upper.lastRowBegin;
+        for ( size_t i = 0; i < lower.firstRowEnd; i++ )
+        {
+            const Run& run = lower.runs[ i ];
+
+            while ( k < upper.runs.size( ) &&
+                    upper.runs[ k ].end + tolerance < run.start )
+            {
+                k++;
+            }
+
+            for ( size_t j = k; j < upper.runs.size( ) &&
+                                upper.runs[ j ].start <= run.end + tolerance;
+                  j++ )
+            {
+                unite( parent,
+                       upper.runs[ j ].label + offsets[ s - 1 ],
+                       run.label + offsets[ s ] );
+            }
+        }
+    }
+
+    // Roots are the smallest label of their set, so they are always visited
+    // before the other members
+    std::vector< int32_t > finalLabel( numProvisional, 0 );
+    int32_t numBlobs = 0;
+    for ( size_t i = 0; i < numProvisional; i++ )
+    {
+        const size_t root = findRoot( parent, i );
+        finalLabel[ i ] = root == i ? ++numBlobs : finalLabel[ root ];
+    }
+
+    std::vector< MomentAccumulator > accumulators(
+        static_cast< size_t >( numBlobs ) );
+    for ( size_t s = 0; s < strips.size( ); s++ )
+    {
+        const auto& stripAccumulators = strips[ s ].accumulators;
+        for ( size_t i = 0; i < stripAccumulators.size( ); i++ )
+        {
+            const auto blob =
+                static_cast< size_t >( finalLabel[ offsets[ s ] + i ] - 1 );
+            accumulators[ blob ].merge( stripAccumulators[ i ] );
+        }
+    }
+
+    blobs.resize( accumulators.size( ) );
+    for ( size_t i = 0; i < accumulators.size( ); i++ )
+    {
+        const auto& acc = accumulators[ i ];
+        auto& blob = blobs[ i ];
+
+        blob.label = static_cast< int32_t >( i + 1 );
+        blob.area = static_cast< int64_t >( acc.m00 );
+        blob.boundingBox = cv::Rect( acc.minX,
+                                     acc.minY,
+                                     acc.maxX - acc.minX + 1,
+                                     acc.maxY - acc.minY + 1 );
+        blob.centroid = cv::Point2d( acc.m10 / acc.m00, acc.m01 / acc.m00 );
+        blob.moments = cv::Moments( acc.m00,
+                                    acc.m10,
+                                    acc.m01,
+                                    acc.m20,
+                                    acc.m11,
+                                    acc.m02,
+                                    acc.m30,
+                                    acc.m21,
+                                    acc.m12,
+                                    acc.m03 );
+    }
+
+    if ( labels.needed( ) )
+    {
+        labels.create( binary.size( ), CV_32S );
+        cv::Mat labelImage = labels.getMat( );
+
+        // Only the runs are painted, the background is cleared per strip
+        cv::parallel_for_(
+            cv::Range( 0, numStrips ), [ & ]( const cv::Range& range ) {
+                for ( int32_t s = range.start; s < range.end; s++ )
+                {
+                    const auto strip = static_cast< size_t >( s );
+
+                    labelImage.rowRange( stripBegin( s ), stripBegin( s + 1 ) )
+                        .setTo( 0 );
+
+                    for ( const auto& run : strips[ strip ].runs )
+                    {
+                        auto* row = labelImage.ptr< int32_t >( run.row );
+                        std::fill( row + run.start,
+                                   row + run.end + 1,
+                                   finalLabel[ offsets[ strip ] + run.label ] );
+                    }
+                }
+            } );
+    }
+
+    return numBlobs + 1;
+}
+
+cv::Mat colorizeLabels( const cv::Mat& labels, int32_t numLabels )
+{
+    CV_Assert( labels.type( ) == CV_32SC1 );
+
+    // Build one color per label instead of normalizing the whole label image
+    const int32_t paletteSize = std::max( numLabels, 1 );
+    cv::Mat ramp( 1, paletteSize, CV_8UC1 );
+    for ( int32_t i = 0; i < paletteSize; i++ )
+    {
+        ramp.at< uchar >( i ) = cv::saturate_cast< uchar >(
+            paletteSize > 1 ? 255.0 * i / ( paletteSize - 1 ) : 0.0 );
+    }
+
+    cv::Mat palette;
+    cv::applyColorMap( ramp, palette, cv::COLORMAP_JET );
+    const auto* colors = palette.ptr< cv::Vec3b >( 0 );
+
+    cv::Mat colorMap( labels.size( ), CV_8UC3 );
+
+    cv::parallel_for_(
+        cv::Range( 0, labels.rows ), [ & ]( const cv::Range& range ) {
+            for ( int32_t y = range.start; y < range.end; y++ )
+            {
+                const auto* src = labels.ptr< int32_t >( y );
+                auto* dst = colorMap.ptr< cv::Vec3b >( y );
+
+                for ( int32_t x = 0; x < labels.cols; x++ )
+                {
+                    dst[ x ] =
+                        colors[ std::clamp( src[ x ], 0, paletteSize - 1 ) ];
+                }
+            }
+        } );
+
+    return colorMap;
+}
@@ -0,0 +1,170 @@
+#include <BlobPreprocessing.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Source positions and weights of cv::resize( INTER_LINEAR ) along one axis:
+// output pixel centers map to source pixel centers, clamped at the borders
+void linearTable( int32_t srcSize, int32_t dstSize, int32_t stride,
+                  std::vector< int32_t >& first, std::vector< int32_t >& second,
+                  std::vector< float >& weight )
+{
+    const auto size = static_cast< size_t >( dstSize );
+    first.resize( size );
+    second.resize( size );
+    weight.resize( size );
+
+    const double ratio =
+        static_cast< double >( srcSize ) / static_cast< double >( dstSize );
+
+    for ( int32_t d = 0; d < dstSize; d++ )
+    {
+        const double position = ( d + 0.5 ) * ratio - 0.5;
+        auto s = static_cast< int32_t >( std::floor( position ) );
+        auto w = static_cast< float >( position - s );
+
+        if ( s < 0 )
+        {
+            s = 0;
+            w = 0.0f;
+        }
+        if ( s >= srcSize - 1 )
+        {
+            s = srcSize - 1;
+            w = 0.0f;
+        }
+
+        const auto i = static_cast< size_t >( d );
+        first[ i ] = s * stride;
+        second[ i ] = std::min( s + 1, srcSize - 1 ) * stride;
+        weight[ i ] = w;
+    }
+}
+} // namespace
+
+BlobPreprocessor::BlobPreprocessor( const BlobParams& _params /*= { }*/ )
+    : params( _params )
+{
+    CV_Assert( params.size.width > 0 && params.size.height > 0 );
+}
+
+const cv::Mat& BlobPreprocessor::process( const cv::Mat& image )
+{
+    CV_Assert( image.type( ) == CV_8UC3 );
+
+    const int32_t sizes[] = { 1, 3, params.size.height, params.size.width };
+    blob.create( 4, sizes, CV_32F );
+
+    fill( image, blob.ptr< float >( ) );
+
+    return blob;
+}
+
+const cv::Mat& BlobPreprocessor::process( const std::vector< cv::Mat >& images )
+{
+    const int32_t sizes[] = { static_cast< int32_t >( images.size( ) ),
+                              3,
+                              params.size.height,
+                              params.size.width };
+    blob.create( 4, sizes, CV_32F );
+
+    for ( size_t i = 0; i < images.size( ); i++ )
+    {
+        CV_Assert( images[ i ].type( ) == CV_8UC3 );
+
+        fill( images[ i ], blob.ptr< float >( static_cast< int32_t >( i ) ) );
+    }
+
+    return blob;
+}
+
+void BlobPreprocessor::updateTables( cv::Size imageSize )
+{
+    if ( imageSize == tableSize )
+    {
+        return;
+    }
+
+    // Columns address bytes within a row, rows are addressed by index
+    linearTable( imageSize.width, params.size.width, 3, left, right, weightX );
+    linearTable(
+        imageSize.height, params.size.height, 1, top, bottom, weightY );
+
+    tableSize = imageSize;
+}
+
+void BlobPreprocessor::fill( const cv::Mat& image, float* planes )
+{
+    updateTables( image.size( ) );
+
+    const int32_t width = params.size.width;
+    const auto planeSize = static_cast< size_t >( width ) *
+                           static_cast< size_t >( params.size.height );
+
+    //
+    // Source channel c lands in plane target[ c ] as v * scale[ c ] +
+    // offset[ c ], the mean and scale of that plane folded into one multiply
+    // add
+    //
+    float* target[ 3 ];
+    float scale[ 3 ];
+    float offset[ 3 ];
+
+    for ( int32_t c = 0; c < 3; c++ )
+    {
+        const int32_t plane = params.swapRB ? 2 - c : c;
+        const auto i = static_cast< size_t >( c );
+
+        target[ i ] = planes + static_cast< size_t >( plane ) * planeSize;
+        scale[ i ] = static_cast< float >( params.scale );
+        offset[ i ] =
+            static_cast< float >( -params.mean[ plane ] * params.scale );
+    }
+
+    cv::parallel_for_(
+        cv::Range( 0, params.size.height ), [ & ]( const cv::Range& range ) {
+            for ( int32_t y = range.start; y < range.end; y++ )
+            {
+                const auto row = static_cast< size_t >( y );
+                const uchar* upper = image.ptr< uchar >( top[ row ] );
+                const uchar* lower = image.ptr< uchar >( bottom[ row ] );
+                const float wy = weightY[ row ];
+                const size_t rowStart = row * static_cast< size_t >( width );
+
+                for ( int32_t c = 0; c < 3; c++ )
+                {
+                    const auto i = static_cast< size_t >( c );
+                    float* out = target[ i ] + rowStart;
+
+                    for ( int32_t x = 0; x < width; x++ )
+                    {
+                        const auto column = static_cast< size_t >( x );
+                        const auto l =
+                            static_cast< size_t >( left[ column ] + c );
+                        const auto r =
+                            static_cast< size_t >( right[ column ] + c );
+                        const float wx = weightX[ column ];
+
+                        const auto ul = static_cast< float >( upper[ l ] );
+                        const auto ur = static_cast< float >( upper[ r ] );
+                        const auto ll = static_cast< float >( lower[ l ] );
+                        const auto lr = static_cast< float >( lower[ r ] );
+
+                        const float t = ul + ( ur - ul ) * wx;
+                        const float b = ll + ( lr - ll ) * wx;
+
+                        out[ x ] =
+                            ( t + ( b - t ) * wy ) * scale[ i ] + offset[ i ];
+                    }
+                }
+            }
+        } );
+}
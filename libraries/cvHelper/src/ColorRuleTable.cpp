@@ -0,0 +1,115 @@
+#include <ColorRuleTable.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+IGNORE_WARNINGS_POP
+
+ColorRuleTable::ColorRuleTable( const Rule& rule, int32_t _bits /*= 8*/ )
+{
+    build( rule, _bits );
+}
+
+void ColorRuleTable::build( const Rule& rule, int32_t _bits /*= 8*/ )
+{
+    CV_Assert( _bits >= 1 && _bits <= 8 );
+
+    bits = _bits;
+
+    const int32_t levels = 1 << bits;
+    const int32_t shift = 8 - bits;
+
+    // Bins are represented by their center, exact values for 8 bits
+    const int32_t offset = shift > 0 ? 1 << ( shift - 1 ) : 0;
+
+    // A slice holds levels * levels colors, a multiple of 64 for bits >= 3
+    const size_t sliceBits = static_cast< size_t >( levels * levels );
+    table.assign( ( sliceBits * static_cast< size_t >( levels ) + 63 ) / 64,
+                  0 );
+
+    //
+    // One slice of constant red per call: green along the rows, blue along
+    // the columns. Slices share table words for bits < 3, so those small
+    // tables are built sequentially.
+    //
+    const auto buildSlices = [ & ]( const cv::Range& range ) {
+        cv::Mat colors( levels, levels, CV_8UC3 );
+        cv::Mat mask;
+
+        for ( int32_t r = range.start; r < range.end; r++ )
+        {
+            for ( int32_t g = 0; g < levels; g++ )
+            {
+                auto* row = colors.ptr< cv::Vec3b >( g );
+
+                for ( int32_t b = 0; b < levels; b++ )
+                {
+                    row[ b ] = cv::Vec3b(
+                        static_cast< uchar >( ( b << shift ) + offset ),
+                        static_cast< uchar >( ( g << shift ) + offset ),
+                        static_cast< uchar >( ( r << shift ) + offset ) );
+                }
+            }
+
+            rule( colors, mask );
+            CV_Assert( mask.type( ) == CV_8UC1 &&
+                       mask.size( ) == colors.size( ) );
+
+            for ( int32_t g = 0; g < levels; g++ )
+            {
+                const uchar* inside = mask.ptr< uchar >( g );
+
+                for ( int32_t b = 0; b < levels; b++ )
+                {
+                    if ( inside[ b ] != 0 )
+                    {
+                        const auto index = static_cast< size_t >(
+                            ( r << ( 2 * bits ) ) | ( g << bits ) | b );
+                        table[ index / 64 ] |= uint64_t { 1 } << ( index % 64 );
+                    }
+                }
+            }
+        }
+    };
+
+    if ( bits < 3 )
+    {
+        buildSlices( cv::Range( 0, levels ) );
+    }
+    else
+    {
+        cv::parallel_for_( cv::Range( 0, levels ), buildSlices );
+    }
+}
+
+void ColorRuleTable::apply( const cv::Mat& bgr, cv::Mat& mask ) const
+{
+    CV_Assert( ! table.empty( ) );
+    CV_Assert( bgr.type( ) == CV_8UC3 );
+
+    mask.create( bgr.size( ), CV_8UC1 );
+
+    const int32_t shift = 8 - bits;
+    const int32_t width = bgr.cols;
+
+    cv::parallel_for_(
+        cv::Range( 0, bgr.rows ), [ & ]( const cv::Range& range ) {
+            for ( int32_t y = range.start; y < range.end; y++ )
+            {
+                const auto* in = bgr.ptr< cv::Vec3b >( y );
+                uchar* out = mask.ptr< uchar >( y );
+
+                for ( int32_t x = 0; x < width; x++ )
+                {
+                    const auto index = static_cast< size_t >(
+                        ( ( in[ x ][ 2 ] >> shift ) << ( 2 * bits ) ) |
+                        ( ( in[ x ][ 1 ] >> shift ) << bits ) |
+                        ( in[ x ][ 0 ] >> shift ) );
+
+                    const bool inside =
+                        ( ( table[ index / 64 ] >> ( index % 64 ) ) & 1 ) != 0;
+                    out[ x ] = inside ? 255 : 0;
+                }
+            }
+        } );
+}
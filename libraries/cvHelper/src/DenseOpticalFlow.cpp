@@ -0,0 +1,161 @@
+#include <DenseOpticalFlow.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <utility>
+
+DenseOpticalFlow::DenseOpticalFlow( const DenseFlowParams& _params /*= { }*/ )
+    : params( _params )
+{
+    CV_Assert( params.scale > 0.0 && params.scale <= 1.0 );
+    CV_Assert( params.tiles.width > 0 && params.tiles.height > 0 );
+    CV_Assert( params.overlap >= 0 );
+
+    const auto numTiles = static_cast< size_t >( params.tiles.area( ) );
+
+    for ( size_t i = 0; i < numTiles; i++ )
+    {
+        if ( params.method == DenseFlowMethod::Dis )
+        {
+            tileFlows.push_back(
+                cv::DISOpticalFlow::create( params.disPreset ) );
+        }
+        else
+        {
+            tileFlows.push_back( cv::FarnebackOpticalFlow::create( ) );
+        }
+    }
+
+    tileRects.resize( numTiles );
+    tileResults.resize( numTiles );
+}
+
+bool DenseOpticalFlow::update( const cv::Mat& gray, cv::Mat& flow )
+{
+    CV_Assert( gray.type( ) == CV_8UC1 );
+
+    if ( params.scale < 1.0 )
+    {
+        cv::resize( gray,
+                    current,
+                    cv::Size( ),
+                    params.scale,
+                    params.scale,
+                    cv::INTER_AREA );
+    }
+    else
+    {
+        gray.copyTo( current );
+    }
+
+    if ( previous.empty( ) || previous.size( ) != current.size( ) )
+    {
+        std::swap( previous, current );
+        return false;
+    }
+
+    const cv::Size size = current.size( );
+    const cv::Rect image( cv::Point( 0, 0 ), size );
+
+    for ( int32_t ty = 0; ty < params.tiles.height; ty++ )
+    {
+        const int32_t y0 = ty * size.height / params.tiles.height;
+        const int32_t y1 = ( ty + 1 ) * size.height / params.tiles.height;
+
+        for ( int32_t tx = 0; tx < params.tiles.width; tx++ )
+        {
+            const int32_t x0 = tx * size.width / params.tiles.width;
+            const int32_t x1 = ( tx + 1 ) * size.width / params.tiles.width;
+
+            tileRects[ static_cast< size_t >( ty * params.tiles.width + tx ) ] =
+                cv::Rect( x0, y0, x1 - x0, y1 - y0 );
+        }
+    }
+
+    smallFlow.create( size, CV_32FC2 );
+
+    cv::parallel_for_(
+        cv::Range( 0, static_cast< int32_t >( tileRects.size( ) ) ),
+        [ & ]( const cv::Range& range ) {
+            for ( int32_t t = range.start; t < range.end; t++ )
+            {
+                const auto tile = static_cast< size_t >( t );
+                const cv::Rect inner = tileRects[ tile ];
+                if ( inner.empty( ) )
+                {
+                    continue;
+                }
+
+                // Estimate on the tile grown by the overlap, keep the inner
+                // part only
+                const cv::Rect outer =
+                    cv::Rect( inner.x - params.overlap,
+                              inner.y - params.overlap,
+                              inner.width + 2 * params.overlap,
+                              inner.height + 2 * params.overlap ) &
+                    image;
+
+                cv::Mat& result = tileResults[ tile ];
+                tileFlows[ tile ]->calc(
+                    previous( outer ), current( outer ), result );
+
+                result( inner - outer.tl( ) ).copyTo( smallFlow( inner ) );
+            }
+        } );
+
+    if ( params.scale < 1.0 )
+    {
+        // Bring the vectors to input pixel units as well
+        cv::resize( smallFlow, flow, gray.size( ), 0.0, 0.0, cv::INTER_LINEAR );
+        cv::multiply(
+            flow,
+            cv::Scalar( static_cast< double >( gray.cols ) / size.width,
+                        static_cast< double >( gray.rows ) / size.height ),
+            flow );
+    }
+    else
+    {
+        smallFlow.copyTo( flow );
+    }
+
+    std::swap( previous, current );
+
+    return true;
+}
+
+cv::Mat flowToColor( const cv::Mat& flow, double maxMagnitude /*= 0.0*/ )
+{
+    CV_Assert( flow.type( ) == CV_32FC2 );
+
+    cv::Mat components[ 2 ];
+    cv::split( flow, components );
+
+    cv::Mat magnitude, angle;
+    cv::cartToPolar( components[ 0 ], components[ 1 ], magnitude, angle, true );
+
+    if ( maxMagnitude <= 0.0 )
+    {
+        cv::minMaxLoc( magnitude, nullptr, &maxMagnitude );
+    }
+
+    // Hue covers 0..180 in 8 bit HSV
+    cv::Mat hsvChannels[ 3 ];
+    angle.convertTo( hsvChannels[ 0 ], CV_8U, 0.5 );
+    hsvChannels[ 1 ] = cv::Mat( flow.size( ), CV_8UC1, cv::Scalar( 255 ) );
+    magnitude.convertTo( hsvChannels[ 2 ],
+                         CV_8U,
+                         maxMagnitude > 0.0 ? 255.0 / maxMagnitude : 0.0 );
+
+    cv::Mat hsv, bgr;
+    cv::merge( hsvChannels, 3, hsv );
+    cv::cvtColor( hsv, bgr, cv::COLOR_HSV2BGR );
+
+    return bgr;
+}
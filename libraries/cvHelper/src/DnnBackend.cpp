@@ -0,0 +1,95 @@
+#include <DnnBackend.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/dnn.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+
+namespace
+{
+struct BackendTarget
+{
+    cv::dnn::Backend backend;
+    cv::dnn::Target target;
+};
+
+BackendTarget toOpenCV( DnnBackend backend )
+{
+    switch ( backend )
+    {
+    case DnnBackend::OpenCLFP16:
+        return { cv::dnn::DNN_BACKEND_OPENCV, cv::dnn::DNN_TARGET_OPENCL_FP16 };
+
+    case DnnBackend::OpenVino:
+        return { cv::dnn::DNN_BACKEND_INFERENCE_ENGINE,
+                 cv::dnn::DNN_TARGET_CPU };
+
+    case DnnBackend::OpenCV:
+        break;
+    }
+
+    return { cv::dnn::DNN_BACKEND_OPENCV, cv::dnn::DNN_TARGET_CPU };
+}
+} // namespace
+
+const char* getDnnBackendName( DnnBackend backend )
+{
+    switch ( backend )
+    {
+    case DnnBackend::OpenCV:
+        return "opencv";
+    case DnnBackend::OpenCLFP16:
+        return "fp16";
+    case DnnBackend::OpenVino:
+        return "openvino";
+    }
+
+    return "";
+}
+
+bool parseDnnBackend( const std::string& name, DnnBackend& backend )
+{
+    for ( const auto candidate :
+          { DnnBackend::OpenCV, DnnBackend::OpenCLFP16, DnnBackend::OpenVino } )
+    {
+        if ( name == getDnnBackendName( candidate ) )
+        {
+            backend = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool isDnnBackendAvailable( DnnBackend backend )
+{
+    const auto [ dnnBackend, target ] = toOpenCV( backend );
+
+    if ( target == cv::dnn::DNN_TARGET_OPENCL_FP16 &&
+         ! cv::ocl::haveOpenCL( ) )
+    {
+        return false;
+    }
+
+    const auto targets = cv::dnn::getAvailableTargets( dnnBackend );
+
+    return std::find( targets.begin( ), targets.end( ), target ) !=
+           targets.end( );
+}
+
+bool setDnnBackend( cv::dnn::Net& net, DnnBackend backend )
+{
+    const bool available = isDnnBackendAvailable( backend );
+    const auto [ dnnBackend, target ] =
+        toOpenCV( available ? backend : DnnBackend::OpenCV );
+
+    net.setPreferableBackend( dnnBackend );
+    net.setPreferableTarget( target );
+
+    return available;
+}
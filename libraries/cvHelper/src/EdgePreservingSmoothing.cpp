@@ -0,0 +1,519 @@
+#include <EdgePreservingSmoothing.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+// Columns per parallel work item of the vertical domain transform pass
+constexpr int32_t COLUMN_STRIP_WIDTH = 256;
+
+// Rows per parallel work item of the guided filter, without the margins
+constexpr int32_t GUIDED_STRIP_HEIGHT = 64;
+
+// One step of the vertical domain transform recursion: row f is pulled
+// towards the already filtered neighbor row by the weights w
+void verticalStep( float* f, const float* neighbor, const float* w, int32_t x0,
+                   int32_t x1, int32_t cn )
+{
+    for ( int32_t x = x0; x < x1; x++ )
+    {
+        for ( int32_t c = 0; c < cn; c++ )
+        {
+            const int32_t j = x * cn + c;
+            f[ j ] += w[ x ] * ( neighbor[ j ] - f[ j ] );
+        }
+    }
+}
+} // namespace
+
+//
+// Bilateral grid
+//
+void EdgePreservingSmoother::bilateralGrid( const cv::Mat& src,
+                                            const SmoothingParams& params )
+{
+    const int32_t cn = src.channels( );
+
+    // Channel sums followed by the pixel count per cell
+    const int32_t stride = cn + 1;
+
+    cv::Mat guide = src;
+    if ( cn != 1 )
+    {
+        cv::cvtColor( src, gray, cv::COLOR_BGR2GRAY );
+        guide = gray;
+    }
+
+    // Grid cells per sigma. The grid is blurred with a Gaussian of that many
+    // cells, so the result approximates the full bilateral filter.
+    const double samples = 0.5 + params.quality;
+    const double cellSpace = std::max( 1.0, params.sigmaSpace / samples );
+    const double cellRange = std::max( 1.0, params.sigmaColor / samples );
+    const auto radius = static_cast< int32_t >( std::ceil( 2.0 * samples ) );
+
+    // The grid is padded by the blur radius, the padding stays empty
+    const int32_t gridWidth =
+        cvRound( ( src.cols - 1 ) / cellSpace ) + 1 + 2 * radius;
+    const int32_t gridHeight =
+        cvRound( ( src.rows - 1 ) / cellSpace ) + 1 + 2 * radius;
+    const int32_t gridDepth = cvRound( 255.0 / cellRange ) + 1 + 2 * radius;
+
+    const auto cell = [ & ]( int32_t gx, int32_t gy, int32_t gz ) {
+        const auto x = static_cast< size_t >( gx );
+        const auto y = static_cast< size_t >( gy );
+        const auto z = static_cast< size_t >( gz );
+        return ( ( y * static_cast< size_t >( gridWidth ) + x ) *
+                     static_cast< size_t >( gridDepth ) +
+                 z ) *
+               static_cast< size_t >( stride );
+    };
+
+    grid.assign( cell( 0, gridHeight, 0 ), 0.0f );
+    blurred.resize( grid.size( ) );
+
+    // Nearest cell of every column, row and intensity
+    std::vector< int32_t > cellX( static_cast< size_t >( src.cols ) );
+    std::vector< int32_t > cellZ( 256 );
+    std::vector< int32_t > firstRow( static_cast< size_t >( gridHeight ) + 1,
+                                     src.rows );
+
+    for ( int32_t x = 0; x < src.cols; x++ )
+    {
+        cellX[ static_cast< size_t >( x ) ] =
+            cvRound( x / cellSpace ) + radius;
+    }
+    for ( int32_t z = 0; z < 256; z++ )
+    {
+        cellZ[ static_cast< size_t >( z ) ] =
+            cvRound( z / cellRange ) + radius;
+    }
+    for ( int32_t y = src.rows - 1; y >= 0; y-- )
+    {
+        const int32_t gy = cvRound( y / cellSpace ) + radius;
+        firstRow[ static_cast< size_t >( gy ) ] = y;
+    }
+    for ( int32_t gy = gridHeight - 1; gy >= 0; gy-- )
+    {
+        const auto i = static_cast< size_t >( gy );
+        firstRow[ i ] = std::min( firstRow[ i ], firstRow[ i + 1 ] );
+    }
+
+    //
+    // Splat. Every image row falls into exactly one grid row, so grid rows
+    // are filled in parallel without any synchronization.
+    //
+    cv::parallel_for_(
+        cv::Range( 0, gridHeight ), [ & ]( const cv::Range& range ) {
+            for ( int32_t gy = range.start; gy < range.end; gy++ )
+            {
+                const auto i = static_cast< size_t >( gy );
+
+                for ( int32_t y = firstRow[ i ]; y < firstRow[ i + 1 ]; y++ )
+                {
+                    const auto* s = src.ptr< uchar >( y );
+                    const auto* g = guide.ptr< uchar >( y );
+
+                    for ( int32_t x = 0; x < src.cols; x++ )
+                    {
+                        const int32_t gx = cellX[ static_cast< size_t >( x ) ];
+                        float* c = &grid[ cell( gx, gy, cellZ[ g[ x ] ] ) ];
+
+                        for ( int32_t k = 0; k < cn; k++ )
+                        {
+                            c[ k ] += static_cast< float >( s[ x * cn + k ] );
+                        }
+                        c[ cn ] += 1.0f;
+                    }
+                }
+            }
+        } );
+
+    //
+    // Separable Gaussian blur along x, y and intensity
+    //
+    std::vector< float > kernel( static_cast< size_t >( 2 * radius + 1 ) );
+    for ( int32_t k = -radius; k <= radius; k++ )
+    {
+        kernel[ static_cast< size_t >( k + radius ) ] = static_cast< float >(
+            std::exp( -k * k / ( 2.0 * samples * samples ) ) );
+    }
+
+    const int32_t sizes[ 3 ] = { gridWidth, gridHeight, gridDepth };
+    const ptrdiff_t steps[ 3 ] = {
+        static_cast< ptrdiff_t >( cell( 1, 0, 0 ) ),
+        static_cast< ptrdiff_t >( cell( 0, 1, 0 ) ),
+        static_cast< ptrdiff_t >( cell( 0, 0, 1 ) ) };
+
+    for ( int32_t axis = 0; axis < 3; axis++ )
+    {
+        const int32_t size = sizes[ axis ];
+        const ptrdiff_t step = steps[ axis ];
+
+        cv::parallel_for_(
+            cv::Range( 0, gridHeight ), [ & ]( const cv::Range& range ) {
+                for ( int32_t gy = range.start; gy < range.end; gy++ )
+                {
+                    for ( int32_t gx = 0; gx < gridWidth; gx++ )
+                    {
+                        for ( int32_t gz = 0; gz < gridDepth; gz++ )
+                        {
+                            const int32_t position =
+                                axis == 0 ? gx : ( axis == 1 ? gy : gz );
+                            const size_t index = cell( gx, gy, gz );
+
+                            float* out = &blurred[ index ];
+                            std::fill( out, out + stride, 0.0f );
+
+                            const int32_t k0 = std::max( -radius, -position );
+                            const int32_t k1 =
+                                std::min( radius, size - 1 - position );
+
+                            for ( int32_t k = k0; k <= k1; k++ )
+                            {
+                                const float w = kernel[ static_cast< size_t >(
+                                    k + radius ) ];
+                                const float* in = &grid[ index ] + k * step;
+
+                                for ( int32_t c = 0; c < stride; c++ )
+                                {
+                                    out[ c ] += w * in[ c ];
+                                }
+                            }
+                        }
+                    }
+                }
+            } );
+
+        std::swap( grid, blurred );
+    }
+
+    //
+    // Slice: trilinear interpolation at ( x, y, intensity ) of every pixel,
+    // normalized by the interpolated pixel count
+    //
+    result.create( src.size( ), src.type( ) );
+
+    cv::parallel_for_(
+        cv::Range( 0, src.rows ), [ & ]( const cv::Range& range ) {
+            std::vector< float > sum( static_cast< size_t >( stride ) );
+
+            for ( int32_t y = range.start; y < range.end; y++ )
+            {
+                const auto* s = src.ptr< uchar >( y );
+                const auto* g = guide.ptr< uchar >( y );
+                auto* d = result.ptr< uchar >( y );
+
+                const double fy = y / cellSpace + radius;
+                const auto y0 = static_cast< int32_t >( fy );
+                const auto wy = static_cast< float >( fy - y0 );
+
+                for ( int32_t x = 0; x < src.cols; x++ )
+                {
+                    const double fx = x / cellSpace + radius;
+                    const double fz = g[ x ] / cellRange + radius;
+                    const auto x0 = static_cast< int32_t >( fx );
+                    const auto z0 = static_cast< int32_t >( fz );
+                    const auto wx = static_cast< float >( fx - x0 );
+                    const auto wz = static_cast< float >( fz - z0 );
+
+                    std::fill( sum.begin( ), sum.end( ), 0.0f );
+
+                    for ( int32_t corner = 0; corner < 8; corner++ )
+                    {
+                        const int32_t dx = corner & 1;
+                        const int32_t dy = ( corner >> 1 ) & 1;
+                        const int32_t dz = ( corner >> 2 ) & 1;
+
+                        const float w = ( dx ? wx : 1.0f - wx ) *
+                                        ( dy ? wy : 1.0f - wy ) *
+                                        ( dz ? wz : 1.0f - wz );
+                        const float* c =
+                            &grid[ cell( x0 + dx, y0 + dy, z0 + dz ) ];
+
+                        for ( size_t k = 0; k < sum.size( ); k++ )
+                        {
+                            sum[ k ] += w * c[ k ];
+                        }
+                    }
+
+                    const float weight = sum[ static_cast< size_t >( cn ) ];
+
+                    for ( int32_t k = 0; k < cn; k++ )
+                    {
+                        const float value = sum[ static_cast< size_t >( k ) ];
+                        d[ x * cn + k ] =
+                            weight > 0.0f
+                                ? cv::saturate_cast< uchar >( value / weight )
+                                : s[ x * cn + k ];
+                    }
+                }
+            }
+        } );
+}
+
+//
+// Guided filter
+//
+void EdgePreservingSmoother::guidedFilter( const cv::Mat& src,
+                                           const SmoothingParams& params )
+{
+    // Coefficients are computed on an image subsampled by this factor
+    const int32_t subsample =
+        std::clamp( cvRound( 1.0 / params.quality ), 1, 8 );
+
+    src.convertTo( image, CV_32F );
+
+    // Coefficients of the subsampled image in small, or of image itself
+    cv::Mat coarse = image;
+    if ( subsample > 1 )
+    {
+        cv::resize( image,
+                    small,
+                    cv::Size( ),
+                    1.0 / subsample,
+                    1.0 / subsample,
+                    cv::INTER_AREA );
+        coarse = small;
+    }
+
+    const int32_t radius =
+        std::max( 1, cvRound( params.sigmaSpace / subsample ) );
+    const cv::Size ksize( 2 * radius + 1, 2 * radius + 1 );
+    const cv::Scalar eps = cv::Scalar::all( params.sigmaColor *
+                                            params.sigmaColor );
+
+    meanA.create( coarse.size( ), coarse.type( ) );
+    meanB.create( coarse.size( ), coarse.type( ) );
+
+    //
+    // Horizontal strips in parallel. Two box filters in a row need a margin
+    // of twice the radius, only the rows of the strip itself are kept.
+    //
+    const int32_t margin = 2 * radius;
+    const int32_t numStrips =
+        ( coarse.rows + GUIDED_STRIP_HEIGHT - 1 ) / GUIDED_STRIP_HEIGHT;
+
+    cv::parallel_for_(
+        cv::Range( 0, numStrips ), [ & ]( const cv::Range& range ) {
+            cv::Mat mean, meanSq, variance, a, b, boxA, boxB;
+
+            for ( int32_t strip = range.start; strip < range.end; strip++ )
+            {
+                const int32_t y0 = strip * GUIDED_STRIP_HEIGHT;
+                const int32_t y1 =
+                    std::min( coarse.rows, y0 + GUIDED_STRIP_HEIGHT );
+                const int32_t top = std::max( 0, y0 - margin );
+                const int32_t bottom = std::min( coarse.rows, y1 + margin );
+
+                const cv::Mat block = coarse.rowRange( top, bottom );
+
+                cv::boxFilter( block, mean, CV_32F, ksize );
+                cv::boxFilter( block.mul( block ), meanSq, CV_32F, ksize );
+
+                // a = var / ( var + eps ), b = mean - a * mean
+                cv::subtract( meanSq, mean.mul( mean ), variance );
+                cv::add( variance, eps, a );
+                cv::divide( variance, a, a );
+                cv::subtract( mean, a.mul( mean ), b );
+
+                cv::boxFilter( a, boxA, CV_32F, ksize );
+                cv::boxFilter( b, boxB, CV_32F, ksize );
+
+                boxA.rowRange( y0 - top, y1 - top )
+                    .copyTo( meanA.rowRange( y0, y1 ) );
+                boxB.rowRange( y0 - top, y1 - top )
+                    .copyTo( meanB.rowRange( y0, y1 ) );
+            }
+        } );
+
+    cv::Mat a = meanA;
+    cv::Mat b = meanB;
+    if ( subsample > 1 )
+    {
+        cv::resize( meanA, fullA, image.size( ), 0, 0, cv::INTER_LINEAR );
+        cv::resize( meanB, fullB, image.size( ), 0, 0, cv::INTER_LINEAR );
+        a = fullA;
+        b = fullB;
+    }
+
+    // output = a * image + b, computed in place in image
+    cv::multiply( a, image, image );
+    cv::add( image, b, image );
+    image.convertTo( result, src.type( ) );
+}
+
+//
+// Domain transform, recursive filter variant
+//
+void EdgePreservingSmoother::domainTransform( const cv::Mat& src,
+                                              const SmoothingParams& params )
+{
+    const int32_t cn = src.channels( );
+    const int32_t rows = src.rows;
+    const int32_t cols = src.cols;
+
+    src.convertTo( image, CV_32F );
+
+    //
+    // Derivatives of the transformed domain, 1 + sigmaSpace / sigmaColor
+    // times the L1 color distance to the left and upper neighbor
+    //
+    dHdx.create( rows, cols, CV_32FC1 );
+    dVdy.create( rows, cols, CV_32FC1 );
+    const auto ratio =
+        static_cast< float >( params.sigmaSpace / params.sigmaColor );
+
+    cv::parallel_for_( cv::Range( 0, rows ), [ & ]( const cv::Range& range ) {
+        for ( int32_t y = range.start; y < range.end; y++ )
+        {
+            const float* f = image.ptr< float >( y );
+            const float* up = image.ptr< float >( std::max( 0, y - 1 ) );
+            float* h = dHdx.ptr< float >( y );
+            float* v = dVdy.ptr< float >( y );
+
+            for ( int32_t x = 0; x < cols; x++ )
+            {
+                float sumH = 0.0f;
+                float sumV = 0.0f;
+
+                for ( int32_t c = 0; c < cn; c++ )
+                {
+                    const int32_t i = x * cn + c;
+                    sumH += x > 0 ? std::abs( f[ i ] - f[ i - cn ] ) : 0.0f;
+                    sumV += std::abs( f[ i ] - up[ i ] );
+                }
+
+                h[ x ] = 1.0f + ratio * sumH;
+                v[ x ] = 1.0f + ratio * sumV;
+            }
+        }
+    } );
+
+    const int32_t iterations =
+        std::clamp( cvRound( 3.0 * params.quality ), 1, 3 );
+    const int32_t numStrips =
+        ( cols + COLUMN_STRIP_WIDTH - 1 ) / COLUMN_STRIP_WIDTH;
+
+    for ( int32_t i = 0; i < iterations; i++ )
+    {
+        // The sigma of every iteration shrinks so the total is sigmaSpace
+        const double sigmaH = params.sigmaSpace * std::sqrt( 3.0 ) *
+                              std::pow( 2.0, iterations - i - 1 ) /
+                              std::sqrt( std::pow( 4.0, iterations ) - 1.0 );
+        const double logA = -std::sqrt( 2.0 ) / sigmaH;
+
+        // Feedback weights a^d of the recursive filter
+        dHdx.convertTo( weights, CV_32F, logA );
+        cv::exp( weights, weights );
+
+        cv::parallel_for_(
+            cv::Range( 0, rows ), [ & ]( const cv::Range& range ) {
+                for ( int32_t y = range.start; y < range.end; y++ )
+                {
+                    float* f = image.ptr< float >( y );
+                    const float* w = weights.ptr< float >( y );
+
+                    for ( int32_t x = 1; x < cols; x++ )
+                    {
+                        for ( int32_t c = 0; c < cn; c++ )
+                        {
+                            const int32_t j = x * cn + c;
+                            f[ j ] += w[ x ] * ( f[ j - cn ] - f[ j ] );
+                        }
+                    }
+                    for ( int32_t x = cols - 2; x >= 0; x-- )
+                    {
+                        for ( int32_t c = 0; c < cn; c++ )
+                        {
+                            const int32_t j = x * cn + c;
+                            f[ j ] += w[ x + 1 ] * ( f[ j + cn ] - f[ j ] );
+                        }
+                    }
+                }
+            } );
+
+        dVdy.convertTo( weights, CV_32F, logA );
+        cv::exp( weights, weights );
+
+        // Column strips sweep down and up row by row, so the inner loop runs
+        // along memory
+        cv::parallel_for_(
+            cv::Range( 0, numStrips ), [ & ]( const cv::Range& range ) {
+                for ( int32_t strip = range.start; strip < range.end; strip++ )
+                {
+                    const int32_t x0 = strip * COLUMN_STRIP_WIDTH;
+                    const int32_t x1 =
+                        std::min( cols, x0 + COLUMN_STRIP_WIDTH );
+
+                    for ( int32_t y = 1; y < rows; y++ )
+                    {
+                        verticalStep( image.ptr< float >( y ),
+                                      image.ptr< float >( y - 1 ),
+                                      weights.ptr< float >( y ),
+                                      x0,
+                                      x1,
+                                      cn );
+                    }
+                    for ( int32_t y = rows - 2; y >= 0; y-- )
+                    {
+                        verticalStep( image.ptr< float >( y ),
+                                      image.ptr< float >( y + 1 ),
+                                      weights.ptr< float >( y + 1 ),
+                                      x0,
+                                      x1,
+                                      cn );
+                    }
+                }
+            } );
+    }
+
+    image.convertTo( result, src.type( ) );
+}
+
+void EdgePreservingSmoother::smooth( const cv::Mat& src, cv::Mat& dst,
+                                     const SmoothingParams& params /*= { }*/ )
+{
+    CV_Assert( src.type( ) == CV_8UC1 || src.type( ) == CV_8UC3 );
+    CV_Assert( params.sigmaSpace > 0.0 && params.sigmaColor > 0.0 );
+    CV_Assert( params.quality > 0.0 && params.quality <= 1.0 );
+
+    // All backends write into result first, so src and dst may be the same
+    // and a dst ROI is filled in place
+    switch ( params.backend )
+    {
+    case SmoothingBackend::Bilateral:
+        cv::bilateralFilter(
+            src, result, -1, params.sigmaColor, params.sigmaSpace );
+        break;
+
+    case SmoothingBackend::BilateralGrid:
+        bilateralGrid( src, params );
+        break;
+
+    case SmoothingBackend::Guided:
+        guidedFilter( src, params );
+        break;
+
+    case SmoothingBackend::DomainTransform:
+        domainTransform( src, params );
+        break;
+    }
+
+    result.copyTo( dst );
+}
+
+void smoothEdgePreserving( const cv::Mat& src, cv::Mat& dst,
+                           const SmoothingParams& params /*= { }*/ )
+{
+    EdgePreservingSmoother( ).smooth( src, dst, params );
+}
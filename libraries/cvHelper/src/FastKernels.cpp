@@ -0,0 +1,260 @@
+#include <FastKernels.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/core/utility.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+// Columns per parallel work item of the vertical pass. Wide enough for the
+// inner loops to vectorize, narrow enough for the g/h rows of one strip to
+// stay in cache.
+constexpr int32_t COLUMN_STRIP_WIDTH = 256;
+
+struct MaxOp
+{
+    static constexpr uchar identity = 0;
+    static uchar apply( uchar a, uchar b ) { return std::max( a, b ); }
+};
+
+struct MinOp
+{
+    static constexpr uchar identity = 255;
+    static uchar apply( uchar a, uchar b ) { return std::min( a, b ); }
+};
+
+// Padded line length: room for the kernel overlap on both sides, rounded up
+// to whole blocks of size k
+int32_t paddedLength( int32_t n, int32_t k )
+{
+    return ( n + 2 * k - 2 ) / k * k;
+}
+
+// Van Herk/Gil-Werman along a padded line p: g holds the prefix and h the
+// suffix extrema within every block of k samples. The extremum of the window
+// p[ i, i + k ) is then Op::apply( h[ i ], g[ i + k - 1 ] ).
+template < typename Op >
+void blockExtrema( const uchar* p, uchar* g, uchar* h, int32_t length,
+                   int32_t k )
+{
+    for ( int32_t b = 0; b < length; b += k )
+    {
+        g[ b ] = p[ b ];
+        for ( int32_t j = b + 1; j < b + k; j++ )
+        {
+            g[ j ] = Op::apply( g[ j - 1 ], p[ j ] );
+        }
+
+        h[ b + k - 1 ] = p[ b + k - 1 ];
+        for ( int32_t j = b + k - 2; j >= b; j-- )
+        {
+            h[ j ] = Op::apply( h[ j + 1 ], p[ j ] );
+        }
+    }
+}
+
+template < typename Op >
+void filterRows( const cv::Mat& src, cv::Mat& dst, int32_t k )
+{
+    const int32_t n = src.cols;
+    const int32_t anchor = k / 2;
+    const int32_t length = paddedLength( n, k );
+
+    cv::parallel_for_(
+        cv::Range( 0, src.rows ), [ & ]( const cv::Range& range ) {
+            std::vector< uchar > p( static_cast< size_t >( length ) );
+            std::vector< uchar > g( p.size( ) );
+            std::vector< uchar > h( p.size( ) );
+
+            for ( int32_t y = range.start; y < range.end; y++ )
+            {
+                // The row is copied first, so src and dst may be the same image
+                const auto* s = src.ptr< uchar >( y );
+                std::fill( p.begin( ), p.end( ), Op::identity );
+                std::copy( s, s + n, p.begin( ) + anchor );
+
+                blockExtrema< Op >(
+                    p.data( ), g.data( ), h.data( ), length, k );
+
+                auto* d = dst.ptr< uchar >( y );
+                for ( int32_t i = 0; i < n; i++ )
+                {
+                    d[ i ] =
+                        Op::apply( h[ static_cast< size_t >( i ) ],
+                                   g[ static_cast< size_t >( i + k - 1 ) ] );
+                }
+            }
+        } );
+}
+
+// Same as filterRows along the columns, but processed row by row on strips
+// of columns so that all inner loops run over contiguous memory
+template < typename Op >
+void filterCols( const cv::Mat& src, cv::Mat& dst, int32_t k )
+{
+    const int32_t n = src.rows;
+    const int32_t cols = src.cols;
+    const int32_t anchor = k / 2;
+    const int32_t length = paddedLength( n, k );
+
+    cv::Mat g( length, cols, CV_8UC1 );
+    cv::Mat h( length, cols, CV_8UC1 );
+    const std::vector< uchar > identityRow( static_cast< size_t >( cols ),
+                                            Op::identity );
+
+    const auto paddedRow = [ & ]( int32_t j ) {
+        const int32_t y = j - anchor;
+        return y >= 0 && y < n ? src.ptr< uchar >( y ) : identityRow.data( );
+    };
+
+    const int32_t numStrips =
+        ( cols + COLUMN_STRIP_WIDTH - 1 ) / COLUMN_STRIP_WIDTH;
+
+    cv::parallel_for_(
+        cv::Range( 0, numStrips ), [ & ]( const cv::Range& range ) {
+            for ( int32_t strip = range.start; strip < range.end; strip++ )
+            {
+                const int32_t x0 = strip * COLUMN_STRIP_WIDTH;
+                const int32_t x1 = std::min( cols, x0 + COLUMN_STRIP_WIDTH );
+
+                // All rows of the strip are read into g and h before any output
+                // is written, so src and dst may be the same image
+                for ( int32_t b = 0; b < length; b += k )
+                {
+                    std::copy( paddedRow( b ) + x0,
+                               paddedRow( b ) + x1,
+                               g.ptr< uchar >( b ) + x0 );
+                    for ( int32_t j = b + 1; j < b + k; j++ )
+                    {
+                        const auto* p = paddedRow( j );
+                        const auto* gPrev = g.ptr< uchar >( j - 1 );
+                        auto* gRow = g.ptr< uchar >( j );
+                        for ( int32_t x = x0; x < x1; x++ )
+                        {
+                            gRow[ x ] = Op::apply( gPrev[ x ], p[ x ] );
+                        }
+                    }
+
+                    std::copy( paddedRow( b + k - 1 ) + x0,
+                               paddedRow( b + k - 1 ) + x1,
+                               h.ptr< uchar >( b + k - 1 ) + x0 );
+                    for ( int32_t j = b + k - 2; j >= b; j-- )
+                    {
+                        const auto* p = paddedRow( j );
+                        const auto* hNext = h.ptr< uchar >( j + 1 );
+                        auto* hRow = h.ptr< uchar >( j );
+                        for ( int32_t x = x0; x < x1; x++ )
+                        {
+                            hRow[ x ] = Op::apply( hNext[ x ], p[ x ] );
+                        }
+                    }
+                }
+
+                for ( int32_t i = 0; i < n; i++ )
+                {
+                    const auto* hRow = h.ptr< uchar >( i );
+                    const auto* gRow = g.ptr< uchar >( i + k - 1 );
+                    auto* d = dst.ptr< uchar >( i );
+                    for ( int32_t x = x0; x < x1; x++ )
+                    {
+                        d[ x ] = Op::apply( hRow[ x ], gRow[ x ] );
+                    }
+                }
+            }
+        } );
+}
+
+template < typename Op >
+void morphRect( const cv::Mat& src, cv::Mat& dst, cv::Size ksize )
+{
+    CV_Assert( src.type( ) == CV_8UC1 );
+    CV_Assert( ksize.width > 0 && ksize.height > 0 );
+
+    dst.create( src.size( ), src.type( ) );
+
+    if ( ksize.width > 1 )
+    {
+        filterRows< Op >( src, dst, ksize.width );
+
+        if ( ksize.height > 1 )
+        {
+            filterCols< Op >( dst, dst, ksize.height );
+        }
+    }
+    else if ( ksize.height > 1 )
+    {
+        filterCols< Op >( src, dst, ksize.height );
+    }
+    else if ( dst.data != src.data )
+    {
+        src.copyTo( dst );
+    }
+}
+} // namespace
+
+void thresholdBinary( const cv::Mat& src, cv::Mat& dst, int32_t thresh,
+                      uchar maxValue )
+{
+    CV_Assert( src.type( ) == CV_8UC1 );
+
+    dst.create( src.size( ), CV_8UC1 );
+
+    if ( thresh >= 255 )
+    {
+        dst.setTo( 0 );
+        return;
+    }
+
+    if ( thresh < 0 )
+    {
+        dst.setTo( maxValue );
+        return;
+    }
+
+    const auto t = static_cast< uchar >( thresh );
+    const int32_t cols = src.cols;
+
+    cv::parallel_for_(
+        cv::Range( 0, src.rows ), [ & ]( const cv::Range& range ) {
+            for ( int32_t y = range.start; y < range.end; y++ )
+            {
+                const auto* s = src.ptr< uchar >( y );
+                auto* d = dst.ptr< uchar >( y );
+                int32_t x = 0;
+
+#if CV_SIMD
+                const cv::v_uint8 vThresh = cv::vx_setall_u8( t );
+                const cv::v_uint8 vMax = cv::vx_setall_u8( maxValue );
+                constexpr int32_t lanes = cv::v_uint8::nlanes;
+
+                for ( ; x <= cols - lanes; x += lanes )
+                {
+                    cv::v_store( d + x,
+                                 ( cv::vx_load( s + x ) > vThresh ) & vMax );
+                }
+#endif
+
+                for ( ; x < cols; x++ )
+                {
+                    d[ x ] = s[ x ] > t ? maxValue : 0;
+                }
+            }
+        } );
+}
+
+void dilateRect( const cv::Mat& src, cv::Mat& dst, cv::Size ksize )
+{
+    morphRect< MaxOp >( src, dst, ksize );
+}
+
+void erodeRect( const cv::Mat& src, cv::Mat& dst, cv::Size ksize )
+{
+    morphRect< MinOp >( src, dst, ksize );
+}
@@ -0,0 +1,248 @@
+#include <FeatureMatching.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/hal.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/features2d.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+struct BestTwo
+{
+    int32_t bestIdx = -1;
+    uint32_t best = std::numeric_limits< uint32_t >::max( );
+    uint32_t second = std::numeric_limits< uint32_t >::max( );
+};
+
+// Best and second best train descriptor for every query descriptor
+std::vector< BestTwo > findBestTwoBinary( const cv::Mat& query,
+                                          const cv::Mat& train )
+{
+    std::vector< BestTwo > result( static_cast< size_t >( query.rows ) );
+    const int32_t length = query.cols;
+
+    cv::parallel_for_(
+        cv::Range( 0, query.rows ), [ & ]( const cv::Range& range ) {
+            for ( int32_t q = range.start; q < range.end; q++ )
+            {
+                const auto* queryDesc = query.ptr< uchar >( q );
+                auto& res = result[ static_cast< size_t >( q ) ];
+
+                for ( int32_t t = 0; t < train.rows; t++ )
+                {
+                    const uint32_t distance = hammingDistance(
+                        queryDesc, train.ptr< uchar >( t ), length );
+
+                    if ( distance < res.best )
+                    {
+                        res.second = res.best;
+                        res.best = distance;
+                        res.bestIdx = t;
+                    }
+                    else if ( distance < res.second )
+                    {
+                        res.second = distance;
+                    }
+                }
+            }
+        } );
+
+    return result;
+}
+
+std::vector< cv::DMatch > matchBinary( const cv::Mat& query,
+                                       const cv::Mat& train,
+                                       const FeatureMatchingParams& params )
+{
+    const auto forward = findBestTwoBinary( query, train );
+
+    std::vector< BestTwo > backward;
+    if ( params.crossCheck )
+    {
+        backward = findBestTwoBinary( train, query );
+    }
+
+    std::vector< cv::DMatch > matches;
+    matches.reserve( forward.size( ) );
+
+    for ( size_t q = 0; q < forward.size( ); q++ )
+    {
+        const auto& candidate = forward[ q ];
+
+        if ( candidate.bestIdx < 0 )
+        {
+            continue;
+        }
+
+        if ( params.ratio > 0.0f &&
+             static_cast< double >( candidate.best ) >=
+                 static_cast< double >( params.ratio ) * candidate.second )
+        {
+            continue;
+        }
+
+        if ( params.crossCheck &&
+             backward[ static_cast< size_t >( candidate.bestIdx ) ].bestIdx !=
+                 static_cast< int32_t >( q ) )
+        {
+            continue;
+        }
+
+        matches.emplace_back( static_cast< int32_t >( q ),
+                              candidate.bestIdx,
+                              static_cast< float >( candidate.best ) );
+    }
+
+    return matches;
+}
+
+std::vector< cv::DMatch > matchFloat( const cv::Mat& query,
+                                      const cv::Mat& train,
+                                      const FeatureMatchingParams& params )
+{
+    cv::BFMatcher matcher( cv::NORM_L2 );
+
+    std::vector< cv::DMatch > matches;
+
+    if ( params.ratio > 0.0f )
+    {
+        std::vector< std::vector< cv::DMatch > > knnMatches;
+        matcher.knnMatch( query, train, knnMatches, 2 );
+
+        matches.reserve( knnMatches.size( ) );
+        for ( const auto& knn : knnMatches )
+        {
+            if ( knn.size( ) == 1 ||
+                 ( knn.size( ) == 2 &&
+                   knn[ 0 ].distance < params.ratio * knn[ 1 ].distance ) )
+            {
+                matches.push_back( knn[ 0 ] );
+            }
+        }
+    }
+    else
+    {
+        matcher.match( query, train, matches );
+    }
+
+    if ( params.crossCheck )
+    {
+        std::vector< cv::DMatch > backward;
+        matcher.match( train, query, backward );
+
+        std::erase_if( matches, [ & ]( const cv::DMatch& match ) {
+            return backward[ static_cast< size_t >( match.trainIdx ) ]
+                       .trainIdx != match.queryIdx;
+        } );
+    }
+
+    return matches;
+}
+} // namespace
+
+uint32_t hammingDistance( const uchar* a, const uchar* b, int32_t length )
+{
+    if ( length % 8 != 0 )
+    {
+        return static_cast< uint32_t >( cv::hal::normHamming( a, b, length ) );
+    }
+
+    uint32_t distance = 0;
+    for ( int32_t i = 0; i < length; i += 8 )
+    {
+        uint64_t wordA;
+        uint64_t wordB;
+        std::memcpy( &wordA, a + i, sizeof( wordA ) );
+        std::memcpy( &wordB, b + i, sizeof( wordB ) );
+
+        distance += static_cast< uint32_t >( std::popcount( wordA ^ wordB ) );
+    }
+
+    return distance;
+}
+
+std::vector< cv::DMatch >
+matchDescriptors( const cv::Mat& queryDescriptors,
+                  const cv::Mat& trainDescriptors,
+                  const FeatureMatchingParams& params /*= { }*/ )
+{
+    if ( queryDescriptors.empty( ) || trainDescriptors.empty( ) )
+    {
+        return { };
+    }
+
+    CV_Assert( queryDescriptors.type( ) == trainDescriptors.type( ) );
+    CV_Assert( queryDescriptors.cols == trainDescriptors.cols );
+
+    auto matches =
+        queryDescriptors.depth( ) == CV_8U
+            ? matchBinary( queryDescriptors, trainDescriptors, params )
+            : matchFloat( queryDescriptors, trainDescriptors, params );
+
+    keepBestMatches( matches, params.goodMatchPercent );
+
+    return matches;
+}
+
+void keepBestMatches( std::vector< cv::DMatch >& matches, float fraction )
+{
+    if ( fraction <= 0.0f || fraction >= 1.0f )
+    {
+        return;
+    }
+
+    const auto numGoodMatches = static_cast< size_t >(
+        static_cast< float >( matches.size( ) ) * fraction );
+
+    const auto last = matches.begin( ) +
+                      static_cast< std::ptrdiff_t >( numGoodMatches );
+
+    std::nth_element( matches.begin( ), last, matches.end( ) );
+    matches.erase( last, matches.end( ) );
+}
+
+void extractMatchedPoints( const std::vector< cv::KeyPoint >& queryKeypoints,
+                           const std::vector< cv::KeyPoint >& trainKeypoints,
+                           const std::vector< cv::DMatch >& matches,
+                           std::vector< cv::Point2f >& queryPoints,
+                           std::vector< cv::Point2f >& trainPoints )
+{
+    queryPoints.resize( matches.size( ) );
+    trainPoints.resize( matches.size( ) );
+
+    for ( size_t i = 0; i < matches.size( ); i++ )
+    {
+        queryPoints[ i ] =
+            queryKeypoints[ static_cast< size_t >( matches[ i ].queryIdx ) ].pt;
+        trainPoints[ i ] =
+            trainKeypoints[ static_cast< size_t >( matches[ i ].trainIdx ) ].pt;
+    }
+}
+
+FeatureMatches matchFeatures( const std::vector< cv::KeyPoint >& queryKeypoints,
+                              const cv::Mat& queryDescriptors,
+                              const std::vector< cv::KeyPoint >& trainKeypoints,
+                              const cv::Mat& trainDescriptors,
+                              const FeatureMatchingParams& params /*= { }*/ )
+{
+    FeatureMatches result;
+    result.matches =
+        matchDescriptors( queryDescriptors, trainDescriptors, params );
+
+    extractMatchedPoints( queryKeypoints,
+                          trainKeypoints,
+                          result.matches,
+                          result.queryPoints,
+                          result.trainPoints );
+
+    return result;
+}
@@ -0,0 +1,201 @@
+#include <FeatureTracking.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+// Pixel range [ begin, end ) of grid cell index along a side of length size
+std::pair< int32_t, int32_t > cellRange( int32_t index, int32_t cells,
+                                         int32_t size )
+{
+    return { index * size / cells, ( index + 1 ) * size / cells };
+}
+} // namespace
+
+KltTracker::KltTracker( const KltTrackerParams& _params /*= { }*/ )
+    : params( _params )
+{
+    CV_Assert( params.maxFeatures > 0 );
+    CV_Assert( params.gridSize.width > 0 && params.gridSize.height > 0 );
+}
+
+void KltTracker::update( const cv::Mat& gray )
+{
+    CV_Assert( gray.type( ) == CV_8UC1 );
+
+    // The pyramid of the last frame becomes the previous one, its buffers are
+    // reused for the new frame
+    std::swap( pyramid, previousPyramid );
+    const int32_t levels = cv::buildOpticalFlowPyramid(
+        gray, pyramid, params.winSize, params.maxLevel );
+
+    previousPoints.clear( );
+    trackedPoints.clear( );
+
+    const bool canTrack = pyramidLevels > 0 && ! previousPyramid.empty( ) &&
+                          previousPyramid.front( ).size( ) == gray.size( );
+    pyramidLevels = levels;
+
+    if ( canTrack && ! points.empty( ) )
+    {
+        track( );
+    }
+    else
+    {
+        points.clear( );
+        ids.clear( );
+    }
+
+    replenish( gray );
+}
+
+void KltTracker::reset( )
+{
+    pyramidLevels = 0;
+    points.clear( );
+    ids.clear( );
+    previousPoints.clear( );
+    trackedPoints.clear( );
+}
+
+void KltTracker::track( )
+{
+    cv::calcOpticalFlowPyrLK( previousPyramid,
+                              pyramid,
+                              points,
+                              lkPoints,
+                              lkStatus,
+                              lkError,
+                              params.winSize,
+                              pyramidLevels,
+                              params.criteria );
+
+    const cv::Size size = pyramid.front( ).size( );
+    const cv::Rect2f bounds( 0.0f,
+                             0.0f,
+                             static_cast< float >( size.width ),
+                             static_cast< float >( size.height ) );
+
+    size_t kept = 0;
+    for ( size_t i = 0; i < points.size( ); i++ )
+    {
+        if ( lkStatus[ i ] == 0 || ! bounds.contains( lkPoints[ i ] ) )
+        {
+            continue;
+        }
+
+        previousPoints.push_back( points[ i ] );
+        trackedPoints.push_back( lkPoints[ i ] );
+        ids[ kept++ ] = ids[ i ];
+    }
+
+    points.assign( trackedPoints.begin( ), trackedPoints.end( ) );
+    ids.resize( kept );
+}
+
+void KltTracker::replenish( const cv::Mat& gray )
+{
+    const auto maxFeatures = static_cast< size_t >( params.maxFeatures );
+    if ( points.size( ) >= maxFeatures )
+    {
+        return;
+    }
+
+    const int32_t gridCols = params.gridSize.width;
+    const int32_t gridRows = params.gridSize.height;
+    const int32_t numCells = gridCols * gridRows;
+
+    const auto cellOf = [ & ]( const cv::Point2f& point ) {
+        const int32_t cx = std::min(
+            static_cast< int32_t >( point.x * gridCols / gray.cols ),
+            gridCols - 1 );
+        const int32_t cy = std::min(
+            static_cast< int32_t >( point.y * gridRows / gray.rows ),
+            gridRows - 1 );
+        return static_cast< size_t >( cy * gridCols + cx );
+    };
+
+    cellCounts.assign( static_cast< size_t >( numCells ), 0 );
+    for ( const auto& point : points )
+    {
+        cellCounts[ cellOf( point ) ]++;
+    }
+
+    //
+    // Mask of the empty cells. Detection only runs on their bounding box, so
+    // a well covered frame costs next to nothing.
+    //
+    mask.create( gray.size( ), CV_8UC1 );
+    mask.setTo( 0 );
+
+    cv::Rect searchArea;
+    int32_t emptyCells = 0;
+
+    for ( int32_t cy = 0; cy < gridRows; cy++ )
+    {
+        const auto [ y0, y1 ] = cellRange( cy, gridRows, gray.rows );
+
+        for ( int32_t cx = 0; cx < gridCols; cx++ )
+        {
+            if ( cellCounts[ static_cast< size_t >( cy * gridCols + cx ) ] > 0 )
+            {
+                continue;
+            }
+
+            const auto [ x0, x1 ] = cellRange( cx, gridCols, gray.cols );
+            const cv::Rect cell( x0, y0, x1 - x0, y1 - y0 );
+
+            mask( cell ).setTo( 255 );
+            searchArea = emptyCells == 0 ? cell : ( searchArea | cell );
+            emptyCells++;
+        }
+    }
+
+    if ( emptyCells == 0 || searchArea.empty( ) )
+    {
+        return;
+    }
+
+    const int32_t perCell = std::max(
+        1, ( params.maxFeatures + numCells - 1 ) / numCells );
+
+    cv::goodFeaturesToTrack( gray( searchArea ),
+                             corners,
+                             emptyCells * perCell,
+                             params.qualityLevel,
+                             params.minDistance,
+                             mask( searchArea ),
+                             params.blockSize );
+
+    // Corners come sorted by strength, keep the best ones of every cell
+    const cv::Point2f offset( searchArea.tl( ) );
+
+    for ( const auto& corner : corners )
+    {
+        const cv::Point2f point = corner + offset;
+        int32_t& count = cellCounts[ cellOf( point ) ];
+
+        if ( count >= perCell )
+        {
+            continue;
+        }
+
+        count++;
+        points.push_back( point );
+        ids.push_back( nextId++ );
+
+        if ( points.size( ) >= maxFeatures )
+        {
+            break;
+        }
+    }
+}
@@ -0,0 +1,203 @@
+#include <FrameSink.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+FrameSink::FrameSink( const std::string& _fileName, int32_t _fourcc,
+                      double _fps, cv::Size _frameSize,
+                      bool _isColor /*= true*/,
+                      const FrameSinkParams& _params /*= { }*/ )
+    : fileName( _fileName )
+    , fourcc( _fourcc )
+    , fps( _fps )
+    , frameSize( _frameSize )
+    , isColor( _isColor )
+    , params( _params )
+{
+    CV_Assert( params.queueSize > 0 );
+    CV_Assert( params.segmentLength >= 0 );
+    CV_Assert( params.numWriters == 1 ||
+               ( params.numWriters > 1 && params.segmentLength > 0 ) );
+
+    for ( int32_t i = 0; i < params.numWriters; i++ )
+    {
+        writers.push_back( std::make_unique< Writer >( ) );
+    }
+
+    // The first file is opened here to report errors through isOpened( ),
+    // the writer thread takes it over
+    Writer& first = *writers.front( );
+    opened = first.videoWriter.open(
+        segmentFileName( 0 ), fourcc, fps, frameSize, isColor );
+    first.segment = 0;
+
+    for ( auto& writer : writers )
+    {
+        writer->thread =
+            std::thread( &FrameSink::run, this, std::ref( *writer ) );
+    }
+}
+
+FrameSink::~FrameSink( )
+{
+    close( );
+}
+
+void FrameSink::write( const cv::Mat& frame )
+{
+    std::unique_lock< std::mutex > lock( mutex );
+
+    if ( closing )
+    {
+        return;
+    }
+
+    const int64_t segment =
+        params.segmentLength > 0 ? frameIndex / params.segmentLength : 0;
+    frameIndex++;
+
+    Writer& writer = *writers[ static_cast< size_t >(
+        segment % static_cast< int64_t >( writers.size( ) ) ) ];
+
+    const auto queueSize = static_cast< size_t >( params.queueSize );
+    changed.wait( lock, [ & ] { return writer.queue.size( ) < queueSize; } );
+
+    cv::Mat buffer;
+    if ( ! pool.empty( ) )
+    {
+        buffer = std::move( pool.back( ) );
+        pool.pop_back( );
+    }
+
+    // The copy doesn't need the lock, the writers keep going meanwhile
+    lock.unlock( );
+    frame.copyTo( buffer );
+    lock.lock( );
+
+    writer.queue.push_back( { std::move( buffer ), segment } );
+    changed.notify_all( );
+}
+
+void FrameSink::flush( )
+{
+    std::unique_lock< std::mutex > lock( mutex );
+
+    changed.wait( lock, [ this ] {
+        for ( const auto& writer : writers )
+        {
+            if ( ! writer->queue.empty( ) || writer->busy )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    } );
+}
+
+void FrameSink::close( )
+{
+    {
+        const std::lock_guard< std::mutex > lock( mutex );
+        if ( closed )
+        {
+            return;
+        }
+
+        // Writers drain their queues before they stop
+        closing = true;
+        closed = true;
+    }
+
+    changed.notify_all( );
+
+    for ( auto& writer : writers )
+    {
+        writer->thread.join( );
+    }
+}
+
+int64_t FrameSink::getWrittenFrames( ) const
+{
+    const std::lock_guard< std::mutex > lock( mutex );
+    return writtenFrames;
+}
+
+std::string FrameSink::segmentFileName( int64_t segment ) const
+{
+    if ( params.segmentLength == 0 )
+    {
+        return fileName;
+    }
+
+    const std::filesystem::path path( fileName );
+
+    std::ostringstream name;
+    name << path.stem( ).string( ) << "_" << std::setw( 4 )
+         << std::setfill( '0' ) << segment << path.extension( ).string( );
+
+    return ( path.parent_path( ) / name.str( ) ).string( );
+}
+
+void FrameSink::run( Writer& writer )
+{
+    // Buffers kept for reuse, a few more than one queue holds
+    const auto poolSize = static_cast< size_t >( params.queueSize ) + 2;
+
+    std::unique_lock< std::mutex > lock( mutex );
+
+    while ( true )
+    {
+        changed.wait(
+            lock, [ & ] { return closing || ! writer.queue.empty( ); } );
+
+        if ( writer.queue.empty( ) )
+        {
+            break;
+        }
+
+        Pending pending = std::move( writer.queue.front( ) );
+        writer.queue.pop_front( );
+        writer.busy = true;
+
+        // A free queue slot may unblock write( )
+        changed.notify_all( );
+        lock.unlock( );
+
+        if ( pending.segment != writer.segment )
+        {
+            writer.videoWriter.open( segmentFileName( pending.segment ),
+                                     fourcc,
+                                     fps,
+                                     frameSize,
+                                     isColor );
+            writer.segment = pending.segment;
+        }
+
+        writer.videoWriter.write( pending.frame );
+
+        lock.lock( );
+        writer.busy = false;
+        writtenFrames++;
+
+        if ( pool.size( ) < poolSize )
+        {
+            pool.push_back( std::move( pending.frame ) );
+        }
+
+        changed.notify_all( );
+    }
+
+    lock.unlock( );
+    writer.videoWriter.release( );
+}
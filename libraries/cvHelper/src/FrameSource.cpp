@@ -0,0 +1,194 @@
+#include <FrameSource.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <utility>
+
+namespace
+{
+// True if the pixel data is referenced by another cv::Mat than this one
+bool isShared( const cv::Mat& frame )
+{
+    return frame.u != nullptr && frame.u->refcount > 1;
+}
+} // namespace
+
+FrameSource::FrameSource( const std::string& fileName,
+                          const FrameSourceParams& _params /*= { }*/ )
+    : params( _params )
+    , capture( fileName )
+{
+    start( );
+}
+
+FrameSource::FrameSource( int32_t cameraIndex,
+                          const FrameSourceParams& _params /*= { }*/ )
+    : params( _params )
+    , capture( cameraIndex )
+{
+    start( );
+}
+
+FrameSource::~FrameSource( )
+{
+    {
+        const std::lock_guard< std::mutex > lock( mutex );
+        stop = true;
+    }
+
+    slotFree.notify_all( );
+
+    if ( thread.joinable( ) )
+    {
+        thread.join( );
+    }
+}
+
+void FrameSource::start( )
+{
+    CV_Assert( params.queueSize > 0 );
+
+    opened = capture.isOpened( );
+    if ( ! opened )
+    {
+        finished = true;
+        return;
+    }
+
+    // VideoCapture isn't thread safe, so the properties are read before the
+    // decode thread owns it
+    fps = capture.get( cv::CAP_PROP_FPS );
+    frameSize = cv::Size(
+        static_cast< int32_t >( capture.get( cv::CAP_PROP_FRAME_WIDTH ) ),
+        static_cast< int32_t >( capture.get( cv::CAP_PROP_FRAME_HEIGHT ) ) );
+
+    const auto count =
+        static_cast< int64_t >( capture.get( cv::CAP_PROP_FRAME_COUNT ) );
+    frameCount = count > 0 ? count : -1;
+
+    thread = std::thread( &FrameSource::run, this );
+}
+
+bool FrameSource::read( cv::Mat& frame )
+{
+    std::unique_lock< std::mutex > lock( mutex );
+
+    frameReady.wait( lock, [ this ] { return ! queue.empty( ) || finished; } );
+
+    if ( queue.empty( ) )
+    {
+        return false;
+    }
+
+    // Hand the previous buffer of the caller back to the pool. The pool holds
+    // a reference only; if the caller keeps another one, the decoder sees it
+    // and won't write into that buffer.
+    const auto poolSize = static_cast< size_t >( params.queueSize ) + 2;
+    if ( ! frame.empty( ) && pool.size( ) < poolSize )
+    {
+        pool.push_back( frame );
+    }
+
+    frame = std::move( queue.front( ) );
+    queue.pop_front( );
+
+    lock.unlock( );
+    slotFree.notify_one( );
+
+    return true;
+}
+
+int64_t FrameSource::getDroppedFrames( ) const
+{
+    const std::lock_guard< std::mutex > lock( mutex );
+    return droppedFrames;
+}
+
+void FrameSource::run( )
+{
+    const auto queueSize = static_cast< size_t >( params.queueSize );
+
+    while ( true )
+    {
+        cv::Mat frame;
+
+        {
+            std::unique_lock< std::mutex > lock( mutex );
+
+            if ( params.dropPolicy == FrameDropPolicy::Block )
+            {
+                slotFree.wait( lock, [ & ] {
+                    return stop || queue.size( ) < queueSize;
+                } );
+            }
+
+            if ( stop )
+            {
+                break;
+            }
+
+            // Take a recycled buffer that nobody else references
+            while ( ! pool.empty( ) )
+            {
+                frame = std::move( pool.back( ) );
+                pool.pop_back( );
+
+                if ( ! isShared( frame ) )
+                {
+                    break;
+                }
+
+                frame.release( );
+            }
+        }
+
+        // Decoding runs unlocked, that's the part overlapping with the
+        // consumer
+        if ( ! capture.read( frame ) )
+        {
+            const bool restarted =
+                params.loop && capture.set( cv::CAP_PROP_POS_FRAMES, 0.0 ) &&
+                capture.read( frame );
+
+            if ( ! restarted )
+            {
+                break;
+            }
+        }
+
+        {
+            const std::lock_guard< std::mutex > lock( mutex );
+
+            if ( queue.size( ) >= queueSize )
+            {
+                droppedFrames++;
+
+                if ( params.dropPolicy == FrameDropPolicy::DropNewest )
+                {
+                    pool.push_back( std::move( frame ) );
+                    continue;
+                }
+
+                pool.push_back( std::move( queue.front( ) ) );
+                queue.pop_front( );
+            }
+
+            queue.push_back( std::move( frame ) );
+        }
+
+        frameReady.notify_one( );
+    }
+
+    {
+        const std::lock_guard< std::mutex > lock( mutex );
+        finished = true;
+    }
+
+    frameReady.notify_all( );
+    capture.release( );
+}
@@ -7,17 +7,388 @@ IGNORE_WARNINGS_OPENCV_PUSH
 #include <opencv2/opencv.hpp>
 IGNORE_WARNINGS_POP
 
-void showMat( const cv::Mat& imageIn, const std::string& szName,
-              bool bWait /*= false*/, double scale /*= 1*/,
-              int32_t waitTime/* = 25 */)
+// STD includes
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+namespace
+{
+// Plot canvas height and width of the legend next to the data
+constexpr int32_t PLOT_HEIGHT = 256;
+constexpr int32_t PLOT_LEGEND_WIDTH = 256;
+
+std::mutex displaySinkMutex;
+std::shared_ptr< DisplaySink > displaySink;
+
+std::mutex plotCanvasMutex;
+std::map< std::string, cv::Mat > plotCanvases;
+
+std::string formatValue( double value )
+{
+    std::ostringstream text;
+    text << value;
+    return text.str( );
+}
+
+std::string getEnvironment( const char* name )
+{
+#pragma warning( suppress : 4996 )
+    const char* value = std::getenv( name );
+
+    return value != nullptr ? value : "";
+}
+
+// Window titles may contain anything, file names may not
+std::string toFileName( const std::string& name )
+{
+    std::string fileName = name;
+    for ( char& c : fileName )
+    {
+        if ( ! std::isalnum( static_cast< unsigned char >( c ) ) && c != '-' &&
+             c != '_' )
+        {
+            c = '_';
+        }
+    }
+
+    return fileName.empty( ) ? "image" : fileName;
+}
+} // namespace
+
+void WindowDisplaySink::show( const cv::Mat& image, const std::string& name,
+                              bool wait, double scale, int32_t waitTime )
+{
+    cv::namedWindow( name, cv::WINDOW_NORMAL );
+
+    cv::imshow( name, image );
+
+    cv::resizeWindow( name,
+                      static_cast< int >( image.cols * scale ),
+                      static_cast< int >( image.rows * scale ) );
+
+    cv::waitKey( wait ? 0 : waitTime );
+}
+
+void WindowDisplaySink::poll( )
+{
+    cv::pollKey( );
+}
+
+void WindowDisplaySink::close( )
+{
+    cv::destroyAllWindows( );
+}
+
+FileDisplaySink::FileDisplaySink( const std::string& _directory )
+    : directory( _directory.empty( ) ? "." : _directory )
+{
+    std::error_code error;
+    std::filesystem::create_directories( directory, error );
+}
+
+void FileDisplaySink::show( const cv::Mat& image, const std::string& name,
+                            bool, double, int32_t )
+{
+    const std::string fileName = toFileName( name );
+
+    int32_t index = 0;
+    {
+        const std::lock_guard< std::mutex > lock( mutex );
+        index = counters[ fileName ]++;
+    }
+
+    std::ostringstream path;
+    path << directory << "/" << fileName << "_" << std::setw( 4 )
+         << std::setfill( '0' ) << index << ".png";
+
+    cv::imwrite( path.str( ), image );
+}
+
+void CaptureDisplaySink::show( const cv::Mat& image, const std::string& name,
+                               bool, double, int32_t )
+{
+    Frame frame { name, image.clone( ) };
+
+    const std::lock_guard< std::mutex > lock( mutex );
+    frames.push_back( std::move( frame ) );
+}
+
+std::vector< CaptureDisplaySink::Frame > CaptureDisplaySink::takeFrames( )
+{
+    const std::lock_guard< std::mutex > lock( mutex );
+    return std::exchange( frames, { } );
+}
+
+AsyncDisplaySink::AsyncDisplaySink(
+    std::shared_ptr< DisplaySink > _target
+    /*= std::make_shared< WindowDisplaySink >( )*/,
+    double refreshRate /*= 30.0*/ )
+    : target( std::move( _target ) )
+{
+    CV_Assert( target != nullptr );
+    CV_Assert( refreshRate > 0.0 );
+
+    using Duration = std::chrono::steady_clock::duration;
+    interval = std::chrono::duration_cast< Duration >(
+        std::chrono::duration< double >( 1.0 / refreshRate ) );
+
+    thread = std::thread( &AsyncDisplaySink::run, this );
+}
+
+AsyncDisplaySink::~AsyncDisplaySink( )
+{
+    {
+        const std::lock_guard< std::mutex > lock( mutex );
+        stop = true;
+    }
+
+    wakeUp.notify_all( );
+    shown.notify_all( );
+    thread.join( );
+}
+
+void AsyncDisplaySink::show( const cv::Mat& image, const std::string& name,
+                             bool wait, double scale, int32_t )
+{
+    std::unique_lock< std::mutex > lock( mutex );
+
+    Mailbox& mailbox = mailboxes[ name ];
+    if ( mailbox.pending )
+    {
+        droppedFrames++;
+    }
+
+    // Reuses the buffer the display thread handed back, so no allocation
+    // once the image size is stable
+    image.copyTo( mailbox.image );
+    mailbox.scale = scale;
+    mailbox.pending = true;
+    mailbox.serial++;
+
+    if ( ! wait )
+    {
+        return;
+    }
+
+    if ( ! mailbox.wait )
+    {
+        mailbox.wait = true;
+        pendingWaits++;
+    }
+
+    const uint64_t serial = mailbox.serial;
+    wakeUp.notify_one( );
+    shown.wait( lock, [ & ] { return stop || mailbox.shownSerial >= serial; } );
+}
+
+int64_t AsyncDisplaySink::getDroppedFrames( ) const
+{
+    const std::lock_guard< std::mutex > lock( mutex );
+    return droppedFrames;
+}
+
+void AsyncDisplaySink::run( )
 {
-    cv::namedWindow( szName, cv::WINDOW_NORMAL );
+    using Clock = std::chrono::steady_clock;
+
+    struct Update
+    {
+        const std::string* name;
+        const cv::Mat* image;
+        double scale;
+        bool wait;
+        uint64_t serial;
+    };
+
+    // Images owned by this thread. They are swapped with the mailboxes, so
+    // the producers get the previous buffer back.
+    std::map< std::string, cv::Mat > displayed;
+    std::vector< Update > updates;
+    auto nextRefresh = Clock::now( );
+
+    while ( true )
+    {
+        updates.clear( );
+
+        {
+            std::unique_lock< std::mutex > lock( mutex );
+            wakeUp.wait_until( lock, nextRefresh, [ this ] {
+                return stop || pendingWaits > 0;
+            } );
+
+            if ( stop )
+            {
+                break;
+            }
+
+            for ( auto& [ name, mailbox ] : mailboxes )
+            {
+                if ( ! mailbox.pending )
+                {
+                    continue;
+                }
+
+                cv::Mat& image = displayed[ name ];
+                std::swap( image, mailbox.image );
+                updates.push_back( { &name,
+                                     &image,
+                                     mailbox.scale,
+                                     mailbox.wait,
+                                     mailbox.serial } );
+
+                mailbox.pending = false;
+                if ( mailbox.wait )
+                {
+                    mailbox.wait = false;
+                    pendingWaits--;
+                }
+            }
+        }
+
+        // Map nodes are stable, so names and images stay valid unlocked
+        for ( const auto& update : updates )
+        {
+            target->show(
+                *update.image, *update.name, update.wait, update.scale, 1 );
+        }
+
+        if ( updates.empty( ) )
+        {
+            target->poll( );
+        }
+        else
+        {
+            {
+                const std::lock_guard< std::mutex > lock( mutex );
+                for ( const auto& update : updates )
+                {
+                    mailboxes[ *update.name ].shownSerial = update.serial;
+                }
+            }
+
+            shown.notify_all( );
+        }
+
+        // Skip refreshes that were missed instead of catching up
+        const auto now = Clock::now( );
+        nextRefresh += interval;
+        if ( nextRefresh < now )
+        {
+            nextRefresh = now + interval;
+        }
+    }
+
+    target->close( );
+}
+
+std::shared_ptr< DisplaySink > createDisplaySinkFromEnvironment( )
+{
+    const std::string mode = getEnvironment( "CVHELPER_DISPLAY" );
+
+    if ( mode == "file" )
+    {
+        return std::make_shared< FileDisplaySink >(
+            getEnvironment( "CVHELPER_DISPLAY_DIR" ) );
+    }
 
-    cv::imshow( szName, imageIn );
+    if ( mode == "none" )
+    {
+        return std::make_shared< NullDisplaySink >( );
+    }
 
-    cv::resizeWindow( szName,
-                      static_cast< int >( imageIn.cols * scale ),
-                      static_cast< int >( imageIn.rows * scale ) );
+    if ( mode == "capture" )
+    {
+        return std::make_shared< CaptureDisplaySink >( );
+    }
 
-    cv::waitKey( bWait ? 0 : waitTime );
-}
\ No newline at end of file
+    if ( mode == "async" )
+    {
+        const std::string fps = getEnvironment( "CVHELPER_DISPLAY_FPS" );
+        const double refreshRate =
+            fps.empty( ) ? 0.0 : std::atof( fps.c_str( ) );
+
+        return std::make_shared< AsyncDisplaySink >(
+            std::make_shared< WindowDisplaySink >( ),
+            refreshRate > 0.0 ? refreshRate : 30.0 );
+    }
+
+    return std::make_shared< WindowDisplaySink >( );
+}
+
+std::shared_ptr< DisplaySink > getDisplaySink( )
+{
+    const std::lock_guard< std::mutex > lock( displaySinkMutex );
+
+    if ( ! displaySink )
+    {
+        displaySink = createDisplaySinkFromEnvironment( );
+    }
+
+    return displaySink;
+}
+
+void setDisplaySink( std::shared_ptr< DisplaySink > sink )
+{
+    {
+        const std::lock_guard< std::mutex > lock( displaySinkMutex );
+        std::swap( displaySink, sink );
+    }
+
+    // The previous sink is released unlocked, an AsyncDisplaySink joins its
+    // thread on destruction
+}
+
+cv::Mat& getPlotCanvas( const std::string& szName, int32_t dataWidth )
+{
+    cv::Mat* canvas = nullptr;
+    {
+        const std::lock_guard< std::mutex > lock( plotCanvasMutex );
+        canvas = &plotCanvases[ szName ];
+    }
+
+    canvas->create( PLOT_HEIGHT, dataWidth + PLOT_LEGEND_WIDTH, CV_8UC3 );
+    canvas->setTo( cv::Scalar::all( 0 ) );
+
+    return *canvas;
+}
+
+void drawPlotLegend( cv::Mat& canvas, int32_t dataWidth, double minVal,
+                     double maxVal )
+{
+    const double range = maxVal - minVal;
+    const double c2 = range > 0.0 ? canvas.rows / range : 0.0;
+
+    const auto yValueZero =
+        canvas.rows - static_cast< int32_t >( std::round( -minVal * c2 ) );
+    cv::line( canvas,
+              cv::Point( 0, yValueZero ),
+              cv::Point( dataWidth, yValueZero ),
+              cv::Scalar( 255, 255, 255 ) );
+
+    cv::putText( canvas,
+                 "Max: " + formatValue( maxVal ),
+                 { dataWidth, 15 },
+                 cv::FONT_HERSHEY_PLAIN,
+                 1,
+                 cv::Scalar( 0, 255, 0 ) );
+
+    cv::putText( canvas,
+                 "Min: " + formatValue( minVal ),
+                 { dataWidth, 30 },
+                 cv::FONT_HERSHEY_PLAIN,
+                 1,
+                 cv::Scalar( 0, 255, 0 ) );
+}
+
+void showMat( const cv::Mat& imageIn, const std::string& szName,
+              bool bWait /*= false*/, double scale /*= 1*/,
+              int32_t waitTime /*= 25*/ )
+{
+    getDisplaySink( )->show( imageIn, szName, bWait, scale, waitTime );
+}
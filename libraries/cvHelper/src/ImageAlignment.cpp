@@ -0,0 +1,328 @@
+#include <FeatureMatching.h>
+#include <ImageAlignment.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/features2d.hpp>
+#include <opencv2/imgproc.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+// Below this number of guided matches the refinement is not trusted
+constexpr size_t MIN_REFINE_MATCHES = 12;
+
+cv::Mat toGray( const cv::Mat& image )
+{
+    cv::Mat gray;
+
+    if ( image.channels( ) == 3 )
+    {
+        cv::cvtColor( image, gray, cv::COLOR_BGR2GRAY );
+    }
+    else if ( image.channels( ) == 4 )
+    {
+        cv::cvtColor( image, gray, cv::COLOR_BGRA2GRAY );
+    }
+    else
+    {
+        gray = image;
+    }
+
+    return gray;
+}
+
+// Homography of the full resolution images from the one of the scaled images
+cv::Mat scaleHomography( const cv::Mat& h, double scale )
+{
+    cv::Mat s = cv::Mat::eye( 3, 3, CV_64F );
+    s.at< double >( 0, 0 ) = scale;
+    s.at< double >( 1, 1 ) = scale;
+
+    cv::Mat sInv = cv::Mat::eye( 3, 3, CV_64F );
+    sInv.at< double >( 0, 0 ) = 1.0 / scale;
+    sInv.at< double >( 1, 1 ) = 1.0 / scale;
+
+    return s * h * sInv;
+}
+
+// Mask of the part of an image of size imageSize that is covered by an image
+// of size otherSize, mapped with otherToImage
+cv::Mat overlapMask( cv::Size imageSize, cv::Size otherSize,
+                     const cv::Mat& otherToImage )
+{
+    const std::vector< cv::Point2f > corners {
+        { 0.0f, 0.0f },
+        { static_cast< float >( otherSize.width ), 0.0f },
+        { static_cast< float >( otherSize.width ),
+          static_cast< float >( otherSize.height ) },
+        { 0.0f, static_cast< float >( otherSize.height ) } };
+
+    std::vector< cv::Point2f > mapped;
+    cv::perspectiveTransform( corners, mapped, otherToImage );
+
+    std::vector< std::vector< cv::Point > > polygon( 1 );
+    for ( const auto& corner : mapped )
+    {
+        polygon[ 0 ].emplace_back( cvRound( corner.x ), cvRound( corner.y ) );
+    }
+
+    cv::Mat mask( imageSize, CV_8UC1, cv::Scalar::all( 0 ) );
+    cv::fillPoly( mask, polygon, cv::Scalar::all( 255 ) );
+
+    return mask;
+}
+
+// Match every query feature only against the train features within radius of
+// its position predicted by h. The train features are bucketed into a grid
+// of radius sized cells, so only the 3x3 neighboring cells are searched.
+std::vector< cv::DMatch >
+guidedMatch( const std::vector< cv::KeyPoint >& queryKeypoints,
+             const cv::Mat& queryDescriptors,
+             const std::vector< cv::KeyPoint >& trainKeypoints,
+             const cv::Mat& trainDescriptors, const cv::Mat& h, float radius,
+             float ratio )
+{
+    if ( queryKeypoints.empty( ) || trainKeypoints.empty( ) )
+    {
+        return { };
+    }
+
+    const float cellSize = std::max( radius, 1.0f );
+
+    float maxX = 0.0f;
+    float maxY = 0.0f;
+    for ( const auto& keypoint : trainKeypoints )
+    {
+        maxX = std::max( maxX, keypoint.pt.x );
+        maxY = std::max( maxY, keypoint.pt.y );
+    }
+
+    const auto gridCols = static_cast< int32_t >( maxX / cellSize ) + 1;
+    const auto gridRows = static_cast< int32_t >( maxY / cellSize ) + 1;
+
+    std::vector< std::vector< int32_t > > grid(
+        static_cast< size_t >( gridCols ) * static_cast< size_t >( gridRows ) );
+    for ( size_t i = 0; i < trainKeypoints.size( ); i++ )
+    {
+        const auto cx =
+            static_cast< size_t >( trainKeypoints[ i ].pt.x / cellSize );
+        const auto cy =
+            static_cast< size_t >( trainKeypoints[ i ].pt.y / cellSize );
+        grid[ cy * static_cast< size_t >( gridCols ) + cx ].push_back(
+            static_cast< int32_t >( i ) );
+    }
+
+    std::vector< cv::Point2f > queryPoints;
+    cv::KeyPoint::convert( queryKeypoints, queryPoints );
+
+    std::vector< cv::Point2f > predicted;
+    cv::perspectiveTransform( queryPoints, predicted, h );
+
+    const float radiusSq = radius * radius;
+    const int32_t length = queryDescriptors.cols;
+
+    std::vector< cv::DMatch > candidates( queryKeypoints.size( ) );
+
+    cv::parallel_for_(
+        cv::Range( 0, static_cast< int32_t >( queryKeypoints.size( ) ) ),
+        [ & ]( const cv::Range& range ) {
+            for ( int32_t q = range.start; q < range.end; q++ )
+            {
+                const auto& position = predicted[ static_cast< size_t >( q ) ];
+                const auto* queryDesc = queryDescriptors.ptr< uchar >( q );
+
+                // Points mapped to infinity or far outside the reference
+                // have no candidates, and their cell index would overflow
+                if ( ! std::isfinite( position.x ) ||
+                     ! std::isfinite( position.y ) || position.x < -radius ||
+                     position.y < -radius || position.x > maxX + radius ||
+                     position.y > maxY + radius )
+                {
+                    continue;
+                }
+
+                int32_t bestIdx = -1;
+                uint32_t best = std::numeric_limits< uint32_t >::max( );
+                uint32_t second = std::numeric_limits< uint32_t >::max( );
+
+                const auto cx = static_cast< int32_t >(
+                    std::floor( position.x / cellSize ) );
+                const auto cy = static_cast< int32_t >(
+                    std::floor( position.y / cellSize ) );
+
+                for ( int32_t y = std::max( cy - 1, 0 );
+                      y <= std::min( cy + 1, gridRows - 1 );
+                      y++ )
+                {
+                    for ( int32_t x = std::max( cx - 1, 0 );
+                          x <= std::min( cx + 1, gridCols - 1 );
+                          x++ )
+                    {
+                        const auto& cell =
+                            grid[ static_cast< size_t >( y * gridCols + x ) ];
+
+                        for ( const int32_t t : cell )
+                        {
+                            const auto& trainPt =
+                                trainKeypoints[ static_cast< size_t >( t ) ].pt;
+                            const cv::Point2f delta = trainPt - position;
+                            if ( delta.dot( delta ) > radiusSq )
+                            {
+                                continue;
+                            }
+
+                            const uint32_t distance = hammingDistance(
+                                queryDesc,
+                                trainDescriptors.ptr< uchar >( t ),
+                                length );
+
+                            if ( distance < best )
+                            {
+                                second = best;
+                                best = distance;
+                                bestIdx = t;
+                            }
+                            else if ( distance < second )
+                            {
+                                second = distance;
+                            }
+                        }
+                    }
+                }
+
+                if ( bestIdx >= 0 &&
+                     static_cast< double >( best ) <
+                         static_cast< double >( ratio ) * second )
+                {
+                    candidates[ static_cast< size_t >( q ) ] =
+                        cv::DMatch( q, bestIdx, static_cast< float >( best ) );
+                }
+            }
+        } );
+
+    // Default constructed matches have queryIdx -1
+    std::erase_if( candidates, []( const cv::DMatch& match ) {
+        return match.queryIdx < 0;
+    } );
+
+    return candidates;
+}
+} // namespace
+
+cv::Mat
+estimateHomographyPyramid( const cv::Mat& image, const cv::Mat& reference,
+                           const PyramidAlignmentParams& params /*= { }*/ )
+{
+    CV_Assert( ! image.empty( ) && ! reference.empty( ) );
+    CV_Assert( params.pyramidLevels >= 0 );
+
+    const cv::Mat imageGray = toGray( image );
+    const cv::Mat referenceGray = toGray( reference );
+
+    //
+    // Coarse estimate
+    //
+    cv::Mat imageCoarse = imageGray;
+    cv::Mat referenceCoarse = referenceGray;
+    for ( int32_t level = 0; level < params.pyramidLevels; level++ )
+    {
+        cv::pyrDown( imageCoarse, imageCoarse );
+        cv::pyrDown( referenceCoarse, referenceCoarse );
+    }
+
+    const double scale = std::ldexp( 1.0, params.pyramidLevels );
+
+    cv::Ptr< cv::ORB > orb = cv::ORB::create( params.coarseFeatures );
+
+    std::vector< cv::KeyPoint > imageKeypoints, referenceKeypoints;
+    cv::Mat imageDescriptors, referenceDescriptors;
+    orb->detectAndCompute(
+        imageCoarse, cv::noArray( ), imageKeypoints, imageDescriptors );
+    orb->detectAndCompute( referenceCoarse,
+                           cv::noArray( ),
+                           referenceKeypoints,
+                           referenceDescriptors );
+
+    FeatureMatchingParams matchingParams;
+    matchingParams.goodMatchPercent = params.goodMatchPercent;
+
+    const FeatureMatches coarseMatches = matchFeatures( imageKeypoints,
+                                                        imageDescriptors,
+                                                        referenceKeypoints,
+                                                        referenceDescriptors,
+                                                        matchingParams );
+
+    if ( coarseMatches.matches.size( ) < 4 )
+    {
+        return { };
+    }
+
+    const cv::Mat hCoarse =
+        cv::findHomography( coarseMatches.queryPoints,
+                            coarseMatches.trainPoints,
+                            cv::RANSAC,
+                            params.ransacThreshold / scale );
+    if ( hCoarse.empty( ) )
+    {
+        return { };
+    }
+
+    const cv::Mat h = scaleHomography( hCoarse, scale );
+
+    if ( params.fineFeatures <= 0 )
+    {
+        return h;
+    }
+
+    //
+    // Refinement at full resolution, restricted to the overlapping regions
+    //
+    orb->setMaxFeatures( params.fineFeatures );
+
+    const cv::Mat imageMask =
+        overlapMask( imageGray.size( ), referenceGray.size( ), h.inv( ) );
+    const cv::Mat referenceMask =
+        overlapMask( referenceGray.size( ), imageGray.size( ), h );
+
+    orb->detectAndCompute(
+        imageGray, imageMask, imageKeypoints, imageDescriptors );
+    orb->detectAndCompute( referenceGray,
+                           referenceMask,
+                           referenceKeypoints,
+                           referenceDescriptors );
+
+    const auto fineMatches = guidedMatch( imageKeypoints,
+                                          imageDescriptors,
+                                          referenceKeypoints,
+                                          referenceDescriptors,
+                                          h,
+                                          params.searchRadius,
+                                          params.ratio );
+
+    if ( fineMatches.size( ) < MIN_REFINE_MATCHES )
+    {
+        return h;
+    }
+
+    std::vector< cv::Point2f > imagePoints, referencePoints;
+    extractMatchedPoints( imageKeypoints,
+                          referenceKeypoints,
+                          fineMatches,
+                          imagePoints,
+                          referencePoints );
+
+    const cv::Mat hFine = cv::findHomography(
+        imagePoints, referencePoints, cv::RANSAC, params.ransacThreshold );
+
+    return hFine.empty( ) ? h : hFine;
+}
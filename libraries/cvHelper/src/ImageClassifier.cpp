@@ -0,0 +1,148 @@
+#include <ImageClassifier.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <numeric>
+
+std::vector< Classification > getTopK( const cv::Mat& scores, int32_t k,
+                                       bool applySoftmax /*= false*/ )
+{
+    CV_Assert( scores.type( ) == CV_32F && scores.isContinuous( ) );
+
+    const auto count = static_cast< int32_t >( scores.total( ) );
+    const float* score = scores.ptr< float >( );
+
+    k = std::clamp( k, 0, count );
+
+    //
+    // Softmax keeps the order, so the top k are found on the raw scores.
+    // Only their probabilities are needed, the rest only enters the sum.
+    //
+    std::vector< int32_t > indices( static_cast< size_t >( count ) );
+    std::iota( indices.begin( ), indices.end( ), 0 );
+
+    std::partial_sort( indices.begin( ),
+                       indices.begin( ) + k,
+                       indices.end( ),
+                       [ & ]( int32_t l, int32_t r ) {
+                           return score[ l ] > score[ r ];
+                       } );
+
+    float maxScore = 0.0f;
+    double sum = 1.0;
+
+    if ( applySoftmax && k > 0 )
+    {
+        // Shift by the maximum so the exponentials can't overflow
+        maxScore = score[ indices.front( ) ];
+        sum = 0.0;
+
+        for ( int32_t i = 0; i < count; i++ )
+        {
+            sum += std::exp( static_cast< double >( score[ i ] - maxScore ) );
+        }
+    }
+
+    std::vector< Classification > top;
+    top.reserve( static_cast< size_t >( k ) );
+
+    for ( int32_t i = 0; i < k; i++ )
+    {
+        const int32_t classId = indices[ static_cast< size_t >( i ) ];
+
+        float probability = score[ classId ];
+        if ( applySoftmax )
+        {
+            probability = static_cast< float >(
+                std::exp( static_cast< double >( probability - maxScore ) ) /
+                sum );
+        }
+
+        top.push_back( { classId, probability } );
+    }
+
+    return top;
+}
+
+ImageClassifier::ImageClassifier( const cv::dnn::Net& _net,
+                                  const std::string& labelFile,
+                                  const ClassifierParams& _params /*= { }*/ )
+    : net( _net )
+    , params( _params )
+    , preprocessor( { params.inputSize,
+                      params.scale,
+                      params.mean,
+                      params.swapRB } )
+{
+    CV_Assert( params.batchSize > 0 );
+
+    std::ifstream stream( labelFile );
+    std::string line;
+
+    while ( std::getline( stream, line ) )
+    {
+        labels.push_back( line );
+    }
+}
+
+std::vector< Classification > ImageClassifier::classify( const cv::Mat& image,
+                                                         int32_t k /*= 5*/ )
+{
+    net.setInput( preprocessor.process( image ) );
+    const cv::Mat scores = net.forward( );
+
+    return getTopK( scores.reshape( 1, 1 ), k, params.applySoftmax );
+}
+
+std::vector< std::vector< Classification > >
+ImageClassifier::classifyBatch( const std::vector< cv::Mat >& images,
+                                int32_t k /*= 5*/ )
+{
+    std::vector< std::vector< Classification > > results;
+    results.reserve( images.size( ) );
+
+    const auto batchSize = static_cast< size_t >( params.batchSize );
+
+    for ( size_t first = 0; first < images.size( ); first += batchSize )
+    {
+        const size_t last = std::min( first + batchSize, images.size( ) );
+
+        batch.assign( images.begin( ) + static_cast< std::ptrdiff_t >( first ),
+                      images.begin( ) + static_cast< std::ptrdiff_t >( last ) );
+
+        net.setInput( preprocessor.process( batch ) );
+
+        // One row of class scores per image
+        const cv::Mat scores = net.forward( ).reshape(
+            1, static_cast< int32_t >( last - first ) );
+
+        for ( int32_t i = 0; i < scores.rows; i++ )
+        {
+            results.push_back(
+                getTopK( scores.row( i ), k, params.applySoftmax ) );
+        }
+    }
+
+    return results;
+}
+
+const std::string& ImageClassifier::getLabel( int32_t classId ) const
+{
+    static const std::string unknown;
+
+    if ( classId < 0 || static_cast< size_t >( classId ) >= labels.size( ) )
+    {
+        return unknown;
+    }
+
+    return labels[ static_cast< size_t >( classId ) ];
+}
@@ -0,0 +1,323 @@
+#include <FeatureMatching.h>
+#include <IncrementalPanorama.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/calib3d.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+#include <opencv2/imgproc.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace
+{
+cv::Rect2d warpedBounds( const cv::Size& size, const cv::Matx33d& h )
+{
+    const std::vector< cv::Point2d > corners {
+        { 0.0, 0.0 },
+        { static_cast< double >( size.width ), 0.0 },
+        { static_cast< double >( size.width ),
+          static_cast< double >( size.height ) },
+        { 0.0, static_cast< double >( size.height ) } };
+
+    std::vector< cv::Point2d > mapped;
+    cv::perspectiveTransform( corners, mapped, cv::Mat( h ) );
+
+    double minX = std::numeric_limits< double >::max( );
+    double minY = std::numeric_limits< double >::max( );
+    double maxX = std::numeric_limits< double >::lowest( );
+    double maxY = std::numeric_limits< double >::lowest( );
+    for ( const auto& corner : mapped )
+    {
+        minX = std::min( minX, corner.x );
+        minY = std::min( minY, corner.y );
+        maxX = std::max( maxX, corner.x );
+        maxY = std::max( maxY, corner.y );
+    }
+
+    return { cv::Point2d( minX, minY ), cv::Point2d( maxX, maxY ) };
+}
+} // namespace
+
+IncrementalPanorama::IncrementalPanorama(
+    const IncrementalPanoramaParams& _params /*= { }*/ )
+    : params( _params )
+    , orb( cv::ORB::create( _params.maxFeatures ) )
+{
+    CV_Assert( params.featureScale > 0.0 && params.featureScale <= 1.0 );
+}
+
+bool IncrementalPanorama::addImage( const cv::Mat& image )
+{
+    CV_Assert( image.type( ) == CV_8UC1 || image.type( ) == CV_8UC3 );
+
+    Frame frame;
+    frame.image = image;
+
+    //
+    // Features are computed once per image and cached with the frame
+    //
+    cv::Mat gray;
+    if ( image.channels( ) == 3 )
+    {
+        cv::cvtColor( image, gray, cv::COLOR_BGR2GRAY );
+    }
+    else
+    {
+        gray = image;
+    }
+
+    if ( params.featureScale < 1.0 )
+    {
+        cv::resize( gray,
+                    gray,
+                    cv::Size( ),
+                    params.featureScale,
+                    params.featureScale,
+                    cv::INTER_AREA );
+    }
+
+    orb->detectAndCompute(
+        gray, cv::noArray( ), frame.keypoints, frame.descriptors );
+
+    for ( auto& keypoint : frame.keypoints )
+    {
+        keypoint.pt *= static_cast< float >( 1.0 / params.featureScale );
+    }
+
+    const size_t index = frames.size( );
+
+    if ( index == 0 )
+    {
+        frame.homography = cv::Matx33d::eye( );
+        frames.push_back( std::move( frame ) );
+        return true;
+    }
+
+    //
+    // Match against the latest images only and keep the inliers
+    //
+    FeatureMatchingParams matchingParams;
+    matchingParams.goodMatchPercent = 1.0f;
+    matchingParams.ratio = params.ratio;
+
+    const size_t firstNeighbor =
+        index > static_cast< size_t >( params.matchWindow )
+            ? index - static_cast< size_t >( params.matchWindow )
+            : 0;
+
+    std::vector< FramePair > newPairs;
+    size_t bestPair = 0;
+    cv::Matx33d bestHomography;
+
+    for ( size_t neighbor = firstNeighbor; neighbor < index; neighbor++ )
+    {
+        const Frame& other = frames[ neighbor ];
+
+        const FeatureMatches matches = matchFeatures( frame.keypoints,
+                                                      frame.descriptors,
+                                                      other.keypoints,
+                                                      other.descriptors,
+                                                      matchingParams );
+
+        if ( matches.matches.size( ) <
+             static_cast< size_t >( params.minInliers ) )
+        {
+            continue;
+        }
+
+        std::vector< uchar > inlierMask;
+        const cv::Mat h = cv::findHomography( matches.queryPoints,
+                                              matches.trainPoints,
+                                              cv::RANSAC,
+                                              params.ransacThreshold,
+                                              inlierMask );
+        if ( h.empty( ) )
+        {
+            continue;
+        }
+
+        FramePair pair { index, neighbor, { }, { } };
+        for ( size_t i = 0; i < inlierMask.size( ); i++ )
+        {
+            if ( inlierMask[ i ] != 0 )
+            {
+                pair.pointsA.push_back( matches.queryPoints[ i ] );
+                pair.pointsB.push_back( matches.trainPoints[ i ] );
+            }
+        }
+
+        if ( pair.pointsA.size( ) < static_cast< size_t >( params.minInliers ) )
+        {
+            continue;
+        }
+
+        if ( newPairs.empty( ) ||
+             pair.pointsA.size( ) > newPairs[ bestPair ].pointsA.size( ) )
+        {
+            bestPair = newPairs.size( );
+            bestHomography = other.homography * cv::Matx33d( h );
+        }
+
+        newPairs.push_back( std::move( pair ) );
+    }
+
+    if ( newPairs.empty( ) )
+    {
+        return false;
+    }
+
+    // Initial placement from the best connected neighbor
+    frame.homography = bestHomography;
+    frames.push_back( std::move( frame ) );
+
+    for ( auto& pair : newPairs )
+    {
+        const size_t pairIndex = framePairs.size( );
+        frames[ pair.a ].pairs.push_back( pairIndex );
+        frames[ pair.b ].pairs.push_back( pairIndex );
+        framePairs.push_back( std::move( pair ) );
+    }
+
+    //
+    // Re-estimate only the latest images from their cached matches. The
+    // first image anchors the panorama plane.
+    //
+    const auto refineWindow =
+        static_cast< size_t >( std::max( params.refineWindow, 1 ) );
+    const size_t firstRefined =
+        index >= refineWindow
+            ? std::max< size_t >( index - refineWindow + 1, 1 )
+            : 1;
+
+    for ( int32_t iteration = 0; iteration < params.refineIterations;
+          iteration++ )
+    {
+        for ( size_t i = index + 1; i-- > firstRefined; )
+        {
+            refineFrame( i );
+        }
+    }
+
+    return true;
+}
+
+void IncrementalPanorama::refineFrame( size_t index )
+{
+    // Map the matched points of all connected frames onto the panorama plane
+    // and fit the homography of this frame to them
+    std::vector< cv::Point2f > framePoints;
+    std::vector< cv::Point2f > planePoints;
+
+    for ( const size_t pairIndex : frames[ index ].pairs )
+    {
+        const FramePair& pair = framePairs[ pairIndex ];
+        const bool isA = pair.a == index;
+        const auto& own = isA ? pair.pointsA : pair.pointsB;
+        const auto& other = isA ? pair.pointsB : pair.pointsA;
+        const auto& otherFrame = frames[ isA ? pair.b : pair.a ];
+
+        std::vector< cv::Point2f > mapped;
+        cv::perspectiveTransform(
+            other, mapped, cv::Mat( otherFrame.homography ) );
+
+        framePoints.insert( framePoints.end( ), own.begin( ), own.end( ) );
+        planePoints.insert(
+            planePoints.end( ), mapped.begin( ), mapped.end( ) );
+    }
+
+    if ( framePoints.size( ) < 4 )
+    {
+        return;
+    }
+
+    // All points are RANSAC inliers already, so a least squares fit is enough
+    const cv::Mat h = cv::findHomography( framePoints, planePoints, 0 );
+    if ( ! h.empty( ) )
+    {
+        frames[ index ].homography = cv::Matx33d( h );
+    }
+}
+
+cv::Mat IncrementalPanorama::getHomography( size_t index ) const
+{
+    return cv::Mat( frames.at( index ).homography, true );
+}
+
+cv::Rect2d IncrementalPanorama::getBounds( ) const
+{
+    cv::Rect2d bounds;
+
+    for ( size_t i = 0; i < frames.size( ); i++ )
+    {
+        const cv::Rect2d frameBounds =
+            warpedBounds( frames[ i ].image.size( ), frames[ i ].homography );
+        bounds = i == 0 ? frameBounds : ( bounds | frameBounds );
+    }
+
+    return bounds;
+}
+
+TiledPanoramaCompositor IncrementalPanorama::makeCompositor(
+    const cv::Matx33d& planeToCanvas, cv::Size canvasSize, cv::Size tileSize,
+    PanoramaBlendMode blendMode ) const
+{
+    TiledPanoramaCompositor compositor( canvasSize, tileSize, blendMode );
+
+    for ( const auto& frame : frames )
+    {
+        compositor.addImage( frame.image,
+                             cv::Mat( planeToCanvas * frame.homography ) );
+    }
+
+    return compositor;
+}
+
+TiledPanoramaCompositor IncrementalPanorama::createCompositor(
+    cv::Size tileSize /*= cv::Size( 1024, 1024 )*/,
+    PanoramaBlendMode blendMode /*= PanoramaBlendMode::Feather*/ ) const
+{
+    CV_Assert( ! frames.empty( ) );
+
+    const cv::Rect2d bounds = getBounds( );
+    const cv::Matx33d planeToCanvas(
+        1.0, 0.0, -bounds.x, 0.0, 1.0, -bounds.y, 0.0, 0.0, 1.0 );
+    const cv::Size canvasSize( cvCeil( bounds.width ),
+                               cvCeil( bounds.height ) );
+
+    return makeCompositor( planeToCanvas, canvasSize, tileSize, blendMode );
+}
+
+cv::Mat IncrementalPanorama::renderPreview( double scale ) const
+{
+    CV_Assert( scale > 0.0 );
+
+    if ( frames.empty( ) )
+    {
+        return { };
+    }
+
+    const cv::Rect2d bounds = getBounds( );
+    const cv::Matx33d planeToCanvas( scale,
+                                     0.0,
+                                     -bounds.x * scale,
+                                     0.0,
+                                     scale,
+                                     -bounds.y * scale,
+                                     0.0,
+                                     0.0,
+                                     1.0 );
+    const cv::Size canvasSize( std::max( 1, cvCeil( bounds.width * scale ) ),
+                               std::max( 1, cvCeil( bounds.height * scale ) ) );
+
+    // The canvas is already downscaled, so one tile covers all of it
+    const TiledPanoramaCompositor compositor = makeCompositor(
+        planeToCanvas, canvasSize, canvasSize, PanoramaBlendMode::Feather );
+
+    return compositor.render( nullptr, 1.0 );
+}
@@ -0,0 +1,396 @@
+#include <MultiTargetTracking.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+namespace
+{
+double intersectionOverUnion( const cv::Rect2f& a, const cv::Rect2f& b )
+{
+    const float intersection = ( a & b ).area( );
+    const float unionArea = a.area( ) + b.area( ) - intersection;
+
+    return unionArea > 0.0f ? intersection / unionArea : 0.0;
+}
+
+// Minimum cost assignment of a rows x cols cost matrix (row major) with
+// rows <= cols, Hungarian algorithm with potentials in O( rows^2 * cols ).
+// Returns the assigned column of every row.
+void solveAssignment( const std::vector< double >& cost, size_t rows,
+                      size_t cols, std::vector< int32_t >& rowToCol )
+{
+    const double inf = std::numeric_limits< double >::infinity( );
+
+    // 1 based, index 0 is the virtual start column / row
+    std::vector< double > u( rows + 1, 0.0 );
+    std::vector< double > v( cols + 1, 0.0 );
+    std::vector< size_t > colToRow( cols + 1, 0 );
+    std::vector< size_t > way( cols + 1, 0 );
+    std::vector< double > minV( cols + 1 );
+    std::vector< uchar > used( cols + 1 );
+
+    for ( size_t row = 1; row <= rows; row++ )
+    {
+        colToRow[ 0 ] = row;
+        size_t col0 = 0;
+        std::fill( minV.begin( ), minV.end( ), inf );
+        std::fill( used.begin( ), used.end( ), uchar( 0 ) );
+
+        do
+        {
+            used[ col0 ] = 1;
+            const size_t row0 = colToRow[ col0 ];
+            double delta = inf;
+            size_t col1 = 0;
+
+            for ( size_t col = 1; col <= cols; col++ )
+            {
+                if ( used[ col ] )
+                {
+                    continue;
+                }
+
+                const double reduced = cost[ ( row0 - 1 ) * cols + col - 1 ] -
+                                       u[ row0 ] - v[ col ];
+                if ( reduced < minV[ col ] )
+                {
+                    minV[ col ] = reduced;
+                    way[ col ] = col0;
+                }
+                if ( minV[ col ] < delta )
+                {
+                    delta = minV[ col ];
+                    col1 = col;
+                }
+            }
+
+            for ( size_t col = 0; col <= cols; col++ )
+            {
+                if ( used[ col ] )
+                {
+                    u[ colToRow[ col ] ] += delta;
+                    v[ col ] -= delta;
+                }
+                else
+                {
+                    minV[ col ] -= delta;
+                }
+            }
+
+            col0 = col1;
+        } while ( colToRow[ col0 ] != 0 );
+
+        // Flip the augmenting path
+        do
+        {
+            const size_t col1 = way[ col0 ];
+            colToRow[ col0 ] = colToRow[ col1 ];
+            col0 = col1;
+        } while ( col0 != 0 );
+    }
+
+    rowToCol.assign( rows, -1 );
+    for ( size_t col = 1; col <= cols; col++ )
+    {
+        if ( colToRow[ col ] != 0 )
+        {
+            rowToCol[ colToRow[ col ] - 1 ] = static_cast< int32_t >( col - 1 );
+        }
+    }
+}
+} // namespace
+
+KalmanTrackerBank::KalmanTrackerBank(
+    const KalmanTrackerParams& _params /*= { }*/ )
+    : params( _params )
+{
+    CV_Assert( params.measurementNoise > 0.0f );
+    CV_Assert( params.minHits >= 1 && params.maxMissed >= 0 );
+    CV_Assert( params.aspectRatio > 0.0f );
+}
+
+void KalmanTrackerBank::update( const std::vector< cv::Rect >& detections,
+                                float dt )
+{
+    predict( dt );
+
+    const size_t numTracks = ids.size( );
+    const size_t numDetections = detections.size( );
+
+    //
+    // Associate tracks and detections on their IoU. Pairs below minIou are
+    // never matched, whatever the assignment says.
+    //
+    assignment.assign( numTracks, -1 );
+
+    if ( numTracks > 0 && numDetections > 0 )
+    {
+        cost.resize( numTracks * numDetections );
+        for ( size_t t = 0; t < numTracks; t++ )
+        {
+            const cv::Rect2f predicted = trackBox( t );
+            for ( size_t d = 0; d < numDetections; d++ )
+            {
+                cost[ t * numDetections + d ] = 1.0 - intersectionOverUnion(
+                    predicted, cv::Rect2f( detections[ d ] ) );
+            }
+        }
+
+        const double maxCost = 1.0 - params.minIou;
+
+        if ( params.association == TrackAssociation::Hungarian )
+        {
+            // The solver wants rows <= cols, transpose otherwise
+            if ( numTracks <= numDetections )
+            {
+                solveAssignment( cost, numTracks, numDetections, assignment );
+            }
+            else
+            {
+                std::vector< double > transposed( cost.size( ) );
+                for ( size_t t = 0; t < numTracks; t++ )
+                {
+                    for ( size_t d = 0; d < numDetections; d++ )
+                    {
+                        transposed[ d * numTracks + t ] =
+                            cost[ t * numDetections + d ];
+                    }
+                }
+
+                std::vector< int32_t > detectionToTrack;
+                solveAssignment(
+                    transposed, numDetections, numTracks, detectionToTrack );
+
+                for ( size_t d = 0; d < numDetections; d++ )
+                {
+                    const int32_t t = detectionToTrack[ d ];
+                    if ( t >= 0 )
+                    {
+                        assignment[ static_cast< size_t >( t ) ] =
+                            static_cast< int32_t >( d );
+                    }
+                }
+            }
+
+            for ( size_t t = 0; t < numTracks; t++ )
+            {
+                const int32_t d = assignment[ t ];
+                if ( d >= 0 &&
+                     cost[ t * numDetections + static_cast< size_t >( d ) ] >
+                         maxCost )
+                {
+                    assignment[ t ] = -1;
+                }
+            }
+        }
+        else
+        {
+            std::vector< std::tuple< double, size_t, size_t > > pairs;
+            for ( size_t t = 0; t < numTracks; t++ )
+            {
+                for ( size_t d = 0; d < numDetections; d++ )
+                {
+                    const double c = cost[ t * numDetections + d ];
+                    if ( c <= maxCost )
+                    {
+                        pairs.emplace_back( c, t, d );
+                    }
+                }
+            }
+            std::sort( pairs.begin( ), pairs.end( ) );
+
+            detectionUsed.assign( numDetections, 0 );
+            for ( const auto& [ c, t, d ] : pairs )
+            {
+                if ( assignment[ t ] < 0 && ! detectionUsed[ d ] )
+                {
+                    assignment[ t ] = static_cast< int32_t >( d );
+                    detectionUsed[ d ] = 1;
+                }
+            }
+        }
+    }
+
+    //
+    // Correct the matched tracks, age the others
+    //
+    detectionUsed.assign( numDetections, 0 );
+
+    for ( size_t t = 0; t < numTracks; t++ )
+    {
+        const int32_t d = assignment[ t ];
+        if ( d < 0 )
+        {
+            hits[ t ] = 0;
+            missed[ t ]++;
+            continue;
+        }
+
+        correct( t, detections[ static_cast< size_t >( d ) ] );
+        detectionUsed[ static_cast< size_t >( d ) ] = 1;
+        hits[ t ]++;
+        missed[ t ] = 0;
+
+        if ( hits[ t ] >= params.minHits )
+        {
+            confirmed[ t ] = 1;
+        }
+    }
+
+    // Tracks are removed back to front, removal moves the last one in place
+    for ( size_t t = numTracks; t-- > 0; )
+    {
+        if ( missed[ t ] > params.maxMissed )
+        {
+            removeTrack( t );
+        }
+    }
+
+    for ( size_t d = 0; d < numDetections; d++ )
+    {
+        if ( ! detectionUsed[ d ] )
+        {
+            addTrack( detections[ d ] );
+        }
+    }
+}
+
+std::vector< TrackedObject > KalmanTrackerBank::getTracks(
+    bool confirmedOnly /*= true*/ ) const
+{
+    std::vector< TrackedObject > tracks;
+    tracks.reserve( ids.size( ) );
+
+    for ( size_t t = 0; t < ids.size( ); t++ )
+    {
+        // A confirmed track stays confirmed while coasting through misses
+        if ( confirmedOnly && ! confirmed[ t ] )
+        {
+            continue;
+        }
+
+        tracks.push_back( { ids[ t ],
+                            trackBox( t ),
+                            cv::Point2f( axes[ 0 ].velocity[ t ],
+                                         axes[ 1 ].velocity[ t ] ),
+                            hits[ t ],
+                            missed[ t ] } );
+    }
+
+    return tracks;
+}
+
+void KalmanTrackerBank::predict( float dt )
+{
+    // x' = x + dt * v, P' = F * P * F^T + Q for every 2x2 block
+    const float q = params.processNoise;
+    const float dt2 = dt * dt;
+    const size_t numTracks = ids.size( );
+
+    for ( auto& axis : axes )
+    {
+        float* position = axis.position.data( );
+        const float* velocity = axis.velocity.data( );
+        float* pPP = axis.pPP.data( );
+        float* pPV = axis.pPV.data( );
+        float* pVV = axis.pVV.data( );
+
+        for ( size_t t = 0; t < numTracks; t++ )
+        {
+            position[ t ] += dt * velocity[ t ];
+            pPP[ t ] += 2.0f * dt * pPV[ t ] + dt2 * pVV[ t ] + q;
+            pPV[ t ] += dt * pVV[ t ];
+            pVV[ t ] += q;
+        }
+    }
+}
+
+void KalmanTrackerBank::correct( size_t track, const cv::Rect& detection )
+{
+    const float measurement[ 3 ] = { static_cast< float >( detection.x ),
+                                     static_cast< float >( detection.y ),
+                                     static_cast< float >( detection.width ) };
+
+    for ( size_t a = 0; a < 3; a++ )
+    {
+        Axis& axis = axes[ a ];
+
+        const float pPP = axis.pPP[ track ];
+        const float pPV = axis.pPV[ track ];
+
+        // Gain of position and velocity for the position measurement
+        const float s = pPP + params.measurementNoise;
+        const float kP = pPP / s;
+        const float kV = pPV / s;
+        const float residual = measurement[ a ] - axis.position[ track ];
+
+        axis.position[ track ] += kP * residual;
+        axis.velocity[ track ] += kV * residual;
+
+        // P = ( I - K * H ) * P
+        axis.pPP[ track ] = ( 1.0f - kP ) * pPP;
+        axis.pPV[ track ] = ( 1.0f - kP ) * pPV;
+        axis.pVV[ track ] -= kV * pPV;
+    }
+}
+
+void KalmanTrackerBank::addTrack( const cv::Rect& detection )
+{
+    const float measurement[ 3 ] = { static_cast< float >( detection.x ),
+                                     static_cast< float >( detection.y ),
+                                     static_cast< float >( detection.width ) };
+
+    for ( size_t a = 0; a < 3; a++ )
+    {
+        Axis& axis = axes[ a ];
+        axis.position.push_back( measurement[ a ] );
+        axis.velocity.push_back( 0.0f );
+        axis.pPP.push_back( params.initialCovariance );
+        axis.pPV.push_back( 0.0f );
+        axis.pVV.push_back( params.initialCovariance );
+    }
+
+    ids.push_back( nextId++ );
+    hits.push_back( 1 );
+    missed.push_back( 0 );
+    confirmed.push_back( params.minHits <= 1 ? 1 : 0 );
+}
+
+void KalmanTrackerBank::removeTrack( size_t track )
+{
+    const auto removeAt = [ track ]( auto& values ) {
+        values[ track ] = values.back( );
+        values.pop_back( );
+    };
+
+    for ( auto& axis : axes )
+    {
+        removeAt( axis.position );
+        removeAt( axis.velocity );
+        removeAt( axis.pPP );
+        removeAt( axis.pPV );
+        removeAt( axis.pVV );
+    }
+
+    removeAt( ids );
+    removeAt( hits );
+    removeAt( missed );
+    removeAt( confirmed );
+}
+
+cv::Rect2f KalmanTrackerBank::trackBox( size_t track ) const
+{
+    const float width = axes[ 2 ].position[ track ];
+
+    return cv::Rect2f( axes[ 0 ].position[ track ],
+                       axes[ 1 ].position[ track ],
+                       width,
+                       width * params.aspectRatio );
+}
@@ -0,0 +1,297 @@
+#include <PanoramaCompositing.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+TiledPanoramaCompositor::TiledPanoramaCompositor(
+    cv::Size _canvasSize, cv::Size _tileSize /*= cv::Size( 1024, 1024 )*/,
+    PanoramaBlendMode _blendMode /*= PanoramaBlendMode::Feather*/ )
+    : canvasSize( _canvasSize )
+    , tileSize( _tileSize )
+    , blendMode( _blendMode )
+{
+    CV_Assert( canvasSize.width > 0 && canvasSize.height > 0 );
+    CV_Assert( tileSize.width > 0 && tileSize.height > 0 );
+}
+
+void TiledPanoramaCompositor::addImage( const cv::Mat& image,
+                                        const cv::Mat& homography )
+{
+    CV_Assert( image.type( ) == CV_8UC1 || image.type( ) == CV_8UC3 );
+    CV_Assert( imageType == -1 || imageType == image.type( ) );
+    CV_Assert( homography.rows == 3 && homography.cols == 3 );
+
+    imageType = image.type( );
+
+    cv::Mat imageToCanvas;
+    homography.convertTo( imageToCanvas, CV_64F );
+
+    const std::vector< cv::Point2d > corners {
+        { 0.0, 0.0 },
+        { static_cast< double >( image.cols ), 0.0 },
+        { static_cast< double >( image.cols ),
+          static_cast< double >( image.rows ) },
+        { 0.0, static_cast< double >( image.rows ) } };
+
+    std::vector< cv::Point2d > mapped;
+    cv::perspectiveTransform( corners, mapped, imageToCanvas );
+
+    double minX = mapped[ 0 ].x;
+    double maxX = mapped[ 0 ].x;
+    double minY = mapped[ 0 ].y;
+    double maxY = mapped[ 0 ].y;
+    for ( const auto& corner : mapped )
+    {
+        minX = std::min( minX, corner.x );
+        maxX = std::max( maxX, corner.x );
+        minY = std::min( minY, corner.y );
+        maxY = std::max( maxY, corner.y );
+    }
+
+    const cv::Rect canvasRect(
+        cv::Point( cvFloor( minX ), cvFloor( minY ) ),
+        cv::Point( cvCeil( maxX ) + 1, cvCeil( maxY ) + 1 ) );
+
+    Source source;
+    source.image = image;
+    source.canvasToImage = cv::Matx33d( imageToCanvas.inv( ) );
+    source.canvasRect = canvasRect & cv::Rect( cv::Point( 0, 0 ), canvasSize );
+
+    if ( ! source.canvasRect.empty( ) )
+    {
+        sources.push_back( source );
+    }
+}
+
+void TiledPanoramaCompositor::renderTile( const cv::Rect& tileRect,
+                                          cv::Mat& tile ) const
+{
+    const int32_t channels = CV_MAT_CN( imageType );
+
+    cv::Mat accumulator( tileRect.size( ),
+                         CV_32FC( channels ),
+                         cv::Scalar::all( 0 ) );
+    cv::Mat weightSum( tileRect.size( ), CV_32FC1, cv::Scalar::all( 0 ) );
+
+    cv::Mat mapX, mapY, warped;
+
+    for ( const auto& source : sources )
+    {
+        const cv::Rect overlap = source.canvasRect & tileRect;
+        if ( overlap.empty( ) )
+        {
+            continue;
+        }
+
+        // Map only the overlapping part of the tile back into the image
+        mapX.create( overlap.size( ), CV_32FC1 );
+        mapY.create( overlap.size( ), CV_32FC1 );
+
+        const auto& h = source.canvasToImage;
+        for ( int32_t y = 0; y < overlap.height; y++ )
+        {
+            auto* rowX = mapX.ptr< float >( y );
+            auto* rowY = mapY.ptr< float >( y );
+            const double cy = overlap.y + y;
+
+            for ( int32_t x = 0; x < overlap.width; x++ )
+            {
+                const double cx = overlap.x + x;
+                const double w = h( 2, 0 ) * cx + h( 2, 1 ) * cy + h( 2, 2 );
+                const double scale = w != 0.0 ? 1.0 / w : 0.0;
+
+                rowX[ x ] = static_cast< float >(
+                    ( h( 0, 0 ) * cx + h( 0, 1 ) * cy + h( 0, 2 ) ) * scale );
+                rowY[ x ] = static_cast< float >(
+                    ( h( 1, 0 ) * cx + h( 1, 1 ) * cy + h( 1, 2 ) ) * scale );
+            }
+        }
+
+        cv::remap( source.image,
+                   warped,
+                   mapX,
+                   mapY,
+                   cv::INTER_LINEAR,
+                   cv::BORDER_CONSTANT );
+
+        const auto maxX = static_cast< float >( source.image.cols - 1 );
+        const auto maxY = static_cast< float >( source.image.rows - 1 );
+        const cv::Point offset = overlap.tl( ) - tileRect.tl( );
+
+        for ( int32_t y = 0; y < overlap.height; y++ )
+        {
+            const auto* rowX = mapX.ptr< float >( y );
+            const auto* rowY = mapY.ptr< float >( y );
+            const auto* src = warped.ptr< uchar >( y );
+            auto* acc = accumulator.ptr< float >( y + offset.y );
+            auto* weights = weightSum.ptr< float >( y + offset.y );
+
+            for ( int32_t x = 0; x < overlap.width; x++ )
+            {
+                const float sx = rowX[ x ];
+                const float sy = rowY[ x ];
+                if ( sx < 0.0f || sy < 0.0f || sx > maxX || sy > maxY )
+                {
+                    continue;
+                }
+
+                const int32_t tx = x + offset.x;
+                const auto* pixel = src + x * channels;
+                auto* accPixel = acc + tx * channels;
+
+                if ( blendMode == PanoramaBlendMode::Overwrite )
+                {
+                    for ( int32_t c = 0; c < channels; c++ )
+                    {
+                        accPixel[ c ] = pixel[ c ];
+                    }
+                    weights[ tx ] = 1.0f;
+                }
+                else
+                {
+                    // Distance to the closest image border
+                    const float weight =
+                        std::min( std::min( sx, maxX - sx ),
+                                  std::min( sy, maxY - sy ) ) +
+                        1.0f;
+
+                    for ( int32_t c = 0; c < channels; c++ )
+                    {
+                        accPixel[ c ] += weight * pixel[ c ];
+                    }
+                    weights[ tx ] += weight;
+                }
+            }
+        }
+    }
+
+    tile.create( tileRect.size( ), imageType );
+
+    for ( int32_t y = 0; y < tileRect.height; y++ )
+    {
+        const auto* acc = accumulator.ptr< float >( y );
+        const auto* weights = weightSum.ptr< float >( y );
+        auto* dst = tile.ptr< uchar >( y );
+
+        for ( int32_t x = 0; x < tileRect.width; x++ )
+        {
+            const float norm = weights[ x ] > 0.0f ? 1.0f / weights[ x ] : 0.0f;
+            for ( int32_t c = 0; c < channels; c++ )
+            {
+                dst[ x * channels + c ] = cv::saturate_cast< uchar >(
+                    acc[ x * channels + c ] * norm );
+            }
+        }
+    }
+}
+
+cv::Mat TiledPanoramaCompositor::render( const TileSink& sink,
+                                         double previewScale /*= 0.0*/ ) const
+{
+    cv::Mat preview;
+
+    if ( sources.empty( ) )
+    {
+        return preview;
+    }
+
+    const int32_t tileCols =
+        ( canvasSize.width + tileSize.width - 1 ) / tileSize.width;
+    const int32_t tileRows =
+        ( canvasSize.height + tileSize.height - 1 ) / tileSize.height;
+
+    if ( previewScale > 0.0 )
+    {
+        const cv::Size previewSize(
+            std::max( 1, cvFloor( canvasSize.width * previewScale ) ),
+            std::max( 1, cvFloor( canvasSize.height * previewScale ) ) );
+
+        preview = cv::Mat( previewSize, imageType, cv::Scalar::all( 0 ) );
+    }
+
+    const cv::Rect canvasRect( cv::Point( 0, 0 ), canvasSize );
+
+    cv::parallel_for_(
+        cv::Range( 0, tileCols * tileRows ), [ & ]( const cv::Range& range ) {
+            cv::Mat tile;
+
+            for ( int32_t i = range.start; i < range.end; i++ )
+            {
+                const cv::Point tileIndex( i % tileCols, i / tileCols );
+                const cv::Rect tileRect =
+                    cv::Rect( tileIndex.x * tileSize.width,
+                              tileIndex.y * tileSize.height,
+                              tileSize.width,
+                              tileSize.height ) &
+                    canvasRect;
+
+                const bool touched = std::any_of(
+                    sources.begin( ),
+                    sources.end( ),
+                    [ & ]( const Source& source ) {
+                        return ! ( source.canvasRect & tileRect ).empty( );
+                    } );
+
+                if ( ! touched )
+                {
+                    continue;
+                }
+
+                renderTile( tileRect, tile );
+
+                if ( sink )
+                {
+                    sink( tileIndex, tileRect, tile );
+                }
+
+                if ( ! preview.empty( ) )
+                {
+                    // Floor both borders, so neighboring tiles never write to
+                    // the same preview pixels
+                    const cv::Point previewTl(
+                        cvFloor( tileRect.x * previewScale ),
+                        cvFloor( tileRect.y * previewScale ) );
+                    const cv::Point previewBr(
+                        cvFloor( tileRect.br( ).x * previewScale ),
+                        cvFloor( tileRect.br( ).y * previewScale ) );
+                    const cv::Rect previewRect =
+                        cv::Rect( previewTl, previewBr ) &
+                        cv::Rect( cv::Point( 0, 0 ), preview.size( ) );
+
+                    if ( ! previewRect.empty( ) )
+                    {
+                        cv::Mat previewTile = preview( previewRect );
+                        cv::resize( tile,
+                                    previewTile,
+                                    previewRect.size( ),
+                                    0,
+                                    0,
+                                    cv::INTER_AREA );
+                    }
+                }
+            }
+        } );
+
+    return preview;
+}
+
+TiledPanoramaCompositor::TileSink
+TiledPanoramaCompositor::writeTilesTo( const std::string& directory )
+{
+    return [ directory ]( const cv::Point& tileIndex,
+                          const cv::Rect&,
+                          const cv::Mat& tile ) {
+        cv::imwrite( directory + "/tile_" + std::to_string( tileIndex.y ) +
+                         "_" + std::to_string( tileIndex.x ) + ".png",
+                     tile );
+    };
+}
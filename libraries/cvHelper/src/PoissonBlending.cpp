@@ -0,0 +1,301 @@
+#include <PoissonBlending.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+struct Placement
+{
+    // Mask bounding box in src and where it lands in dst
+    cv::Rect source;
+    cv::Rect target;
+};
+
+// The target is clipped so the boundary ring around it stays inside dst
+Placement placePatch( const cv::Rect& maskRect, cv::Point center,
+                      cv::Size dstSize )
+{
+    const cv::Rect placed( center.x - maskRect.width / 2,
+                           center.y - maskRect.height / 2,
+                           maskRect.width,
+                           maskRect.height );
+    const cv::Rect inner( 1, 1, dstSize.width - 2, dstSize.height - 2 );
+    const cv::Rect target = placed & inner;
+
+    if ( target.empty( ) )
+    {
+        return { };
+    }
+
+    const cv::Point shift = target.tl( ) - placed.tl( );
+
+    return { cv::Rect( maskRect.tl( ) + shift, target.size( ) ), target };
+}
+
+void firstChannel( const cv::Mat& mask, cv::Mat& channel )
+{
+    if ( mask.channels( ) == 1 )
+    {
+        channel = mask;
+    }
+    else
+    {
+        cv::extractChannel( mask, channel, 0 );
+    }
+}
+
+cv::Rect grow( const cv::Rect& rect )
+{
+    return cv::Rect( rect.x - 1, rect.y - 1, rect.width + 2, rect.height + 2 );
+}
+
+// Copy the region of src, parts outside of src are filled like borderType
+void copyPadded( const cv::Mat& src, const cv::Rect& region, cv::Mat& dst,
+                 int32_t borderType )
+{
+    const cv::Rect available =
+        region & cv::Rect( cv::Point( 0, 0 ), src.size( ) );
+
+    cv::copyMakeBorder( src( available ),
+                        dst,
+                        available.y - region.y,
+                        region.br( ).y - available.br( ).y,
+                        available.x - region.x,
+                        region.br( ).x - available.br( ).x,
+                        borderType,
+                        cv::Scalar::all( 0 ) );
+}
+} // namespace
+
+void PoissonBlender::seamlessClone( const cv::Mat& src, cv::Mat& dst,
+                                    const cv::Mat& mask, cv::Point center,
+                                    int32_t flags /*= cv::NORMAL_CLONE*/ )
+{
+    CV_Assert( src.type( ) == CV_8UC3 && dst.type( ) == CV_8UC3 );
+    CV_Assert( mask.depth( ) == CV_8U && mask.size( ) == src.size( ) );
+    CV_Assert( flags == cv::NORMAL_CLONE || flags == cv::MIXED_CLONE );
+    CV_Assert( dst.cols >= 3 && dst.rows >= 3 );
+
+    firstChannel( mask, maskChannel );
+
+    const auto [ source, target ] =
+        placePatch( cv::boundingRect( maskChannel ), center, dst.size( ) );
+
+    if ( target.empty( ) )
+    {
+        return;
+    }
+
+    //
+    // Patches with the boundary ring. The ring of the source may leave src,
+    // it only feeds gradients across the patch border and is replicated.
+    //
+    copyPadded( src, grow( source ), srcPatch8U, cv::BORDER_REPLICATE );
+    copyPadded( maskChannel, grow( source ), maskPatch, cv::BORDER_CONSTANT );
+    srcPatch8U.convertTo( srcPatch, CV_32F );
+    dst( grow( target ) ).convertTo( dstPatch, CV_32F );
+
+    const int32_t width = target.width;
+    const int32_t height = target.height;
+    const bool mixed = flags == cv::MIXED_CLONE;
+
+    rhs.create( height, width, CV_32FC1 );
+    solutionChannels.resize( 3 );
+
+    for ( int32_t c = 0; c < 3; c++ )
+    {
+        //
+        // Right hand side of sum( u( q ) - u( p ) ) = sum( v( p, q ) ) over
+        // the four neighbors q. v is the src difference if p or q is masked,
+        // else the dst difference. MIXED_CLONE takes the larger one of both
+        // inside the mask. Known ring values move to the right hand side.
+        //
+        for ( int32_t y = 0; y < height; y++ )
+        {
+            // Rows above, at and below the pixel in the padded patches
+            const float* s[ 3 ] = { srcPatch.ptr< float >( y ),
+                                    srcPatch.ptr< float >( y + 1 ),
+                                    srcPatch.ptr< float >( y + 2 ) };
+            const float* d[ 3 ] = { dstPatch.ptr< float >( y ),
+                                    dstPatch.ptr< float >( y + 1 ),
+                                    dstPatch.ptr< float >( y + 2 ) };
+            const uchar* m[ 3 ] = { maskPatch.ptr< uchar >( y ),
+                                    maskPatch.ptr< uchar >( y + 1 ),
+                                    maskPatch.ptr< uchar >( y + 2 ) };
+            float* b = rhs.ptr< float >( y );
+
+            for ( int32_t x = 0; x < width; x++ )
+            {
+                const int32_t px = x + 1;
+                const auto i = static_cast< size_t >( px * 3 + c );
+                const bool inside = m[ 1 ][ px ] != 0;
+
+                float sum = 0.0f;
+
+                const auto addEdge = [ & ]( size_t row, int32_t dx,
+                                            bool ring ) {
+                    const auto j = static_cast< size_t >( ( px + dx ) * 3 + c );
+                    const float ds = s[ row ][ j ] - s[ 1 ][ i ];
+                    const float dd = d[ row ][ j ] - d[ 1 ][ i ];
+
+                    float v = dd;
+                    if ( inside || m[ row ][ px + dx ] != 0 )
+                    {
+                        v = mixed && std::abs( dd ) > std::abs( ds ) ? dd : ds;
+                    }
+
+                    sum += v;
+                    if ( ring )
+                    {
+                        sum -= d[ row ][ j ];
+                    }
+                };
+
+                addEdge( 1, -1, x == 0 );
+                addEdge( 1, 1, x == width - 1 );
+                addEdge( 0, 0, y == 0 );
+                addEdge( 2, 0, y == height - 1 );
+
+                b[ x ] = sum;
+            }
+        }
+
+        solve( rhs, solutionChannels[ static_cast< size_t >( c ) ] );
+    }
+
+    cv::merge( solutionChannels, result );
+
+    cv::Mat dstTarget = dst( target );
+    result.convertTo( dstTarget, CV_8U );
+}
+
+cv::Rect PoissonBlender::getDestinationRect( const cv::Mat& mask,
+                                             cv::Point center,
+                                             cv::Size dstSize )
+{
+    cv::Mat channel;
+    firstChannel( mask, channel );
+
+    const cv::Rect target =
+        placePatch( cv::boundingRect( channel ), center, dstSize ).target;
+
+    return target.empty( ) ? cv::Rect( ) : grow( target );
+}
+
+void PoissonBlender::solve( const cv::Mat& b, cv::Mat& u )
+{
+    const int32_t width = b.cols;
+    const int32_t height = b.rows;
+
+    //
+    // The sine basis diagonalizes the 5 point Laplacian with zero boundary,
+    // its eigenvalues are 2 cos( pi k / ( n + 1 ) ) - 2 per axis
+    //
+    sineTransform( b, coefficients );
+
+    eigenX.resize( static_cast< size_t >( width ) );
+    eigenY.resize( static_cast< size_t >( height ) );
+
+    for ( int32_t x = 0; x < width; x++ )
+    {
+        eigenX[ static_cast< size_t >( x ) ] = static_cast< float >(
+            2.0 * std::cos( CV_PI * ( x + 1 ) / ( width + 1 ) ) - 2.0 );
+    }
+    for ( int32_t y = 0; y < height; y++ )
+    {
+        eigenY[ static_cast< size_t >( y ) ] = static_cast< float >(
+            2.0 * std::cos( CV_PI * ( y + 1 ) / ( height + 1 ) ) - 2.0 );
+    }
+
+    for ( int32_t y = 0; y < height; y++ )
+    {
+        float* row = coefficients.ptr< float >( y );
+        const float eigen = eigenY[ static_cast< size_t >( y ) ];
+
+        for ( int32_t x = 0; x < width; x++ )
+        {
+            row[ x ] /= eigen + eigenX[ static_cast< size_t >( x ) ];
+        }
+    }
+
+    // The sine transform is its own inverse up to 2 / ( n + 1 ) per axis
+    sineTransform( coefficients, u );
+    u *= 4.0 / ( static_cast< double >( width + 1 ) * ( height + 1 ) );
+}
+
+void PoissonBlender::sineTransform( const cv::Mat& src, cv::Mat& dst )
+{
+    sineTransformRows( src, transformed );
+    cv::transpose( transformed, transposed );
+    sineTransformRows( transposed, transformed );
+    cv::transpose( transformed, dst );
+}
+
+void PoissonBlender::sineTransformRows( const cv::Mat& src, cv::Mat& dst )
+{
+    //
+    // DST-I of a row x of length n is -1/2 times the imaginary part of the
+    // DFT of its odd extension [ 0, x, 0, -reverse( x ) ], bins 1..n
+    //
+    const int32_t n = src.cols;
+
+    extended.create( src.rows, 2 * n + 2, CV_32FC1 );
+
+    for ( int32_t y = 0; y < src.rows; y++ )
+    {
+        const float* in = src.ptr< float >( y );
+        float* row = extended.ptr< float >( y );
+
+        row[ 0 ] = 0.0f;
+        row[ n + 1 ] = 0.0f;
+
+        for ( int32_t x = 0; x < n; x++ )
+        {
+            row[ x + 1 ] = in[ x ];
+            row[ 2 * n + 1 - x ] = -in[ x ];
+        }
+    }
+
+    cv::dft( extended, spectrum, cv::DFT_ROWS | cv::DFT_COMPLEX_OUTPUT );
+
+    dst.create( src.size( ), CV_32FC1 );
+
+    for ( int32_t y = 0; y < src.rows; y++ )
+    {
+        const auto* bins = spectrum.ptr< cv::Vec2f >( y );
+        float* out = dst.ptr< float >( y );
+
+        for ( int32_t k = 0; k < n; k++ )
+        {
+            out[ k ] = -0.5f * bins[ k + 1 ][ 1 ];
+        }
+    }
+}
+
+void seamlessCloneBatch( const std::vector< ClonePatch >& patches,
+                         cv::Mat& dst, int32_t flags /*= cv::NORMAL_CLONE*/ )
+{
+    cv::parallel_for_(
+        cv::Range( 0, static_cast< int32_t >( patches.size( ) ) ),
+        [ & ]( const cv::Range& range ) {
+            // One set of scratch buffers per chunk of patches
+            PoissonBlender blender;
+
+            for ( int32_t i = range.start; i < range.end; i++ )
+            {
+                const ClonePatch& patch = patches[ static_cast< size_t >( i ) ];
+                blender.seamlessClone(
+                    patch.src, dst, patch.mask, patch.center, flags );
+            }
+        },
+        // One chunk per thread, otherwise every patch is its own chunk and
+        // gets a fresh blender
+        cv::getNumThreads( ) );
+}
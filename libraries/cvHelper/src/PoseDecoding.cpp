@@ -0,0 +1,408 @@
+#include <PoseDecoding.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+// Peak in heatmap coordinates
+struct Peak
+{
+    cv::Point2f position;
+    float score;
+};
+
+struct Connection
+{
+    // Indices into the peaks of the first and second keypoint of the limb
+    int32_t a;
+    int32_t b;
+    float score;
+};
+
+// Channel c of a 1 x channels x height x width blob
+cv::Mat blobChannel( const cv::Mat& output, int32_t c )
+{
+    return cv::Mat( output.size[ 2 ],
+                    output.size[ 3 ],
+                    CV_32F,
+                    const_cast< float* >( output.ptr< float >( 0, c ) ) );
+}
+
+// Offset of the vertex of the parabola through ( -1, l ), ( 0, c ), ( 1, r )
+float vertexOffset( float l, float c, float r )
+{
+    const float curvature = l - 2.0f * c + r;
+
+    if ( curvature >= 0.0f )
+    {
+        return 0.0f;
+    }
+
+    return std::clamp( 0.5f * ( l - r ) / curvature, -0.5f, 0.5f );
+}
+
+std::vector< std::vector< Peak > >
+findPeaks( const cv::Mat& output, int32_t keypointCount, float threshold )
+{
+    CV_Assert( output.dims == 4 && output.type( ) == CV_32F );
+    CV_Assert( keypointCount <= output.size[ 1 ] );
+
+    std::vector< std::vector< Peak > > peaks(
+        static_cast< size_t >( keypointCount ) );
+
+    cv::parallel_for_(
+        cv::Range( 0, keypointCount ), [ & ]( const cv::Range& range ) {
+            cv::Mat dilated;
+            cv::Mat isPeak;
+            std::vector< cv::Point > locations;
+            std::vector< cv::Point > kept;
+
+            for ( int32_t k = range.start; k < range.end; k++ )
+            {
+                const cv::Mat map = blobChannel( output, k );
+
+                cv::dilate( map, dilated, cv::Mat( ) );
+                isPeak = ( map >= dilated ) & ( map > threshold );
+                cv::findNonZero( isPeak, locations );
+
+                auto& found = peaks[ static_cast< size_t >( k ) ];
+                kept.clear( );
+
+                for ( const auto& loc : locations )
+                {
+                    // Plateaus yield adjacent equal maxima, keep the first one
+                    const bool duplicate = std::any_of(
+                        kept.begin( ), kept.end( ), [ & ]( auto& p ) {
+                            return std::abs( p.x - loc.x ) <= 1 &&
+                                   std::abs( p.y - loc.y ) <= 1;
+                        } );
+
+                    if ( duplicate )
+                    {
+                        continue;
+                    }
+
+                    kept.push_back( loc );
+
+                    const float* row = map.ptr< float >( loc.y );
+                    const float c = row[ loc.x ];
+
+                    cv::Point2f position( static_cast< float >( loc.x ),
+                                          static_cast< float >( loc.y ) );
+
+                    if ( loc.x > 0 && loc.x < map.cols - 1 )
+                    {
+                        position.x += vertexOffset(
+                            row[ loc.x - 1 ], c, row[ loc.x + 1 ] );
+                    }
+                    if ( loc.y > 0 && loc.y < map.rows - 1 )
+                    {
+                        position.y +=
+                            vertexOffset( map.at< float >( loc.y - 1, loc.x ),
+                                          c,
+                                          map.at< float >( loc.y + 1, loc.x ) );
+                    }
+
+                    found.push_back( { position, c } );
+                }
+            }
+        } );
+
+    return peaks;
+}
+
+// Heatmap pixel centers map to image pixel centers
+cv::Point2f toImage( const cv::Point2f& p, cv::Size mapSize,
+                     cv::Size imageSize )
+{
+    return { ( p.x + 0.5f ) * static_cast< float >( imageSize.width ) /
+                     static_cast< float >( mapSize.width ) -
+                 0.5f,
+             ( p.y + 0.5f ) * static_cast< float >( imageSize.height ) /
+                     static_cast< float >( mapSize.height ) -
+                 0.5f };
+}
+
+// Peaks of every keypoint mapped to an image of imageSize
+std::vector< std::vector< PoseKeypoint > >
+toImageKeypoints( const std::vector< std::vector< Peak > >& peaks,
+                  cv::Size mapSize, cv::Size imageSize )
+{
+    std::vector< std::vector< PoseKeypoint > > keypoints( peaks.size( ) );
+
+    for ( size_t k = 0; k < peaks.size( ); k++ )
+    {
+        for ( const auto& peak : peaks[ k ] )
+        {
+            keypoints[ k ].push_back(
+                { toImage( peak.position, mapSize, imageSize ), peak.score } );
+        }
+    }
+
+    return keypoints;
+}
+
+std::vector< Connection > connectLimb( const std::vector< Peak >& peaksA,
+                                       const std::vector< Peak >& peaksB,
+                                       const cv::Mat& pafX, const cv::Mat& pafY,
+                                       const PoseDecoderParams& params )
+{
+    const int32_t samples = std::max( params.pafSamples, 2 );
+
+    std::vector< Connection > candidates;
+
+    for ( size_t i = 0; i < peaksA.size( ); i++ )
+    {
+        for ( size_t j = 0; j < peaksB.size( ); j++ )
+        {
+            const cv::Point2f d = peaksB[ j ].position - peaksA[ i ].position;
+            const float length = std::sqrt( d.dot( d ) );
+
+            if ( length < 1e-3f )
+            {
+                continue;
+            }
+
+            const cv::Point2f direction = d / length;
+
+            //
+            // Mean projection of the field onto the limb direction and the
+            // share of samples that agree with it
+            //
+            float sum = 0.0f;
+            int32_t inliers = 0;
+
+            for ( int32_t s = 0; s < samples; s++ )
+            {
+                const float t = static_cast< float >( s ) /
+                                static_cast< float >( samples - 1 );
+                const cv::Point2f p = peaksA[ i ].position + t * d;
+
+                const int32_t x =
+                    std::clamp( static_cast< int32_t >( std::lround( p.x ) ),
+                                0,
+                                pafX.cols - 1 );
+                const int32_t y =
+                    std::clamp( static_cast< int32_t >( std::lround( p.y ) ),
+                                0,
+                                pafX.rows - 1 );
+
+                const float score = pafX.at< float >( y, x ) * direction.x +
+                                    pafY.at< float >( y, x ) * direction.y;
+
+                sum += score;
+                if ( score > params.minPafScore )
+                {
+                    inliers++;
+                }
+            }
+
+            const float mean = sum / static_cast< float >( samples );
+
+            if ( mean > params.minPafScore &&
+                 static_cast< float >( inliers ) >=
+                     params.minInlierRatio * static_cast< float >( samples ) )
+            {
+                candidates.push_back( { static_cast< int32_t >( i ),
+                                        static_cast< int32_t >( j ),
+                                        mean } );
+            }
+        }
+    }
+
+    //
+    // Best scoring connections first, every peak joins at most one of them
+    //
+    std::sort( candidates.begin( ),
+               candidates.end( ),
+               []( const Connection& l, const Connection& r ) {
+                   return l.score > r.score;
+               } );
+
+    std::vector< bool > usedA( peaksA.size( ), false );
+    std::vector< bool > usedB( peaksB.size( ), false );
+    std::vector< Connection > connections;
+
+    for ( const auto& candidate : candidates )
+    {
+        const auto a = static_cast< size_t >( candidate.a );
+        const auto b = static_cast< size_t >( candidate.b );
+
+        if ( ! usedA[ a ] && ! usedB[ b ] )
+        {
+            usedA[ a ] = true;
+            usedB[ b ] = true;
+            connections.push_back( candidate );
+        }
+    }
+
+    return connections;
+}
+} // namespace
+
+PoseModel getMpiPoseModel( )
+{
+    PoseModel model;
+    model.keypointCount = 15;
+    model.limbs = { { 0, 1 },  { 1, 2 },   { 2, 3 },  { 3, 4 },  { 1, 5 },
+                    { 5, 6 },  { 6, 7 },   { 1, 14 }, { 14, 8 }, { 8, 9 },
+                    { 9, 10 }, { 14, 11 }, { 11, 12 }, { 12, 13 } };
+
+    // The fields follow the 15 heatmaps and the background map
+    const auto limbCount = static_cast< int32_t >( model.limbs.size( ) );
+
+    for ( int32_t i = 0; i < limbCount; i++ )
+    {
+        model.pafChannels.emplace_back( 16 + 2 * i, 17 + 2 * i );
+    }
+
+    return model;
+}
+
+std::vector< std::vector< PoseKeypoint > >
+findPosePeaks( const cv::Mat& output, int32_t keypointCount,
+               cv::Size imageSize, float threshold )
+{
+    const auto peaks = findPeaks( output, keypointCount, threshold );
+    const cv::Size mapSize( output.size[ 3 ], output.size[ 2 ] );
+
+    return toImageKeypoints( peaks, mapSize, imageSize );
+}
+
+std::vector< Pose > decodePoses(
+    const cv::Mat& output, const PoseModel& model, cv::Size imageSize,
+    const PoseDecoderParams& params /*= { }*/,
+    std::vector< std::vector< PoseKeypoint > >* peakKeypoints /*= nullptr*/ )
+{
+    CV_Assert( model.limbs.size( ) == model.pafChannels.size( ) );
+
+    const auto peaks =
+        findPeaks( output, model.keypointCount, params.peakThreshold );
+    const cv::Size mapSize( output.size[ 3 ], output.size[ 2 ] );
+
+    if ( peakKeypoints != nullptr )
+    {
+        *peakKeypoints = toImageKeypoints( peaks, mapSize, imageSize );
+    }
+
+    //
+    // Connect the peaks of every limb, the limbs are independent
+    //
+    const auto limbCount = static_cast< int32_t >( model.limbs.size( ) );
+    std::vector< std::vector< Connection > > connections(
+        model.limbs.size( ) );
+
+    cv::parallel_for_(
+        cv::Range( 0, limbCount ), [ & ]( const cv::Range& range ) {
+            for ( int32_t l = range.start; l < range.end; l++ )
+            {
+                const auto i = static_cast< size_t >( l );
+                const auto [ a, b ] = model.limbs[ i ];
+                const auto [ x, y ] = model.pafChannels[ i ];
+
+                CV_Assert( x < output.size[ 1 ] && y < output.size[ 1 ] );
+
+                connections[ i ] =
+                    connectLimb( peaks[ static_cast< size_t >( a ) ],
+                                 peaks[ static_cast< size_t >( b ) ],
+                                 blobChannel( output, x ),
+                                 blobChannel( output, y ),
+                                 params );
+            }
+        } );
+
+    //
+    // Grow persons from the root outwards. parts holds the peak index of
+    // every keypoint of a person, -1 if not found.
+    //
+    struct Person
+    {
+        std::vector< int32_t > parts;
+        float score;
+    };
+
+    std::vector< Person > persons;
+
+    for ( size_t l = 0; l < model.limbs.size( ); l++ )
+    {
+        const auto a = static_cast< size_t >( model.limbs[ l ].first );
+        const auto b = static_cast< size_t >( model.limbs[ l ].second );
+
+        for ( const auto& connection : connections[ l ] )
+        {
+            const float scoreB =
+                peaks[ b ][ static_cast< size_t >( connection.b ) ].score;
+
+            const auto owner = std::find_if(
+                persons.begin( ), persons.end( ), [ & ]( const Person& p ) {
+                    return p.parts[ a ] == connection.a;
+                } );
+
+            if ( owner != persons.end( ) )
+            {
+                if ( owner->parts[ b ] < 0 )
+                {
+                    owner->parts[ b ] = connection.b;
+                    owner->score += scoreB + connection.score;
+                }
+            }
+            else
+            {
+                Person person;
+                person.parts.assign(
+                    static_cast< size_t >( model.keypointCount ), -1 );
+                person.parts[ a ] = connection.a;
+                person.parts[ b ] = connection.b;
+                person.score =
+                    peaks[ a ][ static_cast< size_t >( connection.a ) ].score +
+                    scoreB + connection.score;
+                persons.push_back( std::move( person ) );
+            }
+        }
+    }
+
+    std::vector< Pose > poses;
+
+    for ( const auto& person : persons )
+    {
+        const auto found = std::count_if( person.parts.begin( ),
+                                          person.parts.end( ),
+                                          []( int32_t p ) { return p >= 0; } );
+
+        if ( found < params.minKeypoints )
+        {
+            continue;
+        }
+
+        Pose pose;
+        pose.score = person.score;
+
+        for ( size_t k = 0; k < person.parts.size( ); k++ )
+        {
+            if ( person.parts[ k ] < 0 )
+            {
+                pose.keypoints.push_back( { cv::Point2f( -1, -1 ), 0.0f } );
+            }
+            else
+            {
+                const auto& peak =
+                    peaks[ k ][ static_cast< size_t >( person.parts[ k ] ) ];
+                pose.keypoints.push_back(
+                    { toImage( peak.position, mapSize, imageSize ),
+                      peak.score } );
+            }
+        }
+
+        poses.push_back( std::move( pose ) );
+    }
+
+    return poses;
+}
@@ -0,0 +1,378 @@
+#include <PoissonBlending.h>
+#include <Retouching.h>
+#include <macros.h>
+
+IGNORE_WARNINGS_OPENCV_PUSH
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+IGNORE_WARNINGS_POP
+
+// STD includes
+#include <algorithm>
+#include <cstddef>
+
+namespace
+{
+// Region grown by margin pixels on all sides and clipped to size
+cv::Rect growRect( const cv::Rect& region, int32_t margin, cv::Size size )
+{
+    const cv::Rect grown( region.x - margin,
+                          region.y - margin,
+                          region.width + 2 * margin,
+                          region.height + 2 * margin );
+
+    return grown & cv::Rect( cv::Point( 0, 0 ), size );
+}
+
+void toGray( const cv::Mat& src, cv::Mat& dst )
+{
+    if ( src.channels( ) == 1 )
+    {
+        src.copyTo( dst );
+    }
+    else
+    {
+        cv::cvtColor( src, dst, cv::COLOR_BGR2GRAY );
+    }
+}
+
+bool overlaps( const cv::Rect& a, const cv::Rect& b )
+{
+    return ! ( a & b ).empty( );
+}
+} // namespace
+
+GradientIntegral::GradientIntegral( const cv::Mat& _image )
+{
+    setImage( _image );
+}
+
+void GradientIntegral::setImage( const cv::Mat& _image )
+{
+    CV_Assert( _image.type( ) == CV_8UC3 || _image.type( ) == CV_8UC1 );
+
+    image = _image;
+
+    toGray( image, gray );
+    cv::Sobel( gray, gradX, CV_32F, 1, 0 );
+    cv::Sobel( gray, gradY, CV_32F, 0, 1 );
+    cv::magnitude( gradX, gradY, magnitude );
+    cv::integral( magnitude, integral, CV_64F );
+
+    dirty = cv::Rect( );
+}
+
+void GradientIntegral::invalidate( const cv::Rect& region )
+{
+    const cv::Rect clipped =
+        region & cv::Rect( cv::Point( 0, 0 ), image.size( ) );
+
+    if ( clipped.empty( ) )
+    {
+        return;
+    }
+
+    dirty = dirty.empty( ) ? clipped : ( dirty | clipped );
+}
+
+double GradientIntegral::meanGradient( const cv::Rect& region )
+{
+    CV_Assert( ! empty( ) );
+
+    update( );
+
+    const cv::Rect clipped =
+        region & cv::Rect( cv::Point( 0, 0 ), image.size( ) );
+
+    if ( clipped.empty( ) )
+    {
+        return 0.0;
+    }
+
+    const auto at = [ this ]( int32_t y, int32_t x ) {
+        return integral.at< double >( y, x );
+    };
+
+    const int32_t x0 = clipped.x;
+    const int32_t y0 = clipped.y;
+    const int32_t x1 = clipped.x + clipped.width;
+    const int32_t y1 = clipped.y + clipped.height;
+
+    const double sum =
+        at( y1, x1 ) - at( y0, x1 ) - at( y1, x0 ) + at( y0, x0 );
+
+    return sum / static_cast< double >( clipped.area( ) );
+}
+
+void GradientIntegral::update( )
+{
+    if ( dirty.empty( ) )
+    {
+        return;
+    }
+
+    const cv::Size size = image.size( );
+
+    //
+    // Gray values change inside the dirty region, the 3x3 Sobel spreads this
+    // by one pixel. Filtering a ROI reads the real neighbors outside of it, so
+    // the result matches filtering the whole image.
+    //
+    cv::Mat grayRoi = gray( dirty );
+    toGray( image( dirty ), grayRoi );
+
+    const cv::Rect changed = growRect( dirty, 1, size );
+
+    cv::Sobel( gray( changed ), gradX, CV_32F, 1, 0 );
+    cv::Sobel( gray( changed ), gradY, CV_32F, 0, 1 );
+
+    cv::Mat magnitudeRoi = magnitude( changed );
+    cv::magnitude( gradX, gradY, magnitudeRoi );
+
+    //
+    // Integral entries right of and below the changed region depend on it.
+    // Rebuild them row by row from the unchanged column left of it:
+    // I( y + 1, x + 1 ) = I( y, x + 1 ) + sum of row y up to x
+    //
+    const int32_t x0 = changed.x;
+
+    for ( int32_t y = changed.y; y < size.height; y++ )
+    {
+        const float* mag = magnitude.ptr< float >( y );
+        const double* above = integral.ptr< double >( y );
+        double* row = integral.ptr< double >( y + 1 );
+
+        double rowSum = row[ x0 ] - above[ x0 ];
+
+        for ( int32_t x = x0; x < size.width; x++ )
+        {
+            rowSum += static_cast< double >( mag[ x ] );
+            row[ x + 1 ] = above[ x + 1 ] + rowSum;
+        }
+    }
+
+    dirty = cv::Rect( );
+}
+
+std::vector< cv::Rect > getBlemishCandidates( cv::Point center,
+                                              int32_t patchRadius,
+                                              cv::Size imageSize )
+{
+    std::vector< cv::Rect > candidates;
+
+    const int32_t size = 2 * patchRadius;
+
+    for ( int32_t y = -1; y <= 1; y++ )
+    {
+        for ( int32_t x = -1; x <= 1; x++ )
+        {
+            if ( x == 0 && y == 0 )
+            {
+                continue;
+            }
+
+            const int32_t xCur = center.x - patchRadius + size * x;
+            const int32_t yCur = center.y - patchRadius + size * y;
+
+            if ( xCur < 0 || yCur < 0 || xCur + size >= imageSize.width ||
+                 yCur + size >= imageSize.height )
+            {
+                continue;
+            }
+
+            candidates.emplace_back( xCur, yCur, size, size );
+        }
+    }
+
+    return candidates;
+}
+
+std::vector< cv::Rect >
+removeBlemishes( cv::Mat& image, const std::vector< cv::Point >& centers,
+                 const BlemishRemovalParams& params /*= { }*/ )
+{
+    CV_Assert( image.type( ) == CV_8UC3 );
+    CV_Assert( params.patchRadius > 0 );
+
+    const int32_t radius = params.patchRadius;
+    const int32_t size = 2 * radius;
+    const cv::Mat mask( size, size, CV_8UC1, cv::Scalar::all( 255 ) );
+
+    //
+    // A patch writes its blended square plus the boundary ring and reads the
+    // 3x3 squares around it, grown by the gradient and ring margins. Two
+    // patches conflict if one writes what the other reads or writes.
+    //
+    std::vector< cv::Rect > writes( centers.size( ) );
+    std::vector< cv::Rect > reads( centers.size( ) );
+
+    for ( size_t i = 0; i < centers.size( ); i++ )
+    {
+        writes[ i ] = PoissonBlender::getDestinationRect(
+            mask, centers[ i ], image.size( ) );
+        reads[ i ] = growRect( cv::Rect( centers[ i ].x - 3 * radius,
+                                         centers[ i ].y - 3 * radius,
+                                         3 * size,
+                                         3 * size ),
+                               2,
+                               image.size( ) );
+    }
+
+    // Greedy coloring: each patch joins the first group it does not
+    // conflict with
+    std::vector< std::vector< size_t > > groups;
+
+    for ( size_t i = 0; i < centers.size( ); i++ )
+    {
+        const auto conflicts = [ & ]( size_t j ) {
+            return overlaps( writes[ i ], reads[ j ] ) ||
+                   overlaps( writes[ j ], reads[ i ] );
+        };
+
+        const auto group =
+            std::find_if( groups.begin( ), groups.end( ), [ & ]( auto& g ) {
+                return std::none_of( g.begin( ), g.end( ), conflicts );
+            } );
+
+        if ( group == groups.end( ) )
+        {
+            groups.push_back( { i } );
+        }
+        else
+        {
+            group->push_back( i );
+        }
+    }
+
+    //
+    // Per group: choose the candidates on the current image, then blend all
+    // patches of the group in parallel
+    //
+    std::vector< cv::Rect > chosen( centers.size( ) );
+    GradientIntegral gradients( image );
+    std::vector< ClonePatch > patches;
+
+    for ( const auto& group : groups )
+    {
+        patches.clear( );
+
+        for ( const size_t i : group )
+        {
+            const auto candidates =
+                getBlemishCandidates( centers[ i ], radius, image.size( ) );
+
+            double minGradient = 0.0;
+
+            for ( const auto& candidate : candidates )
+            {
+                const double gradient = gradients.meanGradient( candidate );
+
+                if ( chosen[ i ].empty( ) || gradient < minGradient )
+                {
+                    minGradient = gradient;
+                    chosen[ i ] = candidate;
+                }
+            }
+
+            if ( ! chosen[ i ].empty( ) )
+            {
+                patches.push_back(
+                    { image( chosen[ i ] ), mask, centers[ i ] } );
+            }
+        }
+
+        seamlessCloneBatch( patches, image, params.flags );
+
+        for ( const size_t i : group )
+        {
+            gradients.invalidate( writes[ i ] );
+        }
+    }
+
+    return chosen;
+}
+
+std::vector< cv::Rect >
+mergeOverlappingRects( const std::vector< cv::Rect >& rects )
+{
+    std::vector< cv::Rect > merged;
+
+    for ( const auto& rect : rects )
+    {
+        if ( rect.empty( ) )
+        {
+            continue;
+        }
+
+        //
+        // Absorb every merged rect the new one overlaps. The grown rect may
+        // now overlap rects it missed before, so repeat until it is stable.
+        //
+        cv::Rect unit = rect;
+        bool grown = true;
+
+        while ( grown )
+        {
+            grown = false;
+
+            for ( size_t i = 0; i < merged.size( ); )
+            {
+                if ( overlaps( unit, merged[ i ] ) )
+                {
+                    unit |= merged[ i ];
+                    merged.erase( merged.begin( ) +
+                                  static_cast< std::ptrdiff_t >( i ) );
+                    grown = true;
+                }
+                else
+                {
+                    i++;
+                }
+            }
+        }
+
+        merged.push_back( unit );
+    }
+
+    return merged;
+}
+
+void blendMasked( const cv::Mat& foreground, const cv::Mat& background,
+                  const cv::Mat& mask, cv::Mat& dst )
+{
+    CV_Assert( foreground.type( ) == CV_8UC3 &&
+               background.type( ) == CV_8UC3 && dst.type( ) == CV_8UC3 );
+    CV_Assert( mask.type( ) == CV_8UC1 );
+    CV_Assert( foreground.size( ) == background.size( ) &&
+               mask.size( ) == foreground.size( ) &&
+               dst.size( ) == foreground.size( ) );
+
+    const int32_t width = foreground.cols;
+
+    cv::parallel_for_(
+        cv::Range( 0, foreground.rows ), [ & ]( const cv::Range& range ) {
+            for ( int32_t y = range.start; y < range.end; y++ )
+            {
+                const uchar* f = foreground.ptr< uchar >( y );
+                const uchar* b = background.ptr< uchar >( y );
+                const uchar* m = mask.ptr< uchar >( y );
+                uchar* d = dst.ptr< uchar >( y );
+
+                for ( int32_t x = 0; x < width; x++ )
+                {
+                    const uint32_t alpha = m[ x ];
+
+                    for ( int32_t c = 0; c < 3; c++ )
+                    {
+                        const auto i = static_cast< size_t >( x * 3 + c );
+
+                        // Rounded division by 255, exact for v <= 255 * 255
+                        const uint32_t v =
+                            f[ i ] * alpha + b[ i ] * ( 255 - alpha ) + 128;
+                        d[ i ] =
+                            static_cast< uchar >( ( v + ( v >> 8 ) ) >> 8 );
+                    }
+                }
+            }
+        } );
+}